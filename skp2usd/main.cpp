@@ -22,6 +22,8 @@
 // language governing permissions and limitations under the Apache License.
 
 #include <iostream>
+#include <set>
+#include <stdexcept>
 #include <string>
 #include <unistd.h>
 
@@ -30,7 +32,7 @@
 #include "pxr/base/plug/registry.h"
 
 /*
- We'd like to have arguments with defaults:
+ Arguments, after the file names, with their defaults:
  --exportMeshes 1
  --exportCameras 1
  --exportMaterials 1
@@ -41,6 +43,26 @@
  --exportCurves 0
  --exportLines 0
  --exportEdges 0
+ --exportNGons 0
+ --nativeTriangulation 0
+ --mergeCoplanarFaces 0
+ --weldVertices 1
+ --weldTolerance 0
+ --cleanUpMeshes 1
+ --sortFacesByMaterial 0
+ --splitMeshesByMaterial 0
+ --shareMeshTopology 0
+ --omitClosedBackSides 0
+ --exportPointInstancers 0
+ --pointInstancerMinimum 16
+ --chooseInstancingByCost 0
+ --flattenTriangleMaximum 64
+ --flattenTriangleBudget 100000
+ --mergeIdenticalDefinitions 1
+ --includeTags ""
+ --excludeTags ""
+ The flags take 0 or 1, and the tag lists comma separated tag names,
+ e.g. --includeTags "Walls,Roof".
  */
 
 void
@@ -58,13 +80,41 @@ _findUSDPlugins() {
 }
 
 
+static bool
+_parseFlag(const std::string& value) {
+    if (value == "1" || value == "true") {
+        return true;
+    }
+    if (value == "0" || value == "false") {
+        return false;
+    }
+    throw std::invalid_argument(value);
+}
+
+static std::set<std::string>
+_splitTags(const std::string& tags) {
+    std::set<std::string> names;
+    size_t start = 0;
+    while (start <= tags.size()) {
+        size_t end = tags.find(',', start);
+        if (end == std::string::npos) {
+            end = tags.size();
+        }
+        if (end > start) {
+            names.insert(tags.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return names;
+}
+
 int
 main(int argc, const char * argv[]) {
     _findUSDPlugins();
 
     if (argc < 3) {
         std::cerr   << "USAGE: " << argv[0]
-        << " [opts] <in.skp> <out.usd[a,z]>" << std::endl;
+        << " <in.skp> <out.usd[a,z]> [opts]" << std::endl;
         return -1;
     }
     const std::string skpFile = std::string(argv[1]);
@@ -84,11 +134,102 @@ main(int argc, const char * argv[]) {
     bool exportCurves = false;
     bool exportLines = false;
     bool exportEdges = false;
+    bool exportNGons = false;
+    bool nativeTriangulation = false;
+    bool mergeCoplanarFaces = false;
+    bool weldVertices = true;
+    double weldTolerance = 0.0;
+    bool cleanUpMeshes = true;
+    bool sortFacesByMaterial = false;
+    bool splitMeshesByMaterial = false;
+    bool shareMeshTopology = false;
+    bool omitClosedBackSides = false;
+    bool exportPointInstancers = false;
+    size_t pointInstancerMinimum = 16;
+    bool chooseInstancingByCost = false;
+    unsigned long long flattenTriangleMaximum = 64;
+    unsigned long long flattenTriangleBudget = 100000;
+    bool mergeIdenticalDefinitions = true;
+    std::set<std::string> includedTags;
+    std::set<std::string> excludedTags;
+
+    for (int i = 3; i < argc; i++) {
+        const std::string opt(argv[i]);
+        if (i + 1 >= argc) {
+            std::cerr << "Ignoring option " << opt << " with no value"
+            << std::endl;
+            break;
+        }
+        const std::string value(argv[++i]);
+        try {
+            if (opt == "--exportMeshes") {
+                exportMeshes = _parseFlag(value);
+            } else if (opt == "--exportCameras") {
+                exportCameras = _parseFlag(value);
+            } else if (opt == "--exportMaterials") {
+                exportMaterials = _parseFlag(value);
+            } else if (opt == "--arKitCompatible") {
+                exportARKitCompatibleUSDZ = _parseFlag(value);
+            } else if (opt == "--exportDoubleSided") {
+                exportDoubleSided = _parseFlag(value);
+            } else if (opt == "--singleFile") {
+                exportToSingleFile = _parseFlag(value);
+            } else if (opt == "--exportNormals") {
+                exportNormals = _parseFlag(value);
+            } else if (opt == "--exportCurves") {
+                exportCurves = _parseFlag(value);
+            } else if (opt == "--exportLines") {
+                exportLines = _parseFlag(value);
+            } else if (opt == "--exportEdges") {
+                exportEdges = _parseFlag(value);
+            } else if (opt == "--exportNGons") {
+                exportNGons = _parseFlag(value);
+            } else if (opt == "--nativeTriangulation") {
+                nativeTriangulation = _parseFlag(value);
+            } else if (opt == "--mergeCoplanarFaces") {
+                mergeCoplanarFaces = _parseFlag(value);
+            } else if (opt == "--weldVertices") {
+                weldVertices = _parseFlag(value);
+            } else if (opt == "--weldTolerance") {
+                weldTolerance = std::stod(value);
+            } else if (opt == "--cleanUpMeshes") {
+                cleanUpMeshes = _parseFlag(value);
+            } else if (opt == "--sortFacesByMaterial") {
+                sortFacesByMaterial = _parseFlag(value);
+            } else if (opt == "--splitMeshesByMaterial") {
+                splitMeshesByMaterial = _parseFlag(value);
+            } else if (opt == "--shareMeshTopology") {
+                shareMeshTopology = _parseFlag(value);
+            } else if (opt == "--omitClosedBackSides") {
+                omitClosedBackSides = _parseFlag(value);
+            } else if (opt == "--exportPointInstancers") {
+                exportPointInstancers = _parseFlag(value);
+            } else if (opt == "--pointInstancerMinimum") {
+                pointInstancerMinimum = std::stoul(value);
+            } else if (opt == "--chooseInstancingByCost") {
+                chooseInstancingByCost = _parseFlag(value);
+            } else if (opt == "--flattenTriangleMaximum") {
+                flattenTriangleMaximum = std::stoull(value);
+            } else if (opt == "--flattenTriangleBudget") {
+                flattenTriangleBudget = std::stoull(value);
+            } else if (opt == "--mergeIdenticalDefinitions") {
+                mergeIdenticalDefinitions = _parseFlag(value);
+            } else if (opt == "--includeTags") {
+                includedTags = _splitTags(value);
+            } else if (opt == "--excludeTags") {
+                excludedTags = _splitTags(value);
+            } else {
+                std::cerr << "Ignoring unknown option " << opt << std::endl;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Bad value " << value << " for option " << opt
+            << std::endl;
+            return -1;
+        }
+    }
 
-    // we should handle command line args here:
-    
     try {
-        auto myExporter = USDExporter();
+        USDExporter myExporter;
         myExporter.SetExportMeshes(exportMeshes);
         myExporter.SetExportCameras(exportCameras);
         myExporter.SetExportMaterials(exportMaterials);
@@ -99,10 +240,29 @@ main(int argc, const char * argv[]) {
         myExporter.SetExportCurves(exportCurves);
         myExporter.SetExportLines(exportLines);
         myExporter.SetExportEdges(exportEdges);
+        myExporter.SetExportNGons(exportNGons);
+        myExporter.SetNativeTriangulation(nativeTriangulation);
+        myExporter.SetMergeCoplanarFaces(mergeCoplanarFaces);
+        myExporter.SetWeldVertices(weldVertices);
+        myExporter.SetWeldTolerance(weldTolerance);
+        myExporter.SetCleanUpMeshes(cleanUpMeshes);
+        myExporter.SetSortFacesByMaterial(sortFacesByMaterial);
+        myExporter.SetSplitMeshesByMaterial(splitMeshesByMaterial);
+        myExporter.SetShareMeshTopology(shareMeshTopology);
+        myExporter.SetOmitClosedBackSides(omitClosedBackSides);
+        myExporter.SetExportPointInstancers(exportPointInstancers);
+        myExporter.SetPointInstancerMinimum(pointInstancerMinimum);
+        myExporter.SetChooseInstancingByCost(chooseInstancingByCost);
+        myExporter.SetFlattenTriangleMaximum(flattenTriangleMaximum);
+        myExporter.SetFlattenTriangleBudget(flattenTriangleBudget);
+        myExporter.SetMergeIdenticalDefinitions(mergeIdenticalDefinitions);
+        myExporter.SetIncludedTags(includedTags);
+        myExporter.SetExcludedTags(excludedTags);
         if (!myExporter.Convert(skpFile, usdFile, NULL)) {
             std::cerr << "Failed to save USD file " << usdFile << std::endl;
             return -2;
         }
+        std::cerr << myExporter.GetInstancingSummary();
     } catch (...) {
         std::cerr << "Failed to save USD file " << usdFile
         << " (Exception was thrown)" << std::endl;
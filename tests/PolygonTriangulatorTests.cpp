@@ -0,0 +1,215 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  PolygonTriangulatorTests.cpp
+//
+// Triangulates synthetic faces and checks that the triangles cover the face
+// exactly: the count PolygonTriangulator promised, all wound
+// counter-clockwise, none of them outside the outer loop or inside a hole,
+// and together with the same area as the face. See the Makefile next to
+// this file for how to build and run it.
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PolygonTriangulator.h"
+
+typedef std::vector<std::pair<double, double>> Loop;
+
+static const double epsilon = 1.0e-9;
+static int failures = 0;
+
+static void
+_fail(const std::string& test, const std::string& message) {
+    std::cerr << "FAILED " << test << ": " << message << std::endl;
+    failures++;
+}
+
+static double
+_signedArea(const Loop& loop) {
+    double area = 0.0;
+    for (size_t i = 0; i < loop.size(); i++) {
+        const auto& a = loop[i];
+        const auto& b = loop[(i + 1) % loop.size()];
+        area += a.first * b.second - b.first * a.second;
+    }
+    return 0.5 * area;
+}
+
+// strictly inside, for points that are well away from the edges
+static bool
+_inside(const Loop& loop, double x, double y) {
+    bool inside = false;
+    for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++) {
+        const double xi = loop[i].first, yi = loop[i].second;
+        const double xj = loop[j].first, yj = loop[j].second;
+        if ((yi > y) != (yj > y) &&
+            x < (xj - xi) * (y - yi) / (yj - yi) + xi) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// The loops are in the z = 0 plane, the first one is the outer loop. The
+// face is triangulated around +z, or around -z with the loops mirrored so
+// it's the same face seen from below.
+static void
+_check(const std::string& test, const std::vector<Loop>& loops,
+       bool fromBelow = false) {
+    std::vector<SUPoint3D> points;
+    std::vector<size_t> loopSizes;
+    for (const Loop& loop : loops) {
+        loopSizes.push_back(loop.size());
+        for (const auto& xy : loop) {
+            SUPoint3D point;
+            point.x = fromBelow ? -xy.first : xy.first;
+            point.y = xy.second;
+            point.z = 0.0;
+            points.push_back(point);
+        }
+    }
+    SUVector3D normal;
+    normal.x = 0.0;
+    normal.y = 0.0;
+    normal.z = fromBelow ? -1.0 : 1.0;
+    const int offset = 7;
+    const size_t numTriangles = PolygonTriangulator::CountTriangles(
+        loopSizes.data(), loopSizes.size());
+    size_t numPoints = points.size();
+    size_t expected = numPoints + 2 * (loops.size() - 1) - 2;
+    if (numTriangles != expected) {
+        _fail(test, "expected " + std::to_string(expected) +
+              " triangles, was promised " + std::to_string(numTriangles));
+        return ;
+    }
+    std::vector<int> indices(3 * numTriangles + 1, -1);
+    PolygonTriangulator triangulator;
+    triangulator.Triangulate(points.data(), loopSizes.data(), loopSizes.size(),
+                             normal, offset, indices.data());
+    if (indices.back() != -1) {
+        _fail(test, "wrote past the promised triangles");
+    }
+    double faceArea = std::fabs(_signedArea(loops[0]));
+    for (size_t i = 1; i < loops.size(); i++) {
+        faceArea -= std::fabs(_signedArea(loops[i]));
+    }
+    // the same points, in the order Triangulate indexes them
+    Loop all;
+    for (const Loop& loop : loops) {
+        all.insert(all.end(), loop.begin(), loop.end());
+    }
+    double area = 0.0;
+    for (size_t t = 0; t < numTriangles; t++) {
+        Loop triangle;
+        for (int k = 0; k < 3; k++) {
+            const int index = indices[3 * t + k] - offset;
+            if (index < 0 || index >= (int)numPoints) {
+                _fail(test, "triangle " + std::to_string(t) +
+                      " has an index out of range");
+                return ;
+            }
+            triangle.push_back(all[index]);
+        }
+        const double triangleArea = _signedArea(triangle);
+        if (triangleArea < -epsilon) {
+            _fail(test, "triangle " + std::to_string(t) + " is clockwise");
+        }
+        area += triangleArea;
+        if (triangleArea <= epsilon) {
+            // a sliver along collinear points, there's nothing to be inside
+            continue;
+        }
+        const double cx = (triangle[0].first + triangle[1].first +
+                           triangle[2].first) / 3.0;
+        const double cy = (triangle[0].second + triangle[1].second +
+                           triangle[2].second) / 3.0;
+        if (!_inside(loops[0], cx, cy)) {
+            _fail(test, "triangle " + std::to_string(t) +
+                  " is outside the outer loop");
+        }
+        for (size_t i = 1; i < loops.size(); i++) {
+            if (_inside(loops[i], cx, cy)) {
+                _fail(test, "triangle " + std::to_string(t) +
+                      " is inside hole " + std::to_string(i));
+            }
+        }
+    }
+    if (std::fabs(area - faceArea) > 1.0e-6 * std::max(1.0, faceArea)) {
+        _fail(test, "triangles cover " + std::to_string(area) +
+              " of a face of " + std::to_string(faceArea));
+    }
+}
+
+static Loop
+_square(double x0, double y0, double x1, double y1, bool clockwise) {
+    if (clockwise) {
+        return {{x0, y0}, {x0, y1}, {x1, y1}, {x1, y0}};
+    }
+    return {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+}
+
+int
+main(int argc, const char* argv[]) {
+    const Loop outer = _square(0, 0, 10, 10, false);
+
+    _check("triangle", {{{0, 0}, {1, 0}, {0, 1}}});
+    _check("square", {outer});
+    _check("clockwise square", {_square(0, 0, 10, 10, true)});
+    _check("square with a hole", {outer, _square(3, 3, 7, 7, true)});
+    _check("square with a hole, from below",
+           {outer, _square(3, 3, 7, 7, true)}, true);
+    _check("square with a counter-clockwise hole",
+           {outer, _square(3, 3, 7, 7, false)});
+    _check("square with two holes",
+           {outer, _square(1, 1, 4, 4, true), _square(6, 6, 9, 9, true)});
+    _check("square with two holes side by side",
+           {outer, _square(1, 4, 4, 6, true), _square(6, 4, 9, 6, true)});
+    _check("hole touching the outer loop",
+           {outer, {{10, 5}, {7, 3}, {7, 7}}});
+    _check("hole touching the outer loop at a corner",
+           {outer, {{10, 10}, {8, 5}, {5, 8}}});
+    _check("collinear points",
+           {{{0, 0}, {2, 0}, {4, 0}, {6, 0}, {10, 0}, {10, 5}, {10, 10},
+             {5, 10}, {0, 10}, {0, 5}}});
+    _check("collinear points with a hole",
+           {{{0, 0}, {5, 0}, {10, 0}, {10, 10}, {5, 10}, {0, 10}},
+            {{3, 3}, {3, 5}, {3, 7}, {7, 7}, {7, 5}, {7, 3}}});
+    _check("concave outline",
+           {{{0, 0}, {10, 0}, {10, 10}, {8, 10}, {8, 2}, {6, 2}, {6, 10},
+             {4, 10}, {4, 2}, {2, 2}, {2, 10}, {0, 10}}});
+    _check("concave outline with a hole in a tooth",
+           {{{0, 0}, {10, 0}, {10, 4}, {3, 4}, {3, 10}, {0, 10}},
+            _square(1, 5, 2, 9, true)});
+    _check("star",
+           {{{0, -10}, {2, -3}, {10, -3}, {4, 1}, {6, 9}, {0, 4},
+             {-6, 9}, {-4, 1}, {-10, -3}, {-2, -3}}});
+
+    if (failures) {
+        std::cerr << failures << " failure(s)" << std::endl;
+        return 1;
+    }
+    std::cerr << "All PolygonTriangulator tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,174 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  UVMappingTests.cpp
+//
+// Fits UVMappings to synthetic faces and checks that neighbouring faces
+// only match when their textures really carry on from one to the other,
+// not just along the edge they share. See the Makefile next to this file
+// for how to build and run it.
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "UVMapping.h"
+
+typedef std::function<SUPoint3D(const SUPoint3D&)> Texture;
+
+static const double tolerance = 1.0e-6;
+static int failures = 0;
+
+static void
+_fail(const std::string& test, const std::string& message) {
+    std::cerr << "FAILED " << test << ": " << message << std::endl;
+    failures++;
+}
+
+static SUPoint3D
+_point(double x, double y, double z) {
+    SUPoint3D point;
+    point.x = x;
+    point.y = y;
+    point.z = z;
+    return point;
+}
+
+static SUVector3D
+_vector(double x, double y, double z) {
+    SUVector3D vector;
+    vector.x = x;
+    vector.y = y;
+    vector.z = z;
+    return vector;
+}
+
+static UVMapping
+_fit(const std::string& test, const std::vector<SUPoint3D>& points,
+     const Texture& texture, const SUVector3D& normal) {
+    std::vector<SUPoint3D> stqs;
+    for (const SUPoint3D& point : points) {
+        stqs.push_back(texture(point));
+    }
+    UVMapping mapping;
+    if (!mapping.Fit(points.data(), stqs.data(), points.size(), normal)) {
+        _fail(test, "couldn't fit a mapping");
+    }
+    return mapping;
+}
+
+// two faces that share the edge from (1, 0) to (1, 1) in the z = 0 plane,
+// each with its own texture
+static void
+_check(const std::string& test, const Texture& left, const Texture& right,
+       bool expected) {
+    const SUVector3D normal = _vector(0, 0, 1);
+    const UVMapping a = _fit(test, {_point(0, 0, 0), _point(1, 0, 0),
+                                    _point(1, 1, 0), _point(0, 1, 0)},
+                             left, normal);
+    const UVMapping b = _fit(test, {_point(1, 0, 0), _point(2, 0, 0),
+                                    _point(2, 1, 0), _point(1, 1, 0)},
+                             right, normal);
+    if (a.Matches(b, tolerance) != expected ||
+        b.Matches(a, tolerance) != expected) {
+        _fail(test, expected ? "the textures should have matched"
+                             : "the textures shouldn't have matched");
+    }
+}
+
+static void
+_checkEvaluate(const std::string& test, const std::vector<SUPoint3D>& points,
+               const Texture& texture, const SUVector3D& normal,
+               const std::vector<SUPoint3D>& elsewhere) {
+    const UVMapping mapping = _fit(test, points, texture, normal);
+    for (const SUPoint3D& point : elsewhere) {
+        const SUPoint3D stq = mapping.Evaluate(point);
+        const SUPoint3D expected = texture(point);
+        if (std::fabs(stq.x - expected.x) > tolerance ||
+            std::fabs(stq.y - expected.y) > tolerance ||
+            std::fabs(stq.z - expected.z) > tolerance) {
+            _fail(test, "evaluated to the wrong STQ");
+        }
+    }
+}
+
+int
+main(int argc, const char* argv[]) {
+    const Texture plain = [](const SUPoint3D& p) {
+        return _point(p.x, p.y, 1.0);
+    };
+    _check("continuous texture", plain, plain, true);
+    _check("continuous projected texture",
+           [](const SUPoint3D& p) {
+               return _point(p.x, p.y, 1.0 + 0.1 * p.x + 0.2 * p.y);
+           },
+           [](const SUPoint3D& p) {
+               return _point(p.x, p.y, 1.0 + 0.1 * p.x + 0.2 * p.y);
+           }, true);
+    // all of these agree with plain all along the shared edge
+    _check("texture mirrored across the edge", plain,
+           [](const SUPoint3D& p) { return _point(2.0 - p.x, p.y, 1.0); },
+           false);
+    _check("texture scaled across the edge", plain,
+           [](const SUPoint3D& p) {
+               return _point(1.0 + 2.0 * (p.x - 1.0), p.y, 1.0);
+           }, false);
+    _check("texture sheared across the edge", plain,
+           [](const SUPoint3D& p) {
+               return _point(p.x, p.y + (p.x - 1.0), 1.0);
+           }, false);
+    _check("texture offset along the edge", plain,
+           [](const SUPoint3D& p) { return _point(p.x, p.y + 0.5, 1.0); },
+           false);
+
+    // a tilted face well away from the origin, with a rotated texture
+    const Texture rotated = [](const SUPoint3D& p) {
+        return _point(0.6 * p.x - 0.8 * p.y, 0.8 * p.x + 0.6 * p.y + p.z,
+                      1.0);
+    };
+    const double r = std::sqrt(0.5);
+    _checkEvaluate("tilted face far from the origin",
+                   {_point(5000, 5000, 5000), _point(5003, 5000, 5000),
+                    _point(5004, 5002, 5002), _point(5000, 5001, 5001)},
+                   rotated, _vector(0, -r, r),
+                   {_point(5001, 5001, 5001), _point(5010, 5007, 5007),
+                    _point(4990, 4995, 4995)});
+
+    const SUPoint3D line[] = {_point(0, 0, 0), _point(1, 0, 0),
+                              _point(2, 0, 0)};
+    const SUPoint3D lineSTQs[] = {_point(0, 0, 1), _point(1, 0, 1),
+                                  _point(2, 0, 1)};
+    UVMapping mapping;
+    if (mapping.Fit(line, lineSTQs, 3, _vector(0, 0, 1)) ||
+        mapping.IsValid() || mapping.Matches(mapping, tolerance)) {
+        _fail("points on a line", "shouldn't have fitted a mapping");
+    }
+
+    if (failures) {
+        std::cerr << failures << " failure(s)" << std::endl;
+        return 1;
+    }
+    std::cerr << "All UVMapping tests passed" << std::endl;
+    return 0;
+}
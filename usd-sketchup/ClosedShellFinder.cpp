@@ -0,0 +1,179 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  ClosedShellFinder.cpp
+//
+#include <cstdint>
+#include <unordered_map>
+
+#include "ClosedShellFinder.h"
+#include "MeshCleaner.h"
+
+#pragma mark Helper definitions:
+
+// how often an edge is used each way round, from its smaller position to
+// its larger one and back
+struct _EdgeUses {
+    int forward;
+    int backward;
+    int face;
+};
+
+static uint64_t
+_edgeKey(int a, int b) {
+    return a < b ? ((uint64_t)a << 32) | (uint32_t)b
+                 : ((uint64_t)b << 32) | (uint32_t)a;
+}
+
+#pragma mark ClosedShellFinder class:
+
+ClosedShellFinder::ClosedShellFinder() : _closedShellsCount(0),
+                                         _closedFacesCount(0) {
+}
+
+ClosedShellFinder::~ClosedShellFinder() {
+}
+
+size_t
+ClosedShellFinder::GetClosedShellsCount() const {
+    return _closedShellsCount;
+}
+
+size_t
+ClosedShellFinder::GetClosedFacesCount() const {
+    return _closedFacesCount;
+}
+
+const pxr::VtArray<int>&
+ClosedShellFinder::GetOpenFaces() const {
+    return _openFaces;
+}
+
+size_t
+ClosedShellFinder::Find(const pxr::VtArray<pxr::GfVec3f>& points,
+                        const pxr::VtArray<int>& faceVertexCounts,
+                        const pxr::VtArray<int>& faceVertexIndices,
+                        const std::vector<bool>* seeThroughFaces) {
+    _closedShellsCount = 0;
+    _closedFacesCount = 0;
+    _openFaces.clear();
+    const size_t numFaces = faceVertexCounts.size();
+    const pxr::GfVec3f* inPoints = points.cdata();
+    const int* counts = faceVertexCounts.cdata();
+    const int* indices = faceVertexIndices.cdata();
+    std::vector<int> positions;
+    NumberPositions(inPoints, points.size(), positions);
+
+    _shells.resize(numFaces);
+    for (size_t f = 0; f < numFaces; f++) {
+        _shells[f] = (int)f;
+    }
+    std::unordered_map<uint64_t, _EdgeUses> edges;
+    edges.reserve(faceVertexIndices.size());
+    size_t start = 0;
+    for (size_t f = 0; f < numFaces; f++) {
+        const int count = counts[f];
+        for (int i = 0; i < count; i++) {
+            const int a = positions[indices[start + i]];
+            const int b = positions[indices[start + (i + 1) % count]];
+            _EdgeUses uses = {0, 0, (int)f};
+            auto found = edges.insert(std::make_pair(_edgeKey(a, b), uses));
+            if (a < b) {
+                found.first->second.forward++;
+            } else {
+                found.first->second.backward++;
+            }
+            _joinShells(found.first->second.face, (int)f);
+        }
+        start += count;
+    }
+    // a shell with an edge that isn't used once each way isn't closed
+    std::vector<bool> open(numFaces, false);
+    for (const auto& edge : edges) {
+        if (edge.second.forward != 1 || edge.second.backward != 1) {
+            open[_findShell(edge.second.face)] = true;
+        }
+    }
+    if (seeThroughFaces) {
+        for (size_t f = 0; f < numFaces; f++) {
+            if ((*seeThroughFaces)[f]) {
+                open[_findShell((int)f)] = true;
+            }
+        }
+    }
+    // six times the volume of each closed shell, from the tetrahedra
+    // between the origin and a fan of each polygon's triangles
+    std::vector<double> volumes(numFaces, 0.0);
+    start = 0;
+    for (size_t f = 0; f < numFaces; f++) {
+        const int shell = _findShell((int)f);
+        const int count = counts[f];
+        if (!open[shell]) {
+            const pxr::GfVec3f& p0 = inPoints[indices[start]];
+            for (int i = 1; i + 1 < count; i++) {
+                const pxr::GfVec3f& p1 = inPoints[indices[start + i]];
+                const pxr::GfVec3f& p2 = inPoints[indices[start + i + 1]];
+                volumes[shell] +=
+                    (double)p0[0] * ((double)p1[1] * p2[2] - (double)p1[2] * p2[1]) +
+                    (double)p0[1] * ((double)p1[2] * p2[0] - (double)p1[0] * p2[2]) +
+                    (double)p0[2] * ((double)p1[0] * p2[1] - (double)p1[1] * p2[0]);
+            }
+        }
+        start += count;
+    }
+    for (size_t f = 0; f < numFaces; f++) {
+        const int shell = _findShell((int)f);
+        if (open[shell] || volumes[shell] <= 0.0) {
+            _openFaces.push_back((int)f);
+            continue;
+        }
+        if (shell == (int)f) {
+            _closedShellsCount++;
+        }
+        _closedFacesCount++;
+    }
+    return _closedFacesCount;
+}
+
+int
+ClosedShellFinder::_findShell(int face) {
+    while (_shells[face] != face) {
+        _shells[face] = _shells[_shells[face]];
+        face = _shells[face];
+    }
+    return face;
+}
+
+void
+ClosedShellFinder::_joinShells(int a, int b) {
+    a = _findShell(a);
+    b = _findShell(b);
+    if (a == b) {
+        return ;
+    }
+    // the smaller face stays the root, so each shell is known by its first
+    if (a < b) {
+        _shells[b] = a;
+    } else {
+        _shells[a] = b;
+    }
+}
@@ -0,0 +1,76 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  ClosedShellFinder.h
+//
+// Finds the polygons of a mesh that make up closed shells (walls, columns,
+// furniture, ...) with their front sides facing out. You can't see the back
+// sides of those from anywhere outside them, so we don't need to write them.
+//
+// A shell is a set of polygons connected by their edges. It's closed if every
+// edge is used by exactly two of its polygons, once each way round, which
+// also means they all face the same way. It faces out if the volume it
+// encloses comes out positive. Polygons are connected by where their points
+// are, not by point index, so a seam in the UVs doesn't open a shell. A shell
+// with a polygon that can be seen through (a glass box, say) doesn't count as
+// closed either, since its far walls can be seen from the back.
+
+#ifndef ClosedShellFinder_h
+#define ClosedShellFinder_h
+
+#include <stdio.h>
+#include <vector>
+
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/vt/array.h"
+
+class ClosedShellFinder {
+public:
+    ClosedShellFinder();
+    ~ClosedShellFinder();
+
+    // Returns the number of polygons in closed shells. If seeThroughFaces
+    // is given, it says which polygons are see-through, and the shells they
+    // are in stay open.
+    size_t Find(const pxr::VtArray<pxr::GfVec3f>& points,
+                const pxr::VtArray<int>& faceVertexCounts,
+                const pxr::VtArray<int>& faceVertexIndices,
+                const std::vector<bool>* seeThroughFaces = NULL);
+
+    size_t GetClosedShellsCount() const;
+    size_t GetClosedFacesCount() const;
+    // the polygons that aren't in a closed shell, in order
+    const pxr::VtArray<int>& GetOpenFaces() const;
+
+private:
+    size_t _closedShellsCount;
+    size_t _closedFacesCount;
+    pxr::VtArray<int> _openFaces;
+
+    // polygon to the shell it's in, as a union-find forest
+    std::vector<int> _shells;
+
+    int _findShell(int face);
+    void _joinShells(int a, int b);
+};
+
+#endif /* ClosedShellFinder_h */
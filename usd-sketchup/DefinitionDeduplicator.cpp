@@ -0,0 +1,302 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  DefinitionDeduplicator.cpp
+//
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <tuple>
+
+#include "DefinitionDeduplicator.h"
+
+#pragma mark Helper definitions:
+
+static void
+_hashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// FNV-1a, over exactly the bytes _sameBytes compares
+static size_t
+_hashBytes(const void* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+static bool
+_sameBytes(const void* a, const void* b, size_t size) {
+    return a == b || !size || !memcmp(a, b, size);
+}
+
+template <typename T>
+static size_t
+_hashArray(const pxr::VtArray<T>& array) {
+    return _hashBytes(array.cdata(), array.size() * sizeof(T));
+}
+
+template <typename T>
+static bool
+_sameArray(const pxr::VtArray<T>& a, const pxr::VtArray<T>& b) {
+    return a.size() == b.size() &&
+        _sameBytes(a.cdata(), b.cdata(), a.size() * sizeof(T));
+}
+
+static size_t
+_hashCurves(const SceneCurves& curves) {
+    size_t hash = _hashArray(curves.points);
+    _hashCombine(hash, _hashArray(curves.vertexCounts));
+    return hash;
+}
+
+static bool
+_sameCurves(const SceneCurves& a, const SceneCurves& b) {
+    return _sameArray(a.points, b.points) &&
+        _sameArray(a.vertexCounts, b.vertexCounts);
+}
+
+static size_t
+_hashTransform(const pxr::GfMatrix4d& transform) {
+    return _hashBytes(transform.data(), 16 * sizeof(double));
+}
+
+static bool
+_sameTransform(const pxr::GfMatrix4d& a, const pxr::GfMatrix4d& b) {
+    return _sameBytes(a.data(), b.data(), 16 * sizeof(double));
+}
+
+#pragma mark DefinitionDeduplicator class:
+
+DefinitionDeduplicator::DefinitionDeduplicator() : _scene(NULL) {
+}
+
+DefinitionDeduplicator::~DefinitionDeduplicator() {
+}
+
+void
+DefinitionDeduplicator::Clear() {
+    _scene = NULL;
+    _looks.clear();
+    _canonicalKeys.clear();
+    _hashes.clear();
+}
+
+uintptr_t
+DefinitionDeduplicator::GetCanonicalKey(uintptr_t key) const {
+    auto found = _canonicalKeys.find(key);
+    if (found == _canonicalKeys.end()) {
+        return key;
+    }
+    return found->second;
+}
+
+size_t
+DefinitionDeduplicator::GetDuplicatesCount() const {
+    return _canonicalKeys.size();
+}
+
+size_t
+DefinitionDeduplicator::Find(const SketchUpScene& scene) {
+    Clear();
+    _scene = &scene;
+    _findLooks();
+    // the definitions that aren't copies, by their hash
+    std::map<size_t, std::vector<const SceneDefinition*>> byHash;
+    for (const SceneDefinition& definition : scene.definitions) {
+        _visit(definition, byHash);
+    }
+    _scene = NULL;
+    _hashes.clear();
+    return _canonicalKeys.size();
+}
+
+// A material looks the same as another if it has the same texture, or if
+// neither has a texture, the same color, or no color at all.
+void
+DefinitionDeduplicator::_findLooks() {
+    const std::vector<SceneMaterial>& materials = _scene->materials;
+    _looks.resize(materials.size());
+    std::map<std::tuple<std::string, bool, float, float, float, float>, int> looks;
+    for (size_t i = 0; i < materials.size(); i++) {
+        const SceneMaterial& material = materials[i];
+        const bool hasColor = material.textureName.empty() && material.hasColor;
+        pxr::GfVec3f rgb(0.0f, 0.0f, 0.0f);
+        float opacity = 0.0f;
+        if (hasColor) {
+            rgb = material.rgb;
+            opacity = material.opacity;
+        }
+        auto key = std::make_tuple(material.textureName, hasColor,
+                                   rgb[0], rgb[1], rgb[2], opacity);
+        _looks[i] = looks.insert(std::make_pair(key, (int)i)).first->second;
+    }
+}
+
+int
+DefinitionDeduplicator::_look(int material) const {
+    if (material < 0 || material >= (int)_looks.size()) {
+        return -1;
+    }
+    return _looks[material];
+}
+
+// Goes through the definitions this one instances first, so that its
+// instances can be hashed and compared by the definitions they are copies
+// of. That way two copies of a chair that each hold their own copy of a
+// cushion still match. Of a set of copies, the first one we get to is the
+// one the others are mapped to.
+void
+DefinitionDeduplicator::_visit(const SceneDefinition& definition,
+                               std::map<size_t, std::vector<const SceneDefinition*>>& byHash) {
+    if (_hashes.find(definition.key) != _hashes.end()) {
+        return ;
+    }
+    // SketchUp doesn't let a component contain itself, but if a file ever
+    // manages it, this keeps us from going round the cycle
+    _hashes[definition.key] = 0;
+    for (auto& child : definition.children) {
+        const SceneDefinition* childDefinition = _scene->FindDefinition(child.first);
+        if (childDefinition) {
+            _visit(*childDefinition, byHash);
+        }
+    }
+    size_t hash = _hashEntities(definition.entities);
+    _hashCombine(hash, definition.isBillboard);
+    _hashes[definition.key] = hash;
+    std::vector<const SceneDefinition*>& candidates = byHash[hash];
+    for (const SceneDefinition* candidate : candidates) {
+        if (candidate->isBillboard == definition.isBillboard &&
+            _sameEntities(candidate->entities, definition.entities)) {
+            _canonicalKeys[definition.key] = candidate->key;
+            return ;
+        }
+    }
+    candidates.push_back(&definition);
+}
+
+size_t
+DefinitionDeduplicator::_hashEntities(const SceneEntities& entities) const {
+    size_t hash = _hashMesh(entities.mesh);
+    _hashCombine(hash, _hashCurves(entities.edges));
+    _hashCombine(hash, _hashCurves(entities.curves));
+    _hashCombine(hash, _hashCurves(entities.polylines));
+    for (const SceneInstance& instance : entities.instances) {
+        _hashCombine(hash, GetCanonicalKey(instance.definition));
+        _hashCombine(hash, _hashTransform(instance.transform));
+        _hashCombine(hash, _look(instance.material));
+    }
+    for (const SceneGroup& group : entities.groups) {
+        _hashCombine(hash, std::hash<std::string>()(group.name));
+        _hashCombine(hash, _hashTransform(group.transform));
+        if (group.entities) {
+            _hashCombine(hash, _hashEntities(*group.entities));
+        }
+    }
+    return hash;
+}
+
+size_t
+DefinitionDeduplicator::_hashMesh(const SceneMesh& mesh) const {
+    size_t hash = _hashArray(mesh.points);
+    _hashCombine(hash, _hashArray(mesh.normals));
+    _hashCombine(hash, _hashArray(mesh.frontUVs));
+    _hashCombine(hash, _hashArray(mesh.backUVs));
+    _hashCombine(hash, _hashArray(mesh.faceVertexCounts));
+    _hashCombine(hash, _hashArray(mesh.faceVertexIndices));
+    for (int material : mesh.frontMaterials) {
+        _hashCombine(hash, _look(material));
+    }
+    for (int material : mesh.backMaterials) {
+        _hashCombine(hash, _look(material));
+    }
+    return hash;
+}
+
+bool
+DefinitionDeduplicator::_sameEntities(const SceneEntities& a,
+                                      const SceneEntities& b) const {
+    if (a.instances.size() != b.instances.size() ||
+        a.groups.size() != b.groups.size()) {
+        return false;
+    }
+    if (!_sameMesh(a.mesh, b.mesh) || !_sameCurves(a.edges, b.edges) ||
+        !_sameCurves(a.curves, b.curves) ||
+        !_sameCurves(a.polylines, b.polylines)) {
+        return false;
+    }
+    for (size_t i = 0; i < a.instances.size(); i++) {
+        const SceneInstance& instanceA = a.instances[i];
+        const SceneInstance& instanceB = b.instances[i];
+        if (GetCanonicalKey(instanceA.definition) !=
+            GetCanonicalKey(instanceB.definition) ||
+            _look(instanceA.material) != _look(instanceB.material) ||
+            !_sameTransform(instanceA.transform, instanceB.transform)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.groups.size(); i++) {
+        const SceneGroup& groupA = a.groups[i];
+        const SceneGroup& groupB = b.groups[i];
+        if (groupA.name != groupB.name ||
+            !_sameTransform(groupA.transform, groupB.transform) ||
+            !groupA.entities != !groupB.entities) {
+            return false;
+        }
+        if (groupA.entities &&
+            !_sameEntities(*groupA.entities, *groupB.entities)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+DefinitionDeduplicator::_sameMesh(const SceneMesh& a, const SceneMesh& b) const {
+    return _sameArray(a.points, b.points) &&
+        _sameArray(a.faceVertexCounts, b.faceVertexCounts) &&
+        _sameArray(a.faceVertexIndices, b.faceVertexIndices) &&
+        _sameArray(a.normals, b.normals) &&
+        _sameArray(a.frontUVs, b.frontUVs) &&
+        _sameArray(a.backUVs, b.backUVs) &&
+        _sameMaterials(a.frontMaterials, b.frontMaterials) &&
+        _sameMaterials(a.backMaterials, b.backMaterials);
+}
+
+bool
+DefinitionDeduplicator::_sameMaterials(const std::vector<int>& a,
+                                       const std::vector<int>& b) const {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (_look(a[i]) != _look(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
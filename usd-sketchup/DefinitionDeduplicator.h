@@ -0,0 +1,81 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  DefinitionDeduplicator.h
+//
+// Finds the component definitions that are copies of one another, like the
+// "Chair", "Chair#1" and "Chair#2" that importing the same model a few times
+// leaves behind, so that all their instances can share a single master.
+//
+// Two definitions are the same if everything we'd write for them is: the
+// same geometry, point for point, the same materials on the same faces
+// (materials that only differ in name count as the same), and instances of
+// the same definitions in the same places. Each definition is hashed from
+// that first, and only the ones whose hashes match are compared in full.
+// Their names don't matter.
+
+#ifndef DefinitionDeduplicator_h
+#define DefinitionDeduplicator_h
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+#include "SketchUpScene.h"
+
+class DefinitionDeduplicator {
+public:
+    DefinitionDeduplicator();
+    ~DefinitionDeduplicator();
+
+    // returns the number of definitions that are copies of another
+    size_t Find(const SketchUpScene& scene);
+    void Clear();
+
+    // the definition whose master should be used for the one with key,
+    // which is key itself unless it's a copy
+    uintptr_t GetCanonicalKey(uintptr_t key) const;
+    size_t GetDuplicatesCount() const;
+
+private:
+    const SketchUpScene* _scene;
+    // for each material, the first one that looks the same
+    std::vector<int> _looks;
+    // only the copies are in here
+    std::map<uintptr_t, uintptr_t> _canonicalKeys;
+    // definitions we've hashed, or are hashing, so far
+    std::map<uintptr_t, size_t> _hashes;
+
+    void _findLooks();
+    void _visit(const SceneDefinition& definition,
+                std::map<size_t, std::vector<const SceneDefinition*>>& byHash);
+    int _look(int material) const;
+
+    size_t _hashEntities(const SceneEntities& entities) const;
+    size_t _hashMesh(const SceneMesh& mesh) const;
+    bool _sameEntities(const SceneEntities& a, const SceneEntities& b) const;
+    bool _sameMesh(const SceneMesh& a, const SceneMesh& b) const;
+    bool _sameMaterials(const std::vector<int>& a,
+                        const std::vector<int>& b) const;
+};
+
+#endif /* DefinitionDeduplicator_h */
@@ -0,0 +1,134 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  GeometryConversion.cpp
+//
+#include "GeometryConversion.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// SketchUp thinks in inches, we want centimeters
+static double inchesToCM = 2.54;
+
+// We treat the arrays as flat runs of doubles and floats, which only works
+// because neither side has any padding.
+static_assert(sizeof(SUPoint3D) == 3 * sizeof(double), "SUPoint3D is padded");
+static_assert(sizeof(SUVector3D) == 3 * sizeof(double), "SUVector3D is padded");
+static_assert(sizeof(pxr::GfVec3f) == 3 * sizeof(float), "GfVec3f is padded");
+static_assert(sizeof(pxr::GfVec2f) == 2 * sizeof(float), "GfVec2f is padded");
+
+// result[i] = scale * values[i], for count values
+static void
+_scaleToFloats(const double* values, size_t count, double scale,
+               float* result) {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256d s = _mm256_set1_pd(scale);
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_mul_pd(_mm256_loadu_pd(values + i), s);
+        _mm_storeu_ps(result + i, _mm256_cvtpd_ps(v));
+    }
+#elif defined(__SSE2__)
+    const __m128d s = _mm_set1_pd(scale);
+    for (; i + 4 <= count; i += 4) {
+        __m128 low = _mm_cvtpd_ps(_mm_mul_pd(_mm_loadu_pd(values + i), s));
+        __m128 high = _mm_cvtpd_ps(_mm_mul_pd(_mm_loadu_pd(values + i + 2), s));
+        _mm_storeu_ps(result + i, _mm_movelh_ps(low, high));
+    }
+#endif
+    for (; i < count; i++) {
+        result[i] = float(scale * values[i]);
+    }
+}
+
+void
+ConvertPointsToCM(const SUPoint3D* points, size_t count,
+                  pxr::GfVec3f* result) {
+    if (!count) {
+        return ;
+    }
+    _scaleToFloats(&points->x, 3 * count, inchesToCM, result->data());
+}
+
+void
+ConvertVectors(const SUVector3D* vectors, size_t count,
+               pxr::GfVec3f* result) {
+    if (!count) {
+        return ;
+    }
+    _scaleToFloats(&vectors->x, 3 * count, 1.0, result->data());
+}
+
+void
+ConvertSTQsToUVs(const SUPoint3D* stqs, size_t count,
+                 pxr::GfVec2f* result) {
+    if (!count) {
+        return ;
+    }
+    const double* values = &stqs->x;
+    float* uvs = result->data();
+    size_t i = 0;
+#if defined(__SSE2__)
+    // two at a time: each load picks up the s and t of one coordinate
+    for (; i + 2 <= count; i += 2) {
+        __m128 first = _mm_cvtpd_ps(_mm_loadu_pd(values + 3 * i));
+        __m128 second = _mm_cvtpd_ps(_mm_loadu_pd(values + 3 * i + 3));
+        _mm_storeu_ps(uvs + 2 * i, _mm_movelh_ps(first, second));
+    }
+#endif
+    for (; i < count; i++) {
+        uvs[2 * i] = float(values[3 * i]);
+        uvs[2 * i + 1] = float(values[3 * i + 1]);
+    }
+}
+
+void
+NegateVectors(const pxr::GfVec3f* vectors, size_t count,
+              pxr::GfVec3f* result) {
+    if (!count) {
+        return ;
+    }
+    const float* values = vectors->data();
+    float* negated = result->data();
+    const size_t numValues = 3 * count;
+    size_t i = 0;
+    // flipping the sign bit is all negation is
+#if defined(__AVX__)
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    for (; i + 8 <= numValues; i += 8) {
+        _mm256_storeu_ps(negated + i,
+                         _mm256_xor_ps(_mm256_loadu_ps(values + i), sign));
+    }
+#elif defined(__SSE2__)
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= numValues; i += 4) {
+        _mm_storeu_ps(negated + i, _mm_xor_ps(_mm_loadu_ps(values + i), sign));
+    }
+#endif
+    for (; i < numValues; i++) {
+        negated[i] = -values[i];
+    }
+}
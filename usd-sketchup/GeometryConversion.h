@@ -0,0 +1,54 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  GeometryConversion.h
+//
+// Bulk conversions from the double precision geometry the SketchUp API hands
+// us to the packed float arrays we write to USD. These are the inner loops of
+// reading faces, edges, curves and polylines, so they're vectorized with
+// SSE2, or AVX when we're built with it, and fall back to plain loops
+// otherwise. Every version gives exactly the same results as the plain one:
+// multiply in double, then round to float.
+
+#ifndef GeometryConversion_h
+#define GeometryConversion_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <stdio.h>
+
+#include "pxr/base/gf/vec2f.h"
+#include "pxr/base/gf/vec3f.h"
+
+// SketchUp points are in inches, the ones we write are in cm
+void ConvertPointsToCM(const SUPoint3D* points, size_t count,
+                       pxr::GfVec3f* result);
+void ConvertVectors(const SUVector3D* vectors, size_t count,
+                    pxr::GfVec3f* result);
+// keeps the s and t of each STQ coordinate
+void ConvertSTQsToUVs(const SUPoint3D* stqs, size_t count,
+                      pxr::GfVec2f* result);
+// result can be the same as vectors
+void NegateVectors(const pxr::GfVec3f* vectors, size_t count,
+                   pxr::GfVec3f* result);
+
+#endif /* GeometryConversion_h */
@@ -0,0 +1,317 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  MeshCleaner.cpp
+//
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+#include "MeshCleaner.h"
+
+#pragma mark Helper definitions:
+
+// A polygon counts as having no area when its sides are this close to
+// parallel (it's the sine of the angle between them, more or less).
+static const double flatness = 1.0e-6;
+
+// points are compared bit for bit, with -0 and +0 the same
+struct _PositionKey {
+    unsigned int x, y, z;
+
+    bool operator==(const _PositionKey& other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct _PositionKeyHash {
+    size_t operator()(const _PositionKey& key) const {
+        size_t h = key.x;
+        h = h * 1000003 ^ key.y;
+        return h * 1000003 ^ key.z;
+    }
+};
+
+static unsigned int
+_floatBits(float value) {
+    value += 0.0f;
+    unsigned int bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void
+NumberPositions(const pxr::GfVec3f* points, size_t numPoints,
+                std::vector<int>& positions) {
+    positions.resize(numPoints);
+    std::unordered_map<_PositionKey, int, _PositionKeyHash> numbers;
+    numbers.reserve(numPoints);
+    for (size_t i = 0; i < numPoints; i++) {
+        const pxr::GfVec3f& p = points[i];
+        _PositionKey key = {_floatBits(p[0]), _floatBits(p[1]),
+                            _floatBits(p[2])};
+        positions[i] = numbers.insert(
+            std::make_pair(key, (int)numbers.size())).first->second;
+    }
+}
+
+#pragma mark MeshCleaner class:
+
+MeshCleaner::MeshCleaner() : _degenerateFacesCount(0),
+                             _duplicateFacesCount(0),
+                             _unusedPointsCount(0),
+                             _indices(nullptr) {
+}
+
+MeshCleaner::~MeshCleaner() {
+}
+
+size_t
+MeshCleaner::GetDegenerateFacesCount() const {
+    return _degenerateFacesCount;
+}
+
+size_t
+MeshCleaner::GetDuplicateFacesCount() const {
+    return _duplicateFacesCount;
+}
+
+size_t
+MeshCleaner::GetUnusedPointsCount() const {
+    return _unusedPointsCount;
+}
+
+bool
+MeshCleaner::Clean(pxr::VtArray<pxr::GfVec3f>& points,
+                   pxr::VtArray<pxr::GfVec3f>& normals,
+                   pxr::VtArray<pxr::GfVec2f>& frontUVs,
+                   pxr::VtArray<pxr::GfVec2f>& backUVs,
+                   pxr::VtArray<int>& faceVertexCounts,
+                   pxr::VtArray<int>& faceVertexIndices,
+                   std::vector<int>& frontMaterials,
+                   std::vector<int>& backMaterials) {
+    _degenerateFacesCount = 0;
+    _duplicateFacesCount = 0;
+    _unusedPointsCount = 0;
+    const size_t numPoints = points.size();
+    const size_t numFaces = faceVertexCounts.size();
+    const pxr::GfVec3f* inPoints = points.cdata();
+    const int* inCounts = faceVertexCounts.cdata();
+    const int* inIndices = faceVertexIndices.cdata();
+    _indices = inIndices;
+
+    // The same position can be more than one point (with different UVs,
+    // say), so polygons are compared by position rather than by point.
+    NumberPositions(inPoints, numPoints, _positions);
+    _firstIndices.resize(numFaces);
+    _keep.assign(numFaces, true);
+    size_t start = 0;
+    for (size_t f = 0; f < numFaces; f++) {
+        _firstIndices[f] = start;
+        if (_isDegenerate(inPoints, inIndices + start, inCounts[f])) {
+            _keep[f] = false;
+            _degenerateFacesCount++;
+        }
+        start += inCounts[f];
+    }
+    _findDuplicates(inCounts, numFaces);
+
+    // every point a polygon we keep uses, and where it ends up
+    std::vector<int> newPoints(numPoints, -1);
+    size_t numKeptPoints = 0;
+    size_t numKeptIndices = 0;
+    for (size_t f = 0; f < numFaces; f++) {
+        if (!_keep[f]) {
+            continue;
+        }
+        const int* indices = inIndices + _firstIndices[f];
+        for (int i = 0; i < inCounts[f]; i++) {
+            if (newPoints[indices[i]] < 0) {
+                newPoints[indices[i]] = 0;
+                numKeptPoints++;
+            }
+        }
+        numKeptIndices += inCounts[f];
+    }
+    _unusedPointsCount = numPoints - numKeptPoints;
+    const size_t numRemovedFaces = _degenerateFacesCount + _duplicateFacesCount;
+    if (!numRemovedFaces && !_unusedPointsCount) {
+        return false;
+    }
+
+    int nextPoint = 0;
+    for (size_t i = 0; i < numPoints; i++) {
+        if (newPoints[i] >= 0) {
+            newPoints[i] = nextPoint++;
+        }
+    }
+    pxr::VtArray<int> counts(numFaces - numRemovedFaces);
+    pxr::VtArray<int> indices(numKeptIndices);
+    int* outCounts = counts.data();
+    int* outIndices = indices.data();
+    size_t keptFaces = 0;
+    for (size_t f = 0; f < numFaces; f++) {
+        if (!_keep[f]) {
+            continue;
+        }
+        const int* faceIndices = inIndices + _firstIndices[f];
+        for (int i = 0; i < inCounts[f]; i++) {
+            *outIndices++ = newPoints[faceIndices[i]];
+        }
+        *outCounts++ = inCounts[f];
+        frontMaterials[keptFaces] = frontMaterials[f];
+        backMaterials[keptFaces] = backMaterials[f];
+        keptFaces++;
+    }
+    frontMaterials.resize(keptFaces);
+    backMaterials.resize(keptFaces);
+    faceVertexCounts.swap(counts);
+    faceVertexIndices.swap(indices);
+
+    if (_unusedPointsCount) {
+        auto compact = [&newPoints, numPoints, numKeptPoints](auto& values) {
+            if (values.size() != numPoints) {
+                return ;
+            }
+            typename std::remove_reference<decltype(values)>::type
+                kept(numKeptPoints);
+            auto* in = values.cdata();
+            auto* out = kept.data();
+            for (size_t i = 0; i < numPoints; i++) {
+                if (newPoints[i] >= 0) {
+                    out[newPoints[i]] = in[i];
+                }
+            }
+            values.swap(kept);
+        };
+        compact(points);
+        compact(normals);
+        compact(frontUVs);
+        compact(backUVs);
+    }
+    return true;
+}
+
+// Fewer than three different positions, or (checked with the cross product
+// of every pair of sides, which for a triangle is just twice its area)
+// no area to speak of.
+bool
+MeshCleaner::_isDegenerate(const pxr::GfVec3f* points, const int* indices,
+                           int count) const {
+    if (count < 3) {
+        return true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (_positions[indices[i]] == _positions[indices[(i + 1) % count]]) {
+            return true;
+        }
+    }
+    // Newell's method, from the first point so that it stays precise
+    const pxr::GfVec3f& o = points[indices[0]];
+    double nx = 0.0, ny = 0.0, nz = 0.0, perimeter = 0.0;
+    for (int i = 0; i < count; i++) {
+        const pxr::GfVec3f& p = points[indices[i]];
+        const pxr::GfVec3f& q = points[indices[(i + 1) % count]];
+        const double px = p[0] - o[0], py = p[1] - o[1], pz = p[2] - o[2];
+        const double qx = q[0] - o[0], qy = q[1] - o[1], qz = q[2] - o[2];
+        nx += py * qz - pz * qy;
+        ny += pz * qx - px * qz;
+        nz += px * qy - py * qx;
+        const double dx = qx - px, dy = qy - py, dz = qz - pz;
+        perimeter += std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+    const double area = std::sqrt(nx * nx + ny * ny + nz * nz);
+    return area <= flatness * perimeter * perimeter;
+}
+
+// A polygon repeats another if it goes through the same positions the same
+// way round, starting anywhere. The first one of them is kept. Polygons that
+// go the other way round face the other way, so they're not repeats.
+void
+MeshCleaner::_findDuplicates(const int* counts, size_t numFaces) {
+    // each polygon is compared from its smallest position onwards
+    std::vector<size_t> starts(numFaces, 0);
+    std::vector<std::pair<size_t, size_t>> hashes;
+    hashes.reserve(numFaces);
+    for (size_t f = 0; f < numFaces; f++) {
+        if (!_keep[f]) {
+            continue;
+        }
+        const size_t first = _firstIndices[f];
+        const int count = counts[f];
+        size_t smallest = 0;
+        for (int i = 1; i < count; i++) {
+            if (_positions[_indices[first + i]] <
+                _positions[_indices[first + smallest]]) {
+                smallest = i;
+            }
+        }
+        starts[f] = smallest;
+        size_t h = (size_t)count;
+        for (int i = 0; i < count; i++) {
+            h = h * 1000003 ^
+                (size_t)_positions[_indices[first + (smallest + i) % count]];
+        }
+        hashes.push_back(std::make_pair(h, f));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    for (size_t i = 0; i < hashes.size(); ) {
+        size_t end = i + 1;
+        while (end < hashes.size() && hashes[end].first == hashes[i].first) {
+            end++;
+        }
+        // almost always on its own, or with the one it repeats
+        for (size_t j = i + 1; j < end; j++) {
+            for (size_t k = i; k < j; k++) {
+                if (_keep[hashes[k].second] &&
+                    _samePolygon(hashes[k].second, hashes[j].second,
+                                 counts, starts)) {
+                    _keep[hashes[j].second] = false;
+                    _duplicateFacesCount++;
+                    break;
+                }
+            }
+        }
+        i = end;
+    }
+}
+
+bool
+MeshCleaner::_samePolygon(size_t a, size_t b, const int* counts,
+                          const std::vector<size_t>& starts) const {
+    const int count = counts[a];
+    if (counts[b] != count) {
+        return false;
+    }
+    const size_t firstA = _firstIndices[a];
+    const size_t firstB = _firstIndices[b];
+    for (int i = 0; i < count; i++) {
+        const int pa = _indices[firstA + (starts[a] + i) % count];
+        const int pb = _indices[firstB + (starts[b] + i) % count];
+        if (_positions[pa] != _positions[pb]) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  MeshCleaner.h
+//
+// Cleans up the geometry that comes out of SketchUp before we write it: it
+// removes polygons with no area, polygons that exactly repeat an earlier
+// one (e.g. the stacked copies of faces that imported CAD files are full
+// of), and then any points no polygon uses any more. Everything that goes
+// per polygon or per point is kept in step with what is removed.
+//
+// A cleaner is meant to be used for one mesh: it's cheap to make, and the
+// counts describe the last mesh it cleaned.
+
+#ifndef MeshCleaner_h
+#define MeshCleaner_h
+
+#include <stdio.h>
+#include <vector>
+
+#include "pxr/base/gf/vec2f.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/vt/array.h"
+
+// Numbers the distinct positions of points, in the order they first appear,
+// so that points that are in exactly the same place get the same number.
+void NumberPositions(const pxr::GfVec3f* points, size_t numPoints,
+                     std::vector<int>& positions);
+
+class MeshCleaner {
+public:
+    MeshCleaner();
+    ~MeshCleaner();
+
+    // The normals and back UVs can be empty. Returns false, without
+    // touching any of the arrays, if there was nothing to remove.
+    bool Clean(pxr::VtArray<pxr::GfVec3f>& points,
+               pxr::VtArray<pxr::GfVec3f>& normals,
+               pxr::VtArray<pxr::GfVec2f>& frontUVs,
+               pxr::VtArray<pxr::GfVec2f>& backUVs,
+               pxr::VtArray<int>& faceVertexCounts,
+               pxr::VtArray<int>& faceVertexIndices,
+               std::vector<int>& frontMaterials,
+               std::vector<int>& backMaterials);
+
+    size_t GetDegenerateFacesCount() const;
+    size_t GetDuplicateFacesCount() const;
+    size_t GetUnusedPointsCount() const;
+
+private:
+    size_t _degenerateFacesCount;
+    size_t _duplicateFacesCount;
+    size_t _unusedPointsCount;
+
+    // the mesh being cleaned, and scratch space per point and per polygon
+    const int* _indices;
+    std::vector<int> _positions;
+    std::vector<size_t> _firstIndices;
+    std::vector<bool> _keep;
+
+    bool _isDegenerate(const pxr::GfVec3f* points, const int* indices,
+                       int count) const;
+    void _findDuplicates(const int* counts, size_t numFaces);
+    bool _samePolygon(size_t a, size_t b, const int* counts,
+                      const std::vector<size_t>& starts) const;
+};
+
+#endif /* MeshCleaner_h */
@@ -21,47 +21,59 @@
 // KIND, either express or implied. See the Apache License for the specific
 // language governing permissions and limitations under the Apache License.
 
+#include <algorithm>
+#include <utility>
+
 #include "MeshSubset.h"
 
 MeshSubset::MeshSubset(std::string materialTextureName,
                        pxr::GfVec3f rgb, float opacity,
                        pxr::VtArray<int> faceIndices) :
-_materialTextureName(materialTextureName),
-_rgb(rgb), _opacity(opacity),
-_faceIndices(faceIndices) {
+_materialTextureName(std::move(materialTextureName)),
+_faceIndices(std::move(faceIndices)),
+_rgb(rgb), _opacity(opacity) {
 }
 
 MeshSubset::~MeshSubset() {
 }
 
-const std::string
-MeshSubset::GetMaterialTextureName() {
+const std::string&
+MeshSubset::GetMaterialTextureName() const {
     return _materialTextureName;
 }
 
-const pxr::GfVec3f
-MeshSubset::GetRGB() {
+const pxr::GfVec3f&
+MeshSubset::GetRGB() const {
     return _rgb;
 }
 
-const float
-MeshSubset::GetOpacity() {
+float
+MeshSubset::GetOpacity() const {
     return _opacity;
 }
 
-
-const pxr::VtArray<int>
-MeshSubset::GetFaceIndices() {
+const pxr::VtArray<int>&
+MeshSubset::GetFaceIndices() const {
     return _faceIndices;
 }
 
-pxr::SdfPath
-MeshSubset::GetMaterialPath() {
+const pxr::SdfPath&
+MeshSubset::GetMaterialPath() const {
     return _materialPath;
 }
 
 void
-MeshSubset::SetMaterialPath(pxr::SdfPath path) {
-    _materialPath = pxr::SdfPath(path);
+MeshSubset::SetMaterialPath(const pxr::SdfPath& path) {
+    _materialPath = path;
+}
+
+void
+MeshSubset::AppendFaceIndices(const pxr::VtArray<int>& faceIndices) {
+    if (faceIndices.empty()) {
+        return ;
+    }
+    const size_t size = _faceIndices.size();
+    _faceIndices.resize(size + faceIndices.size());
+    std::copy(faceIndices.cbegin(), faceIndices.cend(),
+              _faceIndices.data() + size);
 }
-//
@@ -27,21 +27,29 @@
 #include <stdio.h>
 #include "pxr/usd/usdGeom/mesh.h"
 
+// The faces of a mesh that one material is bound to. Subsets are moved
+// around rather than copied, and the getters hand out references, so the
+// face indices are only ever copied when subsets are coalesced.
 class MeshSubset {
 public:
     MeshSubset(std::string materialTextureName,
                pxr::GfVec3f rgb, float opacity,
                pxr::VtArray<int> faceIndices);
     ~MeshSubset();
-    //MeshSubset(const MeshSubset&) = delete;
-    
-    const std::string GetMaterialTextureName();
-    const pxr::GfVec3f GetRGB();
-    const float GetOpacity();
-    const pxr::VtArray<int> GetFaceIndices();
-    pxr::SdfPath GetMaterialPath();
-    void SetMaterialPath(pxr::SdfPath path);
-    
+    MeshSubset(const MeshSubset&) = default;
+    MeshSubset(MeshSubset&&) = default;
+    MeshSubset& operator=(const MeshSubset&) = default;
+    MeshSubset& operator=(MeshSubset&&) = default;
+
+    const std::string& GetMaterialTextureName() const;
+    const pxr::GfVec3f& GetRGB() const;
+    float GetOpacity() const;
+    const pxr::VtArray<int>& GetFaceIndices() const;
+    const pxr::SdfPath& GetMaterialPath() const;
+    void SetMaterialPath(const pxr::SdfPath& path);
+    // adds the faces of another subset bound to the same material
+    void AppendFaceIndices(const pxr::VtArray<int>& faceIndices);
+
 private:
     std::string _materialTextureName;
     pxr::VtArray<int> _faceIndices;
@@ -0,0 +1,238 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  MeshWelder.cpp
+//
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "MeshWelder.h"
+
+#pragma mark Helper definitions:
+
+// The spatial hash is a grid of cells the size of the tolerance, so two
+// points that can be merged are always in the same or in neighbouring cells.
+// With no tolerance the "cell" is the point itself.
+struct _Cell {
+    long long x, y, z;
+
+    bool operator==(const _Cell& other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct _CellHash {
+    size_t operator()(const _Cell& cell) const {
+        size_t h = std::hash<long long>()(cell.x);
+        h = h * 1000003 ^ std::hash<long long>()(cell.y);
+        return h * 1000003 ^ std::hash<long long>()(cell.z);
+    }
+};
+
+static long long
+_floatBits(float value) {
+    // adding 0 turns -0 into +0, so the two end up in the same cell
+    value += 0.0f;
+    int bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static bool
+_near(float a, float b, float tolerance) {
+    return std::fabs(a - b) <= tolerance;
+}
+
+template <class V>
+static bool
+_near(const V& a, const V& b, float tolerance) {
+    for (size_t i = 0; i < V::dimension; i++) {
+        if (!_near(a[i], b[i], tolerance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// How far apart the normals and UVs of two vertices can be for them to be
+// merged, when the points are welded with a tolerance. Just enough for float
+// rounding: anything more is a hard edge or a texture seam.
+static const float _attributeTolerance = 1.0e-5f;
+
+// past this many tolerances from the origin a cell no longer fits in a
+// long long (2^62, with room for the neighbouring cells)
+static const double _maxCells = 4.6e18;
+
+#pragma mark MeshWelder class:
+
+MeshWelder::MeshWelder() : _tolerance(0.0f) {
+}
+
+MeshWelder::~MeshWelder() {
+}
+
+float
+MeshWelder::GetTolerance() const {
+    return _tolerance;
+}
+
+void
+MeshWelder::SetTolerance(float tolerance) {
+    _tolerance = (tolerance > 0.0f) ? tolerance : 0.0f;
+}
+
+bool
+MeshWelder::Weld(const SceneMesh& mesh,
+                 pxr::VtArray<pxr::GfVec3f>& points,
+                 pxr::VtArray<pxr::GfVec3f>& normals,
+                 pxr::VtArray<pxr::GfVec2f>& frontUVs,
+                 pxr::VtArray<pxr::GfVec2f>& backUVs,
+                 pxr::VtArray<int>& faceVertexIndices) const {
+    const size_t numVertices = mesh.points.size();
+    if (numVertices < 2) {
+        return false;
+    }
+    const pxr::GfVec3f* inPoints = mesh.points.cdata();
+    const pxr::GfVec2f* inFrontUVs = mesh.frontUVs.cdata();
+    const pxr::GfVec3f* inNormals = mesh.normals.empty() ?
+        NULL : mesh.normals.cdata();
+    const pxr::GfVec2f* inBackUVs = mesh.backUVs.empty() ?
+        NULL : mesh.backUVs.cdata();
+    float tolerance = _tolerance;
+    if (tolerance > 0.0f) {
+        // A tolerance that's tiny next to the points would make cells that
+        // don't fit in a long long, in which case it's far below what a
+        // float can tell apart there anyway, so we just weld exactly.
+        float extent = 0.0f;
+        for (size_t i = 0; i < numVertices; i++) {
+            for (size_t k = 0; k < 3; k++) {
+                extent = std::max(extent, std::fabs(inPoints[i][k]));
+            }
+        }
+        // (written so that a NaN point also gets us here)
+        if (!((double)extent / tolerance < _maxCells)) {
+            tolerance = 0.0f;
+        }
+    }
+    // with no tolerance there are no neighbouring cells to look in
+    const int reach = (tolerance > 0.0f) ? 1 : 0;
+    auto cellOf = [tolerance](const pxr::GfVec3f& p) {
+        if (tolerance > 0.0f) {
+            const double size = tolerance;
+            return _Cell{(long long)std::floor(p[0] / size),
+                         (long long)std::floor(p[1] / size),
+                         (long long)std::floor(p[2] / size)};
+        }
+        return _Cell{_floatBits(p[0]), _floatBits(p[1]), _floatBits(p[2])};
+    };
+    // the tolerance is a distance, so it's only for the points
+    const float attributeTolerance = (tolerance > 0.0f) ?
+        _attributeTolerance : 0.0f;
+    auto sameVertex = [&](size_t a, size_t b) {
+        return _near(inPoints[a], inPoints[b], tolerance) &&
+            _near(inFrontUVs[a], inFrontUVs[b], attributeTolerance) &&
+            (!inNormals ||
+             _near(inNormals[a], inNormals[b], attributeTolerance)) &&
+            (!inBackUVs ||
+             _near(inBackUVs[a], inBackUVs[b], attributeTolerance));
+    };
+
+    // Each cell holds the first of a chain of the welded vertices in it, and
+    // the chains are linked through next, so a cell costs one map entry no
+    // matter how many vertices end up in it. The welded vertices are kept
+    // as the index of the mesh vertex they were first seen as.
+    std::unordered_map<_Cell, int, _CellHash> cells;
+    cells.reserve(numVertices);
+    std::vector<int> next;
+    std::vector<size_t> kept;
+    next.reserve(numVertices);
+    kept.reserve(numVertices);
+    std::vector<int> remap(numVertices);
+    for (size_t i = 0; i < numVertices; i++) {
+        const _Cell cell = cellOf(inPoints[i]);
+        int found = -1;
+        for (int dx = -reach; dx <= reach && found < 0; dx++) {
+            for (int dy = -reach; dy <= reach && found < 0; dy++) {
+                for (int dz = -reach; dz <= reach && found < 0; dz++) {
+                    auto chain = cells.find({cell.x + dx, cell.y + dy,
+                                             cell.z + dz});
+                    if (chain == cells.end()) {
+                        continue;
+                    }
+                    for (int w = chain->second; w >= 0; w = next[w]) {
+                        if (sameVertex(kept[w], i)) {
+                            found = w;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (found < 0) {
+            found = (int)kept.size();
+            kept.push_back(i);
+            auto inserted = cells.insert(std::make_pair(cell, found));
+            if (inserted.second) {
+                next.push_back(-1);
+            } else {
+                next.push_back(inserted.first->second);
+                inserted.first->second = found;
+            }
+        }
+        remap[i] = found;
+    }
+    const size_t numWelded = kept.size();
+    if (numWelded == numVertices) {
+        return false;
+    }
+
+    points.resize(numWelded);
+    frontUVs.resize(numWelded);
+    normals.resize(inNormals ? numWelded : 0);
+    backUVs.resize(inBackUVs ? numWelded : 0);
+    pxr::GfVec3f* outPoints = points.data();
+    pxr::GfVec2f* outFrontUVs = frontUVs.data();
+    pxr::GfVec3f* outNormals = inNormals ? normals.data() : NULL;
+    pxr::GfVec2f* outBackUVs = inBackUVs ? backUVs.data() : NULL;
+    for (size_t w = 0; w < numWelded; w++) {
+        const size_t i = kept[w];
+        outPoints[w] = inPoints[i];
+        outFrontUVs[w] = inFrontUVs[i];
+        if (outNormals) {
+            outNormals[w] = inNormals[i];
+        }
+        if (outBackUVs) {
+            outBackUVs[w] = inBackUVs[i];
+        }
+    }
+    const size_t numIndices = mesh.faceVertexIndices.size();
+    faceVertexIndices.resize(numIndices);
+    const int* inIndices = mesh.faceVertexIndices.cdata();
+    int* outIndices = faceVertexIndices.data();
+    for (size_t i = 0; i < numIndices; i++) {
+        outIndices[i] = remap[inIndices[i]];
+    }
+    return true;
+}
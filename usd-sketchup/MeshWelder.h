@@ -0,0 +1,66 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  MeshWelder.h
+//
+// SketchUp triangulates each face on its own, so a vertex shared by several
+// faces comes out once for each of them. The welder merges the vertices of a
+// SceneMesh that have the same point, normal and UVs back into one, and
+// remaps the face vertex indices to match.
+
+#ifndef MeshWelder_h
+#define MeshWelder_h
+
+#include <stdio.h>
+
+#include "SketchUpScene.h"
+
+class MeshWelder {
+public:
+    MeshWelder();
+    ~MeshWelder();
+
+    // With a tolerance of 0 (the default) only vertices that are exactly the
+    // same are merged. Otherwise points that are within tolerance (in cm) of
+    // each other along every axis are merged, as long as their normals and
+    // UVs only differ by float rounding. The tolerance is a distance, so it
+    // is never used for those: that would smooth over hard edges and close
+    // up texture seams. A tolerance too small to make a grid of the mesh's extent with (see
+    // Weld) only merges vertices that are exactly the same.
+    float GetTolerance() const;
+    void SetTolerance(float tolerance);
+
+    // Fills in the welded arrays for mesh. The normals and back UVs stay
+    // empty if they are empty in the mesh. Returns false, leaving the arrays
+    // alone, if no two vertices could be merged.
+    bool Weld(const SceneMesh& mesh,
+              pxr::VtArray<pxr::GfVec3f>& points,
+              pxr::VtArray<pxr::GfVec3f>& normals,
+              pxr::VtArray<pxr::GfVec2f>& frontUVs,
+              pxr::VtArray<pxr::GfVec2f>& backUVs,
+              pxr::VtArray<int>& faceVertexIndices) const;
+
+private:
+    float _tolerance;
+};
+
+#endif /* MeshWelder_h */
@@ -0,0 +1,352 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  PolygonTriangulator.cpp
+//
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "PolygonTriangulator.h"
+
+// whether p is inside or on the triangle abc, whichever way round it goes
+static bool
+_inTriangle(double ax, double ay, double bx, double by, double cx, double cy,
+            double px, double py) {
+    const double d1 = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+    const double d2 = (cx - bx) * (py - by) - (cy - by) * (px - bx);
+    const double d3 = (ax - cx) * (py - cy) - (ay - cy) * (px - cx);
+    return (d1 >= 0.0 && d2 >= 0.0 && d3 >= 0.0) ||
+           (d1 <= 0.0 && d2 <= 0.0 && d3 <= 0.0);
+}
+
+PolygonTriangulator::PolygonTriangulator() {
+}
+
+PolygonTriangulator::~PolygonTriangulator() {
+}
+
+size_t
+PolygonTriangulator::CountTriangles(const size_t* loopSizes, size_t numLoops) {
+    size_t numPoints = 0;
+    for (size_t i = 0; i < numLoops; i++) {
+        numPoints += loopSizes[i];
+    }
+    // every hole adds the two ends of its bridge to the outer loop
+    return numPoints + 2 * (numLoops - 1) - 2;
+}
+
+void
+PolygonTriangulator::Triangulate(const SUPoint3D* points,
+                                 const size_t* loopSizes, size_t numLoops,
+                                 const SUVector3D& normal,
+                                 int offset, int* indices) {
+    size_t numPoints = 0;
+    for (size_t i = 0; i < numLoops; i++) {
+        numPoints += loopSizes[i];
+    }
+    // Drop the biggest axis of the normal, keeping the other two in cyclic
+    // order, so that a loop that goes counter-clockwise around the normal
+    // stays counter-clockwise if that axis is positive.
+    const double ax = std::fabs(normal.x);
+    const double ay = std::fabs(normal.y);
+    const double az = std::fabs(normal.z);
+    _projected.resize(numPoints);
+    if (az >= ax && az >= ay) {
+        const double flip = (normal.z < 0.0) ? -1.0 : 1.0;
+        for (size_t i = 0; i < numPoints; i++) {
+            _projected[i] = {flip * points[i].x, points[i].y};
+        }
+    } else if (ax >= ay) {
+        const double flip = (normal.x < 0.0) ? -1.0 : 1.0;
+        for (size_t i = 0; i < numPoints; i++) {
+            _projected[i] = {flip * points[i].y, points[i].z};
+        }
+    } else {
+        const double flip = (normal.y < 0.0) ? -1.0 : 1.0;
+        for (size_t i = 0; i < numPoints; i++) {
+            _projected[i] = {flip * points[i].z, points[i].x};
+        }
+    }
+
+    // The outer loop goes counter-clockwise and the holes clockwise, which
+    // is how SketchUp hands them to us, but we don't count on it.
+    _nodes.clear();
+    _nodes.reserve(numPoints + 2 * numLoops);
+    int outer = _linkLoop(_projected, 0, loopSizes[0], true);
+    _holes.clear();
+    size_t start = loopSizes[0];
+    for (size_t i = 1; i < numLoops; i++) {
+        int hole = _linkLoop(_projected, start, loopSizes[i], false);
+        // each hole is bridged from its rightmost point
+        int rightmost = hole;
+        int node = hole;
+        do {
+            if (_nodes[node].x > _nodes[rightmost].x) {
+                rightmost = node;
+            }
+            node = _nodes[node].next;
+        } while (node != hole);
+        _holes.push_back(std::make_pair(_nodes[rightmost].x, rightmost));
+        start += loopSizes[i];
+    }
+    // Going from right to left, each hole can bridge to the ones before it
+    // as if they were part of the outer loop, since they now are.
+    std::sort(_holes.begin(), _holes.end(),
+              [](const std::pair<double, int>& a,
+                 const std::pair<double, int>& b) {
+        return a.first > b.first;
+    });
+    for (auto& hole : _holes) {
+        int bridge = _findBridge(hole.second, outer);
+        _splitPolygon(bridge, hole.second);
+    }
+
+    // Clip ears until there's a triangle left. If we go all the way around
+    // without finding one, the next time around takes the ears that only
+    // touch other points, and after that whatever is left, so that we
+    // always end up with the number of triangles we promised.
+    int* triangle = indices;
+    int remaining = (int)numPoints + 2 * (int)(numLoops - 1);
+    int ear = outer;
+    int stop = ear;
+    int pass = 0;
+    while (remaining > 3) {
+        const int prev = _nodes[ear].prev;
+        const int next = _nodes[ear].next;
+        if (pass == 2 || _isEar(ear, pass == 0)) {
+            *triangle++ = offset + _nodes[prev].index;
+            *triangle++ = offset + _nodes[ear].index;
+            *triangle++ = offset + _nodes[next].index;
+            _nodes[prev].next = next;
+            _nodes[next].prev = prev;
+            remaining--;
+            // going on from two along tends to leave fewer slivers
+            ear = _nodes[next].next;
+            stop = ear;
+            pass = 0;
+            continue;
+        }
+        ear = next;
+        if (ear == stop) {
+            pass++;
+        }
+    }
+    *triangle++ = offset + _nodes[_nodes[ear].prev].index;
+    *triangle++ = offset + _nodes[ear].index;
+    *triangle++ = offset + _nodes[_nodes[ear].next].index;
+}
+
+// Adds a loop to _nodes going the requested way round, and returns one of
+// its nodes.
+int
+PolygonTriangulator::_linkLoop(const std::vector<std::pair<double, double>>& xy,
+                               size_t start, size_t count,
+                               bool counterClockwise) {
+    double area = 0.0;
+    for (size_t i = 0, j = count - 1; i < count; j = i++) {
+        area += (xy[start + j].first - xy[start + i].first) *
+                (xy[start + i].second + xy[start + j].second);
+    }
+    const bool reverse = (area > 0.0) != counterClockwise;
+    const int first = (int)_nodes.size();
+    for (size_t i = 0; i < count; i++) {
+        const size_t point = start + (reverse ? count - 1 - i : i);
+        _Node node;
+        node.index = (int)point;
+        node.x = xy[point].first;
+        node.y = xy[point].second;
+        node.prev = first + (int)((i + count - 1) % count);
+        node.next = first + (int)((i + 1) % count);
+        _nodes.push_back(node);
+    }
+    return first;
+}
+
+// Finds a point on the outer loop that can be seen from the hole's rightmost
+// point: cast a ray to the right, take the nearest edge it hits, and the
+// right end of that edge, unless some reflex point is in the way, in which
+// case the one closest to the ray is.
+int
+PolygonTriangulator::_findBridge(int hole, int outer) const {
+    const double hx = _nodes[hole].x;
+    const double hy = _nodes[hole].y;
+    double qx = std::numeric_limits<double>::infinity();
+    int candidate = -1;
+    int p = outer;
+    do {
+        const _Node& a = _nodes[p];
+        const _Node& b = _nodes[a.next];
+        if ((a.y <= hy && hy <= b.y) || (b.y <= hy && hy <= a.y)) {
+            double x;
+            int end;
+            if (a.y == b.y) {
+                // along the ray, so it first gets to the nearer end
+                end = (a.x < b.x) ? p : a.next;
+                x = _nodes[end].x;
+            } else {
+                x = a.x + (hy - a.y) * (b.x - a.x) / (b.y - a.y);
+                if (x == a.x && hy == a.y) {
+                    end = p;
+                } else if (x == b.x && hy == b.y) {
+                    end = a.next;
+                } else {
+                    end = (a.x > b.x) ? p : a.next;
+                }
+            }
+            if (x >= hx && x < qx) {
+                qx = x;
+                candidate = end;
+            }
+        }
+        p = _nodes[p].next;
+    } while (p != outer);
+
+    if (candidate < 0) {
+        // the hole isn't inside the outer loop: just take the nearest point
+        double best = std::numeric_limits<double>::infinity();
+        p = outer;
+        do {
+            const double dx = _nodes[p].x - hx;
+            const double dy = _nodes[p].y - hy;
+            if (dx * dx + dy * dy < best) {
+                best = dx * dx + dy * dy;
+                candidate = p;
+            }
+            p = _nodes[p].next;
+        } while (p != outer);
+        return candidate;
+    }
+
+    // anything in the triangle between the hole point, where the ray hit
+    // and the candidate would block the bridge
+    const double mx = _nodes[candidate].x;
+    const double my = _nodes[candidate].y;
+    int bridge = candidate;
+    double bestTan = std::numeric_limits<double>::infinity();
+    double bestX = std::numeric_limits<double>::infinity();
+    p = outer;
+    do {
+        const _Node& n = _nodes[p];
+        if (p != candidate && n.x > hx && n.x <= std::max(qx, mx) &&
+            _inTriangle(hx, hy, qx, hy, mx, my, n.x, n.y)) {
+            // of those, the one closest to the ray can be seen
+            const double tan = std::fabs(n.y - hy) / (n.x - hx);
+            if ((tan < bestTan || (tan == bestTan && n.x < bestX)) &&
+                _locallyInside(p, hole)) {
+                bestTan = tan;
+                bestX = n.x;
+                bridge = p;
+            }
+        }
+        p = _nodes[p].next;
+    } while (p != outer);
+    if (bridge == candidate) {
+        // A point that an earlier bridge duplicated shows up twice, and only
+        // one of the two looks out onto this hole.
+        p = outer;
+        do {
+            if (p != candidate && _nodes[p].x == mx && _nodes[p].y == my &&
+                _locallyInside(p, hole) && !_locallyInside(candidate, hole)) {
+                return p;
+            }
+            p = _nodes[p].next;
+        } while (p != outer);
+    }
+    return bridge;
+}
+
+// Joins the hole that b is on into the loop a is on, going a, b, around the
+// hole back to b, and then back to a. Both a and b get a second node for the
+// way back.
+void
+PolygonTriangulator::_splitPolygon(int a, int b) {
+    const int a2 = (int)_nodes.size();
+    _nodes.push_back(_nodes[a]);
+    const int b2 = (int)_nodes.size();
+    _nodes.push_back(_nodes[b]);
+    const int an = _nodes[a].next;
+    const int bp = _nodes[b].prev;
+
+    _nodes[a].next = b;
+    _nodes[b].prev = a;
+    _nodes[a2].next = an;
+    _nodes[an].prev = a2;
+    _nodes[b2].next = a2;
+    _nodes[a2].prev = b2;
+    _nodes[bp].next = b2;
+    _nodes[b2].prev = bp;
+}
+
+double
+PolygonTriangulator::_orient(int a, int b, int c) const {
+    const _Node& p = _nodes[a];
+    const _Node& q = _nodes[b];
+    const _Node& r = _nodes[c];
+    return (q.x - p.x) * (r.y - p.y) - (q.y - p.y) * (r.x - p.x);
+}
+
+// whether the diagonal from a to b starts off inside the polygon
+bool
+PolygonTriangulator::_locallyInside(int a, int b) const {
+    const int prev = _nodes[a].prev;
+    const int next = _nodes[a].next;
+    if (_orient(prev, a, next) >= 0.0) {
+        return _orient(a, next, b) >= 0.0 && _orient(a, b, prev) >= 0.0;
+    }
+    return !(_orient(a, prev, b) > 0.0 && _orient(a, b, next) > 0.0);
+}
+
+// An ear is a convex corner with no other point of the polygon in it. The
+// strict test also won't have points on its edges, or flat corners.
+bool
+PolygonTriangulator::_isEar(int ear, bool strict) const {
+    const int a = _nodes[ear].prev;
+    const int c = _nodes[ear].next;
+    const double area = _orient(a, ear, c);
+    if (strict ? area <= 0.0 : area < 0.0) {
+        return false;
+    }
+    const _Node& na = _nodes[a];
+    const _Node& nb = _nodes[ear];
+    const _Node& nc = _nodes[c];
+    for (int p = _nodes[c].next; p != a; p = _nodes[p].next) {
+        const _Node& n = _nodes[p];
+        // the other ends of a bridge are where the corners are
+        if ((n.x == na.x && n.y == na.y) || (n.x == nb.x && n.y == nb.y) ||
+            (n.x == nc.x && n.y == nc.y)) {
+            continue;
+        }
+        // only a reflex point can be inside without an edge crossing the ear
+        if (_orient(n.prev, p, n.next) > 0.0) {
+            continue;
+        }
+        const double d1 = _orient(a, ear, p);
+        const double d2 = _orient(ear, c, p);
+        const double d3 = _orient(c, a, p);
+        if (strict ? (d1 >= 0.0 && d2 >= 0.0 && d3 >= 0.0)
+                   : (d1 > 0.0 && d2 > 0.0 && d3 > 0.0)) {
+            return false;
+        }
+    }
+    return true;
+}
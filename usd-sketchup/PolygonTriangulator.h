@@ -0,0 +1,84 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  PolygonTriangulator.h
+//
+// Our own triangulator for SketchUp faces, so that faces don't have to go
+// through an SUMeshHelper one at a time. It only looks at the points of the
+// face's loops, never at the SketchUp model, so any number of them can run
+// at once on different threads (one triangulator per thread - each one keeps
+// its scratch space around between faces).
+//
+// The loops are projected onto the face's plane, the holes are bridged into
+// the outer loop, and the resulting simple polygon is ear clipped. A face
+// with n points in all its loops and h holes always gets n + 2h - 2
+// triangles, even if it is degenerate, so the space for them can be handed
+// out before triangulating.
+
+#ifndef PolygonTriangulator_h
+#define PolygonTriangulator_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <stdio.h>
+#include <vector>
+
+class PolygonTriangulator {
+public:
+    PolygonTriangulator();
+    ~PolygonTriangulator();
+
+    // how many triangles Triangulate writes for these loops
+    static size_t CountTriangles(const size_t* loopSizes, size_t numLoops);
+
+    // The points are the outer loop followed by each of the holes, with
+    // loopSizes saying how many points each loop has (at least 3). The
+    // triangles are written to indices, three per triangle, as the index of
+    // the point plus offset, wound counter-clockwise around normal.
+    void Triangulate(const SUPoint3D* points, const size_t* loopSizes,
+                     size_t numLoops, const SUVector3D& normal,
+                     int offset, int* indices);
+
+private:
+    // the points are kept in a circular doubly linked list, so bridging in
+    // a hole or clipping an ear doesn't move anything around
+    struct _Node {
+        int index;
+        double x, y;
+        int prev;
+        int next;
+    };
+    std::vector<_Node> _nodes;
+    std::vector<std::pair<double, int>> _holes;
+
+    int _linkLoop(const std::vector<std::pair<double, double>>& xy,
+                  size_t start, size_t count, bool counterClockwise);
+    int _findBridge(int hole, int outer) const;
+    void _splitPolygon(int a, int b);
+    bool _isEar(int ear, bool strict) const;
+    bool _locallyInside(int a, int b) const;
+    double _orient(int a, int b, int c) const;
+
+    std::vector<std::pair<double, double>> _projected;
+};
+
+#endif /* PolygonTriangulator_h */
@@ -0,0 +1,677 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SceneMeshBuilder.cpp
+//
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "GeometryConversion.h"
+#include "SceneMeshBuilder.h"
+
+#include "pxr/usd/usdGeom/pointBased.h"
+
+// SketchUp's default frontface color
+static pxr::GfVec4d defaultFrontFaceRGBA(1.0, 1.0, 1.0, 1.0);
+// SketchUp's default backface color
+static pxr::GfVec4d defaultBackFaceRGBA(198.0/255.0, 214.0/255.0, 224.0/255.0,
+                                        1.0);
+
+MeshBuffers::MeshBuffers() : extent(2), foundAFrontColor(false),
+                             foundABackColor(false), doubleSided(false),
+                             removedFacesCount(0), closedFacesCount(0) {
+}
+
+// only the per point arrays that were filled in are copied
+template <typename T>
+static void
+_copyPoints(const pxr::VtArray<T>& values, const std::vector<int>& points,
+            size_t numPoints, pxr::VtArray<T>& part) {
+    if (values.empty()) {
+        part.clear();
+        return ;
+    }
+    part.resize(numPoints);
+    const T* in = values.cdata();
+    T* out = part.data();
+    for (size_t i = 0; i < points.size(); i++) {
+        if (points[i] >= 0) {
+            out[points[i]] = in[i];
+        }
+    }
+}
+
+// only the palette entries the faces use are copied
+template <typename T>
+static void
+_copyPalette(const pxr::VtArray<T>& palette, const pxr::VtArray<int>& indices,
+             const pxr::VtArray<int>& faces, pxr::VtArray<T>& partPalette,
+             pxr::VtArray<int>& partIndices) {
+    std::vector<int> entries(palette.size(), -1);
+    partPalette.clear();
+    partIndices.resize(faces.size());
+    const int* in = indices.cdata();
+    int* out = partIndices.data();
+    for (int face : faces) {
+        int& entry = entries[in[face]];
+        if (entry < 0) {
+            entry = (int)partPalette.size();
+            partPalette.push_back(palette[in[face]]);
+        }
+        *out++ = entry;
+    }
+}
+
+void
+ExtractMeshFaces(const MeshBuffers& buffers, const pxr::VtArray<int>& faces,
+                 MeshBuffers& part) {
+    const size_t numPolygons = buffers.faceVertexCounts.size();
+    const int* counts = buffers.faceVertexCounts.cdata();
+    const int* indices = buffers.faceVertexIndices.cdata();
+    std::vector<size_t> starts(numPolygons);
+    size_t start = 0;
+    for (size_t i = 0; i < numPolygons; i++) {
+        starts[i] = start;
+        start += counts[i];
+    }
+    size_t numIndices = 0;
+    for (int face : faces) {
+        numIndices += counts[face];
+    }
+    // the points are numbered in the order the polygons first use them
+    std::vector<int> points(buffers.points.size(), -1);
+    int numPoints = 0;
+    part.faceVertexCounts.resize(faces.size());
+    part.faceVertexIndices.resize(numIndices);
+    int* outCounts = part.faceVertexCounts.data();
+    int* outIndices = part.faceVertexIndices.data();
+    for (int face : faces) {
+        const int* faceIndices = indices + starts[face];
+        for (int i = 0; i < counts[face]; i++) {
+            int& point = points[faceIndices[i]];
+            if (point < 0) {
+                point = numPoints++;
+            }
+            *outIndices++ = point;
+        }
+        *outCounts++ = counts[face];
+    }
+    _copyPoints(buffers.points, points, numPoints, part.points);
+    _copyPoints(buffers.normals, points, numPoints, part.normals);
+    _copyPoints(buffers.flippedNormals, points, numPoints,
+                part.flippedNormals);
+    _copyPoints(buffers.frontUVs, points, numPoints, part.frontUVs);
+    _copyPoints(buffers.backUVs, points, numPoints, part.backUVs);
+    _copyPalette(buffers.frontRGBs, buffers.frontRGBIndices, faces,
+                 part.frontRGBs, part.frontRGBIndices);
+    _copyPalette(buffers.frontAs, buffers.frontAIndices, faces,
+                 part.frontAs, part.frontAIndices);
+    _copyPalette(buffers.backRGBs, buffers.backRGBIndices, faces,
+                 part.backRGBs, part.backRGBIndices);
+    _copyPalette(buffers.backAs, buffers.backAIndices, faces,
+                 part.backAs, part.backAIndices);
+    pxr::UsdGeomPointBased::ComputeExtent(part.points, &part.extent);
+    part.foundAFrontColor = buffers.foundAFrontColor;
+    part.foundABackColor = buffers.foundABackColor;
+    part.doubleSided = buffers.doubleSided;
+    part.frontSubsets.clear();
+    part.backSubsets.clear();
+}
+
+SceneMeshBuilder::SceneMeshBuilder() : _scene(NULL), _exportNormals(false),
+    _exportMaterials(true), _exportDoubleSided(true), _weldVertices(true),
+    _cleanUpMeshes(true), _sortFacesByMaterial(false),
+    _shareDisplayMaterial(true), _omitClosedBackSides(false) {
+}
+
+SceneMeshBuilder::~SceneMeshBuilder() {
+}
+
+void
+SceneMeshBuilder::SetExportNormals(bool flag) {
+    _exportNormals = flag;
+}
+
+void
+SceneMeshBuilder::SetExportMaterials(bool flag) {
+    _exportMaterials = flag;
+}
+
+void
+SceneMeshBuilder::SetExportDoubleSided(bool flag) {
+    _exportDoubleSided = flag;
+}
+
+void
+SceneMeshBuilder::SetWeldVertices(bool flag) {
+    _weldVertices = flag;
+}
+
+void
+SceneMeshBuilder::SetWeldTolerance(float tolerance) {
+    _welder.SetTolerance(tolerance);
+}
+
+void
+SceneMeshBuilder::SetCleanUpMeshes(bool flag) {
+    _cleanUpMeshes = flag;
+}
+
+void
+SceneMeshBuilder::SetSortFacesByMaterial(bool flag) {
+    _sortFacesByMaterial = flag;
+}
+
+void
+SceneMeshBuilder::SetShareDisplayMaterial(bool flag) {
+    _shareDisplayMaterial = flag;
+}
+
+void
+SceneMeshBuilder::SetOmitClosedBackSides(bool flag) {
+    _omitClosedBackSides = flag;
+}
+
+void
+SceneMeshBuilder::Clear() {
+    _scene = NULL;
+    _nodes.clear();
+    _definitionNodes.clear();
+    _meshBuffers.clear();
+    _frontLooks.clear();
+    _backLooks.clear();
+}
+
+void
+SceneMeshBuilder::Build(const SketchUpScene& scene) {
+    Clear();
+    _scene = &scene;
+    if (_sortFacesByMaterial) {
+        _findLooks(true, _frontLooks);
+        _findLooks(false, _backLooks);
+    }
+    // the last node is the scene itself, which nothing instances
+    const size_t numNodes = scene.definitions.size() + 1;
+    for (size_t i = 0; i < numNodes; i++) {
+        _nodes.push_back(std::unique_ptr<_Node>(new _Node()));
+    }
+    for (size_t i = 0; i < scene.definitions.size(); i++) {
+        _definitionNodes[scene.definitions[i].key] = i;
+        _nodes[i]->entities = &scene.definitions[i].entities;
+    }
+    _nodes.back()->entities = &scene.entities;
+    for (size_t i = 0; i < numNodes; i++) {
+        _Node& node = *_nodes[i];
+        // the extractor already worked out which definitions use which
+        _addChildren(node, (i < scene.definitions.size()) ?
+                     scene.definitions[i].children : scene.children);
+        node.pendingChildren = (int)node.children.size();
+        node.built = false;
+        for (auto& child : node.children) {
+            _nodes[child.first]->parents.push_back(i);
+        }
+    }
+    // Start with the definitions that don't instance anything. Each one that
+    // finishes hands its parents to the dispatcher once their last child
+    // is done.
+    {
+        pxr::WorkDispatcher dispatcher;
+        for (size_t i = 0; i < numNodes; i++) {
+            if (_nodes[i]->pendingChildren == 0) {
+                pxr::WorkDispatcher* d = &dispatcher;
+                dispatcher.Run([this, i, d]() { _buildNode(i, d); });
+            }
+        }
+        dispatcher.Wait();
+    }
+    // SketchUp doesn't let a component contain itself, but if a file ever
+    // manages it, build what's left without waiting on the cycle.
+    for (size_t i = 0; i < numNodes; i++) {
+        if (!_nodes[i]->built) {
+            std::cerr << "WARNING: component definitions instance each other"
+                      << " in a cycle, their stats will be incomplete"
+                      << std::endl;
+            _buildNode(i, NULL);
+        }
+    }
+    for (auto& node : _nodes) {
+        for (auto& meshAndBuffers : node->meshes) {
+            _meshBuffers[meshAndBuffers.first] = meshAndBuffers.second;
+        }
+        node->meshes.clear();
+    }
+}
+
+const MeshBuffers*
+SceneMeshBuilder::GetMeshBuffers(const SceneMesh* mesh) const {
+    auto found = _meshBuffers.find(mesh);
+    if (found == _meshBuffers.end()) {
+        return NULL;
+    }
+    return found->second.get();
+}
+
+StatsDataPoint*
+SceneMeshBuilder::GetDefinitionStats(uintptr_t key) const {
+    auto found = _definitionNodes.find(key);
+    if (found == _definitionNodes.end()) {
+        return NULL;
+    }
+    return _nodes[found->second]->stats.get();
+}
+
+StatsDataPoint*
+SceneMeshBuilder::GetSceneStats() const {
+    if (_nodes.empty()) {
+        return NULL;
+    }
+    return _nodes.back()->stats.get();
+}
+
+void
+SceneMeshBuilder::_addChildren(_Node& node,
+                               const std::map<uintptr_t, unsigned long long>& children) {
+    for (auto& child : children) {
+        auto found = _definitionNodes.find(child.first);
+        if (found != _definitionNodes.end()) {
+            node.children[found->second] += child.second;
+        }
+    }
+}
+
+void
+SceneMeshBuilder::_buildNode(size_t index, pxr::WorkDispatcher* dispatcher) {
+    _Node& node = *_nodes[index];
+    node.stats.reset(new StatsDataPoint());
+    _buildEntities(node, *node.entities);
+    // all our children are done by now, so we can roll their stats into ours
+    StatsDataPoint* stats = node.stats.get();
+    for (auto& child : node.children) {
+        StatsDataPoint* childStats = _nodes[child.first]->stats.get();
+        if (!childStats) {
+            continue;
+        }
+        const unsigned long long n = child.second;
+        stats->SetOriginalFacesCount(stats->GetOriginalFacesCount() +
+                                     n * childStats->GetOriginalFacesCount());
+        stats->SetTrianglesCount(stats->GetTrianglesCount() +
+                                 n * childStats->GetTrianglesCount());
+        stats->SetRemovedFacesCount(stats->GetRemovedFacesCount() +
+                                    n * childStats->GetRemovedFacesCount());
+        stats->SetMeshesCount(stats->GetMeshesCount() +
+                              n * childStats->GetMeshesCount());
+        stats->SetEdgesCount(stats->GetEdgesCount() +
+                             n * childStats->GetEdgesCount());
+        stats->SetCurvesCount(stats->GetCurvesCount() +
+                              n * childStats->GetCurvesCount());
+        stats->SetLinesCount(stats->GetLinesCount() +
+                             n * childStats->GetLinesCount());
+    }
+    node.built = true;
+    if (!dispatcher) {
+        return ;
+    }
+    for (size_t parent : node.parents) {
+        if (--(_nodes[parent]->pendingChildren) == 0) {
+            dispatcher->Run([this, parent, dispatcher]() {
+                _buildNode(parent, dispatcher);
+            });
+        }
+    }
+}
+
+void
+SceneMeshBuilder::_buildEntities(_Node& node, const SceneEntities& entities) {
+    StatsDataPoint* stats = node.stats.get();
+    if (!entities.mesh.faceVertexCounts.empty()) {
+        std::shared_ptr<MeshBuffers> buffers = _buildMesh(entities.mesh);
+        node.meshes.push_back(std::make_pair(&entities.mesh, buffers));
+        stats->SetOriginalFacesCount(stats->GetOriginalFacesCount() +
+                                     entities.mesh.originalFacesCount);
+        // these are polygons rather than triangles if n-gons were kept
+        stats->SetTrianglesCount(stats->GetTrianglesCount() +
+                                 buffers->faceVertexCounts.size());
+        stats->SetRemovedFacesCount(stats->GetRemovedFacesCount() +
+                                    buffers->removedFacesCount);
+        const bool noBackSide = buffers->closedFacesCount &&
+            !buffers->openBackSide;
+        stats->SetMeshesCount(stats->GetMeshesCount() +
+                              (buffers->doubleSided || noBackSide ? 1 : 2));
+    }
+    stats->SetEdgesCount(stats->GetEdgesCount() +
+                         entities.edges.vertexCounts.size());
+    stats->SetCurvesCount(stats->GetCurvesCount() +
+                          entities.curves.vertexCounts.size());
+    stats->SetLinesCount(stats->GetLinesCount() +
+                         entities.polylines.vertexCounts.size());
+    for (const SceneGroup& group : entities.groups) {
+        _buildEntities(node, *group.entities);
+    }
+}
+
+std::shared_ptr<MeshBuffers>
+SceneMeshBuilder::_buildMesh(const SceneMesh& mesh) {
+    std::shared_ptr<MeshBuffers> buffers = std::make_shared<MeshBuffers>();
+    // these share their storage with the scene, they're not copied
+    buffers->faceVertexCounts = mesh.faceVertexCounts;
+    const bool welded = _weldVertices &&
+        _welder.Weld(mesh, buffers->points, buffers->normals,
+                     buffers->frontUVs, buffers->backUVs,
+                     buffers->faceVertexIndices);
+    if (!welded) {
+        buffers->points = mesh.points;
+        buffers->normals = mesh.normals;
+        buffers->faceVertexIndices = mesh.faceVertexIndices;
+        buffers->frontUVs = mesh.frontUVs;
+        buffers->backUVs = mesh.backUVs;
+    }
+    // the materials go with the polygons, so they're cleaned up and sorted
+    // along with them
+    std::vector<int> ownFrontMaterials;
+    std::vector<int> ownBackMaterials;
+    const std::vector<int>* frontMaterials = &mesh.frontMaterials;
+    const std::vector<int>* backMaterials = &mesh.backMaterials;
+    if (_cleanUpMeshes || _sortFacesByMaterial) {
+        ownFrontMaterials = mesh.frontMaterials;
+        ownBackMaterials = mesh.backMaterials;
+    }
+    if (_cleanUpMeshes) {
+        MeshCleaner cleaner;
+        if (cleaner.Clean(buffers->points, buffers->normals,
+                          buffers->frontUVs, buffers->backUVs,
+                          buffers->faceVertexCounts,
+                          buffers->faceVertexIndices,
+                          ownFrontMaterials, ownBackMaterials)) {
+            frontMaterials = &ownFrontMaterials;
+            backMaterials = &ownBackMaterials;
+            buffers->removedFacesCount = cleaner.GetDegenerateFacesCount() +
+                cleaner.GetDuplicateFacesCount();
+        }
+    }
+    if (_sortFacesByMaterial &&
+        _sortByMaterial(*buffers, ownFrontMaterials, ownBackMaterials)) {
+        frontMaterials = &ownFrontMaterials;
+        backMaterials = &ownBackMaterials;
+    }
+    pxr::UsdGeomPointBased::ComputeExtent(buffers->points, &buffers->extent);
+    if (_exportNormals && !buffers->normals.empty()) {
+        buffers->flippedNormals.resize(buffers->normals.size());
+        NegateVectors(buffers->normals.cdata(), buffers->normals.size(),
+                      buffers->flippedNormals.data());
+    }
+    // we have a front & back RGBA for each polygon, from the original face
+    buffers->foundAFrontColor = _sideColors(*frontMaterials, true,
+                                            buffers->frontRGBs,
+                                            buffers->frontRGBIndices,
+                                            buffers->frontAs,
+                                            buffers->frontAIndices);
+    buffers->foundABackColor = _sideColors(*backMaterials, false,
+                                           buffers->backRGBs,
+                                           buffers->backRGBIndices,
+                                           buffers->backAs,
+                                           buffers->backAIndices);
+    const size_t numPolygons = buffers->faceVertexCounts.size();
+    const pxr::GfVec3f* frontRGBs = buffers->frontRGBs.cdata();
+    const int* frontRGBIndices = buffers->frontRGBIndices.cdata();
+    const float* frontAs = buffers->frontAs.cdata();
+    const int* frontAIndices = buffers->frontAIndices.cdata();
+    const pxr::GfVec3f* backRGBs = buffers->backRGBs.cdata();
+    const int* backRGBIndices = buffers->backRGBIndices.cdata();
+    const float* backAs = buffers->backAs.cdata();
+    const int* backAIndices = buffers->backAIndices.cdata();
+    bool sameColors = true;
+    for (size_t i = 0; i < numPolygons && sameColors; i++) {
+        sameColors = frontRGBs[frontRGBIndices[i]] == backRGBs[backRGBIndices[i]] &&
+            frontAs[frontAIndices[i]] == backAs[backAIndices[i]];
+    }
+    // If both sides look the same (or we've been asked to), there's no need
+    // to write the mesh out twice.
+    buffers->doubleSided = _exportDoubleSided || sameColors;
+    if (_exportMaterials) {
+        // only the triangles that have a color or texture get a mesh subset
+        _addSubsets(*frontMaterials, true, buffers->frontSubsets);
+        _addSubsets(*backMaterials, false, buffers->backSubsets);
+    }
+    if (_omitClosedBackSides) {
+        // you can see the inside of a shell through a side that isn't opaque
+        std::vector<bool> seeThrough;
+        const bool anySeeThrough =
+            std::any_of(buffers->frontAs.cbegin(), buffers->frontAs.cend(),
+                        [](float a) { return a < 1.0f; }) ||
+            std::any_of(buffers->backAs.cbegin(), buffers->backAs.cend(),
+                        [](float a) { return a < 1.0f; });
+        if (anySeeThrough) {
+            seeThrough.resize(numPolygons);
+            for (size_t i = 0; i < numPolygons; i++) {
+                seeThrough[i] = frontAs[frontAIndices[i]] < 1.0f ||
+                    backAs[backAIndices[i]] < 1.0f;
+            }
+        }
+        ClosedShellFinder shells;
+        buffers->closedFacesCount = shells.Find(buffers->points,
+                                                buffers->faceVertexCounts,
+                                                buffers->faceVertexIndices,
+                                                anySeeThrough ? &seeThrough
+                                                              : NULL);
+        const pxr::VtArray<int>& openFaces = shells.GetOpenFaces();
+        // a double-sided mesh only needs to know if it's all closed
+        if (!buffers->doubleSided && buffers->closedFacesCount &&
+            !openFaces.empty()) {
+            buffers->openBackSide = std::make_shared<MeshBuffers>();
+            ExtractMeshFaces(*buffers, openFaces, *buffers->openBackSide);
+            if (_exportMaterials) {
+                std::vector<int> openBackMaterials;
+                openBackMaterials.reserve(openFaces.size());
+                for (int face : openFaces) {
+                    openBackMaterials.push_back((*backMaterials)[face]);
+                }
+                _addSubsets(openBackMaterials, false,
+                            buffers->openBackSide->backSubsets);
+            }
+        }
+    }
+    return buffers;
+}
+
+// Fills in the palettes of one side's colors and opacities, and the index of
+// each polygon's color and opacity in them. Each material is only looked up
+// once. Returns true if any of the colors came from a material.
+bool
+SceneMeshBuilder::_sideColors(const std::vector<int>& materials,
+                              bool frontSide,
+                              pxr::VtArray<pxr::GfVec3f>& rgbs,
+                              pxr::VtArray<int>& rgbIndices,
+                              pxr::VtArray<float>& opacities,
+                              pxr::VtArray<int>& opacityIndices) const {
+    // by material index + 1, as no material is -1
+    std::vector<std::pair<int, int>> slots(_scene->materials.size() + 1,
+                                           std::make_pair(-1, -1));
+    bool foundAColor = false;
+    rgbs.clear();
+    opacities.clear();
+    rgbIndices.resize(materials.size());
+    opacityIndices.resize(materials.size());
+    int* outRGBIndices = rgbIndices.data();
+    int* outOpacityIndices = opacityIndices.data();
+    for (size_t i = 0; i < materials.size(); i++) {
+        std::pair<int, int>& slot = slots[materials[i] + 1];
+        if (slot.first < 0) {
+            pxr::GfVec3f rgb;
+            float opacity;
+            if (_sideColor(materials[i], frontSide, rgb, opacity)) {
+                foundAColor = true;
+            }
+            // a mesh uses a handful of colors, so these stay short
+            auto foundRGB = std::find(rgbs.cbegin(), rgbs.cend(), rgb);
+            slot.first = (int)(foundRGB - rgbs.cbegin());
+            if (foundRGB == rgbs.cend()) {
+                rgbs.push_back(rgb);
+            }
+            auto foundOpacity = std::find(opacities.cbegin(), opacities.cend(),
+                                          opacity);
+            slot.second = (int)(foundOpacity - opacities.cbegin());
+            if (foundOpacity == opacities.cend()) {
+                opacities.push_back(opacity);
+            }
+        }
+        outRGBIndices[i] = slot.first;
+        outOpacityIndices[i] = slot.second;
+    }
+    return foundAColor;
+}
+
+// A face side with no material gets SketchUp's default color for that side,
+// as does a material that only has a texture. Returns true if the color came
+// from the material.
+bool
+SceneMeshBuilder::_sideColor(int materialIndex, bool frontSide,
+                             pxr::GfVec3f& rgb, float& opacity) const {
+    const pxr::GfVec4d& rgba = frontSide ? defaultFrontFaceRGBA : defaultBackFaceRGBA;
+    rgb = pxr::GfVec3f(rgba[0], rgba[1], rgba[2]);
+    opacity = rgba[3];
+    if (materialIndex < 0) {
+        return false;
+    }
+    const SceneMaterial& material = _scene->materials[materialIndex];
+    if (!material.hasColor) {
+        return false;
+    }
+    rgb = material.rgb;
+    opacity = material.opacity;
+    return true;
+}
+
+// Makes one subset for each run of triangles that share a material. Runs of
+// the same material get merged later on, once we know their material paths.
+void
+SceneMeshBuilder::_addSubsets(const std::vector<int>& materials,
+                              bool frontSide,
+                              std::vector<MeshSubset>& subsets) const {
+    size_t start = 0;
+    while (start < materials.size()) {
+        const int materialIndex = materials[start];
+        size_t end = start + 1;
+        while (end < materials.size() && materials[end] == materialIndex) {
+            end++;
+        }
+        if (materialIndex >= 0) {
+            pxr::VtArray<int> faceIndices(end - start);
+            int* indices = faceIndices.data();
+            for (size_t i = start; i < end; i++) {
+                *indices++ = (int)i;
+            }
+            pxr::GfVec3f rgb;
+            float opacity;
+            _sideColor(materialIndex, frontSide, rgb, opacity);
+            const std::string& textureName = _scene->materials[materialIndex].textureName;
+            subsets.emplace_back(textureName, rgb, opacity,
+                                 std::move(faceIndices));
+        }
+        start = end;
+    }
+}
+
+// The materials that end up bound to the same USD material get the same
+// look, see USDExporter::_ExportMaterials: the ones with the same texture,
+// and either all the ones without a texture (which share the display
+// material) or, without that, the ones with the same color.
+void
+SceneMeshBuilder::_findLooks(bool frontSide, std::vector<int>& looks) const {
+    const std::vector<SceneMaterial>& materials = _scene->materials;
+    looks.resize(materials.size());
+    std::map<std::string, int> textures;
+    std::map<std::pair<std::array<float, 3>, float>, int> colors;
+    for (size_t i = 0; i < materials.size(); i++) {
+        const std::string& textureName = materials[i].textureName;
+        if (!textureName.empty()) {
+            looks[i] = textures.insert(std::make_pair(textureName,
+                                                      (int)i)).first->second;
+            continue;
+        }
+        pxr::GfVec3f rgb(0.0f, 0.0f, 0.0f);
+        float opacity = 0.0f;
+        if (!_shareDisplayMaterial) {
+            _sideColor((int)i, frontSide, rgb, opacity);
+        }
+        std::array<float, 3> key = {{rgb[0], rgb[1], rgb[2]}};
+        looks[i] = colors.insert(std::make_pair(std::make_pair(key, opacity),
+                                                (int)i)).first->second;
+    }
+}
+
+// Stable, so the polygons that share a material stay in SketchUp's order.
+// Sorted by front look first, so only the front runs are sure to be whole.
+// The points aren't moved. Returns false if the polygons were already in
+// order, in which case nothing was touched.
+bool
+SceneMeshBuilder::_sortByMaterial(MeshBuffers& buffers,
+                                  std::vector<int>& frontMaterials,
+                                  std::vector<int>& backMaterials) const {
+    const size_t numPolygons = buffers.faceVertexCounts.size();
+    auto look = [](const std::vector<int>& looks, int material) {
+        return material < 0 ? -1 : looks[material];
+    };
+    std::vector<std::pair<std::pair<int, int>, size_t>> keys(numPolygons);
+    for (size_t i = 0; i < numPolygons; i++) {
+        keys[i] = std::make_pair(std::make_pair(look(_frontLooks,
+                                                     frontMaterials[i]),
+                                                look(_backLooks,
+                                                     backMaterials[i])),
+                                 i);
+    }
+    if (std::is_sorted(keys.begin(), keys.end())) {
+        return false;
+    }
+    // the original index is part of the key, which keeps this stable
+    std::sort(keys.begin(), keys.end());
+
+    const int* inCounts = buffers.faceVertexCounts.cdata();
+    const int* inIndices = buffers.faceVertexIndices.cdata();
+    std::vector<size_t> starts(numPolygons);
+    size_t start = 0;
+    for (size_t i = 0; i < numPolygons; i++) {
+        starts[i] = start;
+        start += inCounts[i];
+    }
+    pxr::VtArray<int> counts(numPolygons);
+    pxr::VtArray<int> indices(buffers.faceVertexIndices.size());
+    int* outCounts = counts.data();
+    int* outIndices = indices.data();
+    std::vector<int> sortedFront(numPolygons);
+    std::vector<int> sortedBack(numPolygons);
+    for (size_t i = 0; i < numPolygons; i++) {
+        const size_t polygon = keys[i].second;
+        const int count = inCounts[polygon];
+        outCounts[i] = count;
+        std::copy(inIndices + starts[polygon],
+                  inIndices + starts[polygon] + count, outIndices);
+        outIndices += count;
+        sortedFront[i] = frontMaterials[polygon];
+        sortedBack[i] = backMaterials[polygon];
+    }
+    buffers.faceVertexCounts.swap(counts);
+    buffers.faceVertexIndices.swap(indices);
+    frontMaterials.swap(sortedFront);
+    backMaterials.swap(sortedBack);
+    return true;
+}
@@ -0,0 +1,193 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SceneMeshBuilder.h
+//
+// Turns the meshes in a SketchUpScene into the buffers that USDExporter
+// writes out, and works out the geometry stats for every component
+// definition. Nothing here touches the SketchUp API or a USD stage, so the
+// definitions are built concurrently. A definition is only built after all
+// the definitions it instances have been, so that it can roll their stats up
+// into its own.
+
+#ifndef SceneMeshBuilder_h
+#define SceneMeshBuilder_h
+
+#include <stdio.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "pxr/base/work/dispatcher.h"
+
+#include "ClosedShellFinder.h"
+#include "MeshCleaner.h"
+#include "MeshSubset.h"
+#include "MeshWelder.h"
+#include "SketchUpScene.h"
+#include "StatsDataPoint.h"
+
+// Everything we need to write out the FrontSide/BackSide (or BothSides) mesh
+// for one SceneMesh, except the material paths, which are only known once
+// the materials have been written to the stage.
+// The colors and opacities of each side are palettes of the distinct values
+// the mesh uses, with an index into them for each polygon.
+struct MeshBuffers {
+    MeshBuffers();
+
+    pxr::VtArray<pxr::GfVec3f> points;
+    pxr::VtArray<pxr::GfVec3f> normals;
+    pxr::VtArray<pxr::GfVec3f> flippedNormals;
+    pxr::VtArray<int> faceVertexCounts;
+    pxr::VtArray<int> faceVertexIndices;
+    pxr::VtArray<pxr::GfVec3f> extent;
+
+    pxr::VtArray<pxr::GfVec2f> frontUVs;
+    pxr::VtArray<pxr::GfVec3f> frontRGBs;
+    pxr::VtArray<int> frontRGBIndices;
+    pxr::VtArray<float> frontAs;
+    pxr::VtArray<int> frontAIndices;
+    bool foundAFrontColor;
+    std::vector<MeshSubset> frontSubsets;
+
+    pxr::VtArray<pxr::GfVec2f> backUVs;
+    pxr::VtArray<pxr::GfVec3f> backRGBs;
+    pxr::VtArray<int> backRGBIndices;
+    pxr::VtArray<float> backAs;
+    pxr::VtArray<int> backAIndices;
+    bool foundABackColor;
+    std::vector<MeshSubset> backSubsets;
+
+    // if true, we only write out one double-sided mesh
+    bool doubleSided;
+
+    // the degenerate and duplicate polygons that were left out
+    size_t removedFacesCount;
+
+    // The polygons that make up closed shells, whose back sides can't be
+    // seen (see ClosedShellFinder). When there are some, the BackSide mesh is
+    // made of the other polygons, which are copied here with their own
+    // subsets, and if there are no others it isn't written at all.
+    size_t closedFacesCount;
+    std::shared_ptr<MeshBuffers> openBackSide;
+};
+
+// Copies the given polygons of buffers into part, along with only the points
+// they use, e.g. to write the polygons bound to one material as a mesh of
+// their own. The subsets of part are left empty.
+void ExtractMeshFaces(const MeshBuffers& buffers,
+                      const pxr::VtArray<int>& faces, MeshBuffers& part);
+
+class SceneMeshBuilder {
+public:
+    SceneMeshBuilder();
+    ~SceneMeshBuilder();
+
+    void SetExportNormals(bool flag);
+    void SetExportMaterials(bool flag);
+    void SetExportDoubleSided(bool flag);
+    // merge the vertices that the faces of a mesh share, see MeshWelder
+    void SetWeldVertices(bool flag);
+    void SetWeldTolerance(float tolerance);
+    // leave out the polygons that have no area or that repeat another, see
+    // MeshCleaner
+    void SetCleanUpMeshes(bool flag);
+    // order the polygons of each mesh by the material they'll end up bound
+    // to, so that each FrontSide GeomSubset is a single run of polygons. The
+    // back materials only order the polygons that share a front material,
+    // so a BackSide GeomSubset can still be made of several runs.
+    void SetSortFacesByMaterial(bool flag);
+    // the exporter binds all the materials without a texture to one shared
+    // display material (which reads displayColor), so for sorting they're
+    // all the same material. Off for ARKit, which gets one per color.
+    void SetShareDisplayMaterial(bool flag);
+    // Leave the back sides of closed shells out of the BackSide meshes. A
+    // shell with a face whose front or back opacity is under 1 keeps its back
+    // sides, as they can be seen through it (see ClosedShellFinder).
+    void SetOmitClosedBackSides(bool flag);
+
+    void Build(const SketchUpScene& scene);
+    void Clear();
+
+    // NULL if the mesh was not part of the scene we built
+    const MeshBuffers* GetMeshBuffers(const SceneMesh* mesh) const;
+    // The faces, triangles, meshes, edges, curves and lines of a definition,
+    // including everything in the definitions it instances.
+    StatsDataPoint* GetDefinitionStats(uintptr_t key) const;
+    // same, for the whole scene
+    StatsDataPoint* GetSceneStats() const;
+
+private:
+    // One per component definition, plus one for the scene itself. The
+    // children are the definitions this one has instances of, along with how
+    // many times each is instanced.
+    struct _Node {
+        const SceneEntities* entities;
+        std::map<size_t, unsigned long long> children;
+        std::vector<size_t> parents;
+        std::atomic<int> pendingChildren;
+        std::atomic<bool> built;
+        std::vector<std::pair<const SceneMesh*, std::shared_ptr<MeshBuffers>>> meshes;
+        std::unique_ptr<StatsDataPoint> stats;
+    };
+
+    const SketchUpScene* _scene;
+    bool _exportNormals;
+    bool _exportMaterials;
+    bool _exportDoubleSided;
+    bool _weldVertices;
+    MeshWelder _welder;
+    bool _cleanUpMeshes;
+    bool _sortFacesByMaterial;
+    bool _shareDisplayMaterial;
+    bool _omitClosedBackSides;
+    // for each material, the first one that will resolve to the same USD
+    // material (same texture, or same color if it has no texture) on the
+    // front and back sides
+    std::vector<int> _frontLooks;
+    std::vector<int> _backLooks;
+    std::vector<std::unique_ptr<_Node>> _nodes;
+    std::map<uintptr_t, size_t> _definitionNodes;
+    std::unordered_map<const SceneMesh*, std::shared_ptr<MeshBuffers>> _meshBuffers;
+
+    void _addChildren(_Node& node,
+                      const std::map<uintptr_t, unsigned long long>& children);
+    void _buildNode(size_t index, pxr::WorkDispatcher* dispatcher);
+    void _buildEntities(_Node& node, const SceneEntities& entities);
+    std::shared_ptr<MeshBuffers> _buildMesh(const SceneMesh& mesh);
+    bool _sideColor(int materialIndex, bool frontSide,
+                    pxr::GfVec3f& rgb, float& opacity) const;
+    bool _sideColors(const std::vector<int>& materials, bool frontSide,
+                     pxr::VtArray<pxr::GfVec3f>& rgbs,
+                     pxr::VtArray<int>& rgbIndices,
+                     pxr::VtArray<float>& opacities,
+                     pxr::VtArray<int>& opacityIndices) const;
+    void _addSubsets(const std::vector<int>& materials, bool frontSide,
+                     std::vector<MeshSubset>& subsets) const;
+    void _findLooks(bool frontSide, std::vector<int>& looks) const;
+    bool _sortByMaterial(MeshBuffers& buffers, std::vector<int>& frontMaterials,
+                         std::vector<int>& backMaterials) const;
+};
+
+#endif /* SceneMeshBuilder_h */
@@ -0,0 +1,369 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpEntityWalker.cpp
+//
+#include "SketchUpEntityWalker.h"
+#include "USDSketchUpUtilities.h"
+
+#pragma mark SketchUpEntityVisitor class:
+
+SketchUpEntityVisitor::~SketchUpEntityVisitor() {
+}
+
+void
+SketchUpEntityVisitor::BeginDefinition(SUComponentDefinitionRef definition) {
+}
+
+void
+SketchUpEntityVisitor::EndDefinition(SUComponentDefinitionRef definition) {
+}
+
+void
+SketchUpEntityVisitor::VisitInstance(SUComponentInstanceRef instance,
+                                     SUComponentDefinitionRef definition) {
+}
+
+void
+SketchUpEntityVisitor::BeginGroup(SUGroupRef group) {
+}
+
+void
+SketchUpEntityVisitor::EndGroup(SUGroupRef group) {
+}
+
+void
+SketchUpEntityVisitor::VisitFace(SUFaceRef face) {
+}
+
+void
+SketchUpEntityVisitor::VisitEdge(SUEdgeRef edge) {
+}
+
+void
+SketchUpEntityVisitor::VisitCurve(SUCurveRef curve) {
+}
+
+void
+SketchUpEntityVisitor::VisitPolyline(SUPolyline3dRef polyline) {
+}
+
+void
+SketchUpEntityVisitor::VisitImage(SUImageRef image) {
+}
+
+#pragma mark SketchUpEntityWalker class:
+
+SketchUpEntityWalker::SketchUpEntityWalker() : _visibility(NULL) {
+    SetVisitFaces(true);
+    SetVisitEdges(true);
+    SetVisitCurves(true);
+    SetVisitPolylines(true);
+}
+
+SketchUpEntityWalker::~SketchUpEntityWalker() {
+}
+
+void
+SketchUpEntityWalker::AddVisitor(SketchUpEntityVisitor* visitor) {
+    _visitors.push_back(visitor);
+}
+
+void
+SketchUpEntityWalker::SetVisibilityResolver(const SketchUpVisibilityResolver* resolver) {
+    _visibility = resolver;
+}
+
+void
+SketchUpEntityWalker::Walk(SUModelRef model) {
+    if (!_visibility) {
+        _ownVisibility.Resolve(model);
+    }
+    _walkedDefinitions.clear();
+    SUEntitiesRef model_entities;
+    SU_CALL(SUModelGetEntities(model, &model_entities));
+    _walkEntities(model_entities);
+    _walkedDefinitions.clear();
+}
+
+bool
+SketchUpEntityWalker::_isVisible(SUDrawingElementRef drawingElement) const {
+    if (_visibility) {
+        return _visibility->IsVisible(drawingElement);
+    }
+    return _ownVisibility.IsVisible(drawingElement);
+}
+
+void
+SketchUpEntityWalker::_walkEntities(SUEntitiesRef entities) {
+    if (SUIsInvalid(entities)) {
+        return ;
+    }
+    _walkInstances(entities);
+    _walkGroups(entities);
+    if (GetVisitFaces()) {
+        _walkFaces(entities);
+    }
+    if (GetVisitEdges()) {
+        _walkEdges(entities);
+    }
+    if (GetVisitCurves()) {
+        _walkCurves(entities);
+    }
+    if (GetVisitPolylines()) {
+        _walkPolylines(entities);
+    }
+    _walkImages(entities);
+}
+
+#pragma mark Instances:
+
+void
+SketchUpEntityWalker::_walkInstances(SUEntitiesRef entities) {
+    size_t num = 0;
+    SU_CALL(SUEntitiesGetNumInstances(entities, &num));
+    if (!num) {
+        return ;
+    }
+    std::vector<SUComponentInstanceRef> instances(num);
+    SU_CALL(SUEntitiesGetInstances(entities, num, &instances[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUComponentInstanceRef instance = instances[i];
+        if (SUIsInvalid(instance)) {
+            continue;
+        }
+        if (!_isVisible(SUComponentInstanceToDrawingElement(instance))) {
+            continue;
+        }
+        SUComponentDefinitionRef definition = SU_INVALID;
+        SU_CALL(SUComponentInstanceGetDefinition(instance, &definition));
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->VisitInstance(instance, definition);
+        }
+        _walkDefinition(definition);
+    }
+}
+
+void
+SketchUpEntityWalker::_walkDefinition(SUComponentDefinitionRef definition) {
+    uintptr_t key = reinterpret_cast<uintptr_t>(definition.ptr);
+    if (!_walkedDefinitions.insert(key).second) {
+        return ;
+    }
+    for (SketchUpEntityVisitor* visitor : _visitors) {
+        visitor->BeginDefinition(definition);
+    }
+    SUEntitiesRef entities = SU_INVALID;
+    SUComponentDefinitionGetEntities(definition, &entities);
+    _walkEntities(entities);
+    for (SketchUpEntityVisitor* visitor : _visitors) {
+        visitor->EndDefinition(definition);
+    }
+}
+
+#pragma mark Groups:
+
+void
+SketchUpEntityWalker::_walkGroups(SUEntitiesRef entities) {
+    size_t num = 0;
+    SU_CALL(SUEntitiesGetNumGroups(entities, &num));
+    if (!num) {
+        return ;
+    }
+    std::vector<SUGroupRef> groups(num);
+    SU_CALL(SUEntitiesGetGroups(entities, num, &groups[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUGroupRef group = groups[i];
+        if (SUIsInvalid(group)) {
+            continue;
+        }
+        if (!_isVisible(SUGroupToDrawingElement(group))) {
+            continue;
+        }
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->BeginGroup(group);
+        }
+        SUEntitiesRef group_entities = SU_INVALID;
+        SU_CALL(SUGroupGetEntities(group, &group_entities));
+        _walkEntities(group_entities);
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->EndGroup(group);
+        }
+    }
+}
+
+#pragma mark Faces:
+
+void
+SketchUpEntityWalker::_walkFaces(SUEntitiesRef entities) {
+    size_t num = 0;
+    SU_CALL(SUEntitiesGetNumFaces(entities, &num));
+    if (!num) {
+        return;
+    }
+    std::vector<SUFaceRef> faces(num);
+    SU_CALL(SUEntitiesGetFaces(entities, num, &faces[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUFaceRef face = faces[i];
+        if (SUIsInvalid(face)) {
+            continue;
+        }
+        if (!_isVisible(SUFaceToDrawingElement(face))) {
+            continue;
+        }
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->VisitFace(face);
+        }
+    }
+}
+
+#pragma mark Edges:
+
+void
+SketchUpEntityWalker::_walkEdges(SUEntitiesRef entities) {
+    size_t num = 0;
+    bool standAloneOnly = false; // Write only edges not connected to faces.
+    SU_CALL(SUEntitiesGetNumEdges(entities, standAloneOnly, &num));
+    if (!num) {
+        return ;
+    }
+    std::vector<SUEdgeRef> edges(num);
+    SU_CALL(SUEntitiesGetEdges(entities, standAloneOnly, num,
+                               &edges[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUEdgeRef edge = edges[i];
+        if (SUIsInvalid(edge)) {
+            continue;
+        }
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->VisitEdge(edge);
+        }
+    }
+}
+
+#pragma mark Curves:
+
+void
+SketchUpEntityWalker::_walkCurves(SUEntitiesRef entities) {
+    size_t num = 0;
+    SU_CALL(SUEntitiesGetNumCurves(entities, &num));
+    if (!num) {
+        return ;
+    }
+    std::vector<SUCurveRef> curves(num);
+    SU_CALL(SUEntitiesGetCurves(entities, num, &curves[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUCurveRef curve = curves[i];
+        if (SUIsInvalid(curve)) {
+            continue;
+        }
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->VisitCurve(curve);
+        }
+    }
+}
+
+#pragma mark Polyline3D:
+
+void
+SketchUpEntityWalker::_walkPolylines(SUEntitiesRef entities) {
+    size_t num = 0;
+    SU_CALL(SUEntitiesGetNumPolyline3ds(entities, &num));
+    if (!num) {
+        return ;
+    }
+    std::vector<SUPolyline3dRef> polylines(num);
+    SU_CALL(SUEntitiesGetPolyline3ds(entities, num, &polylines[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUPolyline3dRef polyline = polylines[i];
+        if (SUIsInvalid(polyline)) {
+            continue;
+        }
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->VisitPolyline(polyline);
+        }
+    }
+}
+
+#pragma mark Images:
+
+void
+SketchUpEntityWalker::_walkImages(SUEntitiesRef entities) {
+    size_t num = 0;
+    SU_CALL(SUEntitiesGetNumImages(entities, &num));
+    if (!num) {
+        return ;
+    }
+    std::vector<SUImageRef> images(num);
+    SU_CALL(SUEntitiesGetImages(entities, num, &images[0], &num));
+    for (size_t i = 0; i < num; i++) {
+        SUImageRef image = images[i];
+        if (SUIsInvalid(image)) {
+            continue;
+        }
+        for (SketchUpEntityVisitor* visitor : _visitors) {
+            visitor->VisitImage(image);
+        }
+    }
+}
+
+#pragma mark Setters/Getters:
+
+bool
+SketchUpEntityWalker::GetVisitFaces() const {
+    return _visitFaces;
+}
+
+bool
+SketchUpEntityWalker::GetVisitEdges() const {
+    return _visitEdges;
+}
+
+bool
+SketchUpEntityWalker::GetVisitCurves() const {
+    return _visitCurves;
+}
+
+bool
+SketchUpEntityWalker::GetVisitPolylines() const {
+    return _visitPolylines;
+}
+
+void
+SketchUpEntityWalker::SetVisitFaces(bool flag) {
+    _visitFaces = flag;
+}
+
+void
+SketchUpEntityWalker::SetVisitEdges(bool flag) {
+    _visitEdges = flag;
+}
+
+void
+SketchUpEntityWalker::SetVisitCurves(bool flag) {
+    _visitCurves = flag;
+}
+
+void
+SketchUpEntityWalker::SetVisitPolylines(bool flag) {
+    _visitPolylines = flag;
+}
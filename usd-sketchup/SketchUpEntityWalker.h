@@ -0,0 +1,122 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpEntityWalker.h
+//
+// Every pass that needs to look at the whole SketchUp model (loading the
+// textures, working out which component definitions are actually used and
+// extracting the geometry) rides along on one walk of it. The walker visits
+// each visible entity once and hands it to every visitor in turn, in the
+// order the visitors were added, so a later visitor can depend on what an
+// earlier one did with the same entity.
+//
+// The walk starts at the model's top level entities. A component definition
+// is walked the first time a visible instance of it is found, so definitions
+// that are never instanced are never visited, and no definition is visited
+// twice no matter how many times it is instanced.
+
+#ifndef SketchUpEntityWalker_h
+#define SketchUpEntityWalker_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <set>
+#include <vector>
+
+#include "SketchUpVisibilityResolver.h"
+
+// The default implementations do nothing, so a visitor only needs to
+// override the entities it cares about.
+class SketchUpEntityVisitor {
+public:
+    virtual ~SketchUpEntityVisitor();
+
+    // everything visited between these two is inside the definition
+    virtual void BeginDefinition(SUComponentDefinitionRef definition);
+    virtual void EndDefinition(SUComponentDefinitionRef definition);
+    // called for every visible instance, before its definition is walked
+    // (which only happens for the first instance of it)
+    virtual void VisitInstance(SUComponentInstanceRef instance,
+                               SUComponentDefinitionRef definition);
+    // everything visited between these two is inside the group
+    virtual void BeginGroup(SUGroupRef group);
+    virtual void EndGroup(SUGroupRef group);
+    virtual void VisitFace(SUFaceRef face);
+    virtual void VisitEdge(SUEdgeRef edge);
+    virtual void VisitCurve(SUCurveRef curve);
+    virtual void VisitPolyline(SUPolyline3dRef polyline);
+    virtual void VisitImage(SUImageRef image);
+};
+
+class SketchUpEntityWalker {
+
+public:
+    SketchUpEntityWalker();
+    ~SketchUpEntityWalker();
+
+    // the walker does not own the visitor
+    void AddVisitor(SketchUpEntityVisitor* visitor);
+
+    // Decides which entities get walked. It should already have been
+    // resolved against the model; if there isn't one, the walker resolves
+    // its own, which only uses the visibility in SketchUp.
+    void SetVisibilityResolver(const SketchUpVisibilityResolver* resolver);
+
+    void Walk(SUModelRef model);
+
+    // Entities we don't need are not even asked for. Instances, groups and
+    // images are always walked.
+    bool GetVisitFaces() const;
+    bool GetVisitEdges() const;
+    bool GetVisitCurves() const;
+    bool GetVisitPolylines() const;
+
+    void SetVisitFaces(bool flag);
+    void SetVisitEdges(bool flag);
+    void SetVisitCurves(bool flag);
+    void SetVisitPolylines(bool flag);
+
+private:
+    std::vector<SketchUpEntityVisitor*> _visitors;
+    const SketchUpVisibilityResolver* _visibility;
+    SketchUpVisibilityResolver _ownVisibility;
+    // the definitions we've already walked, by SketchUp pointer
+    std::set<uintptr_t> _walkedDefinitions;
+
+    bool _visitFaces;
+    bool _visitEdges;
+    bool _visitCurves;
+    bool _visitPolylines;
+
+    bool _isVisible(SUDrawingElementRef drawingElement) const;
+    void _walkEntities(SUEntitiesRef entities);
+    void _walkInstances(SUEntitiesRef entities);
+    void _walkDefinition(SUComponentDefinitionRef definition);
+    void _walkGroups(SUEntitiesRef entities);
+    void _walkFaces(SUEntitiesRef entities);
+    void _walkEdges(SUEntitiesRef entities);
+    void _walkCurves(SUEntitiesRef entities);
+    void _walkPolylines(SUEntitiesRef entities);
+    void _walkImages(SUEntitiesRef entities);
+};
+
+#endif /* SketchUpEntityWalker_h */
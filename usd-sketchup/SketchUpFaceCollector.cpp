@@ -0,0 +1,740 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpFaceCollector.cpp
+//
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "pxr/base/work/loops.h"
+
+#include "GeometryConversion.h"
+#include "PolygonTriangulator.h"
+#include "SketchUpFaceCollector.h"
+#include "USDSketchUpUtilities.h"
+
+#pragma mark Helper definitions:
+
+// how far apart (in inches) two faces can be and still count as coplanar
+static const double coplanarTolerance = 1.0e-6;
+// and how far apart their unit normals can be
+static const double normalTolerance = 1.0e-9;
+// how close the UVs at a shared vertex have to be for the faces to merge
+static const double uvTolerance = 1.0e-9;
+// and how close the UVs one face's texture mapping gives the other face's
+// points, which can be some way off, have to be to theirs
+static const double uvMappingTolerance = 1.0e-6;
+
+// a directed edge, by the SketchUp vertices at its two ends
+typedef std::pair<uintptr_t, uintptr_t> _EdgeKey;
+
+struct _EdgeKeyHash {
+    size_t operator()(const _EdgeKey& edge) const {
+        return std::hash<uintptr_t>()(edge.first) * 31 +
+            std::hash<uintptr_t>()(edge.second);
+    }
+};
+
+#pragma mark SketchUpFaceCollector class:
+
+SketchUpFaceCollector::SketchUpFaceCollector(SUTextureWriterRef textureWriter) :
+    _textureWriter(textureWriter), _collectNormals(true),
+    _collectBackUVs(true), _collectNGons(false), _triangulateLoops(false),
+    _mergeCoplanarFaces(false), _numAddedFaces(0),
+    _numVertices(0), _numPolygons(0), _numIndices(0),
+    _maxFaceVertices(0), _maxFaceIndices(0) {
+}
+
+SketchUpFaceCollector::~SketchUpFaceCollector() {
+    _releaseFaces();
+}
+
+void
+SketchUpFaceCollector::SetCollectNormals(bool flag) {
+    _collectNormals = flag;
+}
+
+void
+SketchUpFaceCollector::SetCollectBackUVs(bool flag) {
+    _collectBackUVs = flag;
+}
+
+void
+SketchUpFaceCollector::SetCollectNGons(bool flag) {
+    _collectNGons = flag;
+}
+
+void
+SketchUpFaceCollector::SetTriangulateLoops(bool flag) {
+    _triangulateLoops = flag;
+}
+
+void
+SketchUpFaceCollector::SetMergeCoplanarFaces(bool flag) {
+    _mergeCoplanarFaces = flag;
+}
+
+void
+SketchUpFaceCollector::AddFace(SUFaceRef face, int frontMaterial,
+                               int backMaterial) {
+    _Face collected;
+    collected.helper = SU_INVALID;
+    collected.frontMaterial = frontMaterial;
+    collected.backMaterial = backMaterial;
+    collected.numVertices = 0;
+    collected.numPolygons = 0;
+    collected.firstLoopPoint = 0;
+    collected.firstLoop = 0;
+    collected.numLoops = 0;
+    collected.normal = {0.0, 0.0, 1.0};
+    collected.triangulate = false;
+    size_t numIndices = 0;
+    if ((_collectNGons || _triangulateLoops || _mergeCoplanarFaces) &&
+        _addLoops(face, collected)) {
+        numIndices = collected.triangulate ? 3 * collected.numPolygons
+                                           : collected.numVertices;
+    } else {
+        SU_CALL(SUMeshHelperCreateWithTextureWriter(&collected.helper, face,
+                                                    _textureWriter));
+        SU_CALL(SUMeshHelperGetNumVertices(collected.helper,
+                                           &collected.numVertices));
+        if (!collected.numVertices) {
+            SU_CALL(SUMeshHelperRelease(&collected.helper));
+            return ;
+        }
+        SU_CALL(SUMeshHelperGetNumTriangles(collected.helper,
+                                            &collected.numPolygons));
+        numIndices = 3 * collected.numPolygons;
+    }
+    _faces.push_back(collected);
+    _numAddedFaces++;
+    _numVertices += collected.numVertices;
+    _numPolygons += collected.numPolygons;
+    _numIndices += numIndices;
+    _maxFaceVertices = std::max(_maxFaceVertices, collected.numVertices);
+    _maxFaceIndices = std::max(_maxFaceIndices, numIndices);
+}
+
+// Reads the points of all the face's loops, and its normal and UVs at each
+// of them. A face with no holes can go out as its outer loop, as long as the
+// loop is convex: renderers split polygons up into fans, which only works
+// for convex ones. Anything else is either triangulated by us later on, or,
+// if we haven't been asked to, left to SketchUp (and we return false).
+bool
+SketchUpFaceCollector::_addLoops(SUFaceRef face, _Face& collected) {
+    const bool triangulate = _triangulateLoops || _mergeCoplanarFaces;
+    size_t numInnerLoops = 0;
+    SU_CALL(SUFaceGetNumInnerLoops(face, &numInnerLoops));
+    if (numInnerLoops && !triangulate) {
+        return false;
+    }
+    const size_t firstPoint = _loopPoints.size();
+    const size_t firstLoop = _loopSizes.size();
+    SULoopRef outerLoop = SU_INVALID;
+    SU_CALL(SUFaceGetOuterLoop(face, &outerLoop));
+    _readLoop(outerLoop);
+    if (numInnerLoops) {
+        _innerLoops.resize(numInnerLoops);
+        SU_CALL(SUFaceGetInnerLoops(face, numInnerLoops, &_innerLoops[0],
+                                    &numInnerLoops));
+        for (size_t i = 0; i < numInnerLoops; i++) {
+            _readLoop(_innerLoops[i]);
+        }
+    }
+    const size_t numLoops = _loopSizes.size() - firstLoop;
+    const size_t numVertices = _loopPoints.size() - firstPoint;
+    bool usable = true;
+    for (size_t i = firstLoop; i < _loopSizes.size(); i++) {
+        usable = usable && _loopSizes[i] >= 3;
+    }
+    SUVector3D normal;
+    SU_CALL(SUFaceGetNormal(face, &normal));
+    const bool asNGon = _collectNGons && usable && numLoops == 1 &&
+        _isConvex(firstPoint, numVertices, normal);
+    if (!usable || (!asNGon && !triangulate)) {
+        _loopPoints.resize(firstPoint);
+        _loopVertexKeys.resize(firstPoint);
+        _loopSizes.resize(firstLoop);
+        return false;
+    }
+    if (_collectNormals) {
+        _loopNormals.resize(firstPoint + numVertices, normal);
+    }
+    // the UVs come from the same texture writer the mesh helpers use, so
+    // they match what SketchUp's triangles would have had
+    SUUVHelperRef uvHelper = SU_INVALID;
+    SU_CALL(SUFaceGetUVHelper(face, true, _collectBackUVs, _textureWriter,
+                              &uvHelper));
+    _loopFrontSTQs.resize(firstPoint + numVertices);
+    if (_collectBackUVs) {
+        _loopBackSTQs.resize(firstPoint + numVertices);
+    }
+    for (size_t i = firstPoint; i < firstPoint + numVertices; i++) {
+        SUUVQ uvq;
+        SU_CALL(SUUVHelperGetFrontUVQ(uvHelper, &_loopPoints[i], &uvq));
+        _loopFrontSTQs[i] = {uvq.u, uvq.v, uvq.q};
+        if (_collectBackUVs) {
+            SU_CALL(SUUVHelperGetBackUVQ(uvHelper, &_loopPoints[i], &uvq));
+            _loopBackSTQs[i] = {uvq.u, uvq.v, uvq.q};
+        }
+    }
+    SU_CALL(SUUVHelperRelease(&uvHelper));
+    if (_mergeCoplanarFaces) {
+        const size_t outerSize = _loopSizes[firstLoop];
+        collected.frontMapping.Fit(&_loopPoints[firstPoint],
+                                   &_loopFrontSTQs[firstPoint], outerSize,
+                                   normal);
+        if (_collectBackUVs) {
+            collected.backMapping.Fit(&_loopPoints[firstPoint],
+                                      &_loopBackSTQs[firstPoint], outerSize,
+                                      normal);
+        }
+    }
+    collected.numVertices = numVertices;
+    collected.firstLoopPoint = firstPoint;
+    collected.firstLoop = firstLoop;
+    collected.numLoops = numLoops;
+    collected.normal = normal;
+    collected.triangulate = !asNGon;
+    collected.numPolygons = asNGon ? 1 :
+        PolygonTriangulator::CountTriangles(&_loopSizes[firstLoop], numLoops);
+    return true;
+}
+
+void
+SketchUpFaceCollector::_readLoop(SULoopRef loop) {
+    size_t numVertices = 0;
+    SU_CALL(SULoopGetNumVertices(loop, &numVertices));
+    const size_t first = _loopPoints.size();
+    if (numVertices) {
+        _loopVertices.resize(numVertices);
+        SU_CALL(SULoopGetVertices(loop, numVertices, &_loopVertices[0],
+                                  &numVertices));
+        _loopPoints.resize(first + numVertices);
+        _loopVertexKeys.resize(first + numVertices);
+        for (size_t i = 0; i < numVertices; i++) {
+            SU_CALL(SUVertexGetPosition(_loopVertices[i],
+                                        &_loopPoints[first + i]));
+            _loopVertexKeys[first + i] = (uintptr_t)_loopVertices[i].ptr;
+        }
+    }
+    _loopSizes.push_back(numVertices);
+}
+
+// The outer loop goes counter-clockwise around the normal, so every corner
+// of a convex loop turns the same way (or not at all).
+bool
+SketchUpFaceCollector::_isConvex(size_t firstPoint, size_t numPoints,
+                                 const SUVector3D& normal) const {
+    const SUPoint3D* points = &_loopPoints[firstPoint];
+    for (size_t i = 0; i < numPoints; i++) {
+        const SUPoint3D& a = points[(i + numPoints - 1) % numPoints];
+        const SUPoint3D& b = points[i];
+        const SUPoint3D& c = points[(i + 1) % numPoints];
+        const double e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+        const double e2x = c.x - b.x, e2y = c.y - b.y, e2z = c.z - b.z;
+        const double turn = (e1y * e2z - e1z * e2y) * normal.x +
+                            (e1z * e2x - e1x * e2z) * normal.y +
+                            (e1x * e2y - e1y * e2x) * normal.z;
+        if (turn < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Finds the regions of faces that can be merged - neighbours that are in the
+// same plane, with the same materials and UVs - and replaces each of them
+// with one face made of the outline of the region, and any holes in it.
+void
+SketchUpFaceCollector::_mergeFaces() {
+    const size_t numPoints = _loopPoints.size();
+    const size_t none = size_t(-1);
+    _nextPoints.assign(numPoints, none);
+    _reversePoints.assign(numPoints, none);
+    _pointFaces.assign(numPoints, none);
+    _seams.assign(numPoints, false);
+    std::unordered_map<_EdgeKey, size_t, _EdgeKeyHash> edges;
+    edges.reserve(numPoints);
+    for (size_t f = 0; f < _faces.size(); f++) {
+        const _Face& face = _faces[f];
+        if (!SUIsInvalid(face.helper)) {
+            continue;
+        }
+        size_t start = face.firstLoopPoint;
+        for (size_t l = 0; l < face.numLoops; l++) {
+            const size_t loopSize = _loopSizes[face.firstLoop + l];
+            for (size_t i = 0; i < loopSize; i++) {
+                const size_t point = start + i;
+                const size_t next = start + (i + 1) % loopSize;
+                _nextPoints[point] = next;
+                _pointFaces[point] = f;
+                auto inserted = edges.insert(std::make_pair(
+                    _EdgeKey(_loopVertexKeys[point], _loopVertexKeys[next]),
+                    point));
+                if (!inserted.second) {
+                    // more than one face goes this way along the edge
+                    inserted.first->second = none;
+                }
+            }
+            start += loopSize;
+        }
+    }
+    if (edges.empty()) {
+        return ;
+    }
+    _faceRegions.resize(_faces.size());
+    for (size_t f = 0; f < _faces.size(); f++) {
+        _faceRegions[f] = f;
+    }
+    for (size_t point = 0; point < numPoints; point++) {
+        if (_nextPoints[point] == none) {
+            continue;
+        }
+        const uintptr_t from = _loopVertexKeys[point];
+        const uintptr_t to = _loopVertexKeys[_nextPoints[point]];
+        auto reverse = edges.find(_EdgeKey(to, from));
+        if (reverse == edges.end() || reverse->second == none ||
+            edges.find(_EdgeKey(from, to))->second == none) {
+            continue;
+        }
+        _reversePoints[point] = reverse->second;
+        if (_canMerge(point)) {
+            _seams[point] = true;
+            const size_t a = _findRegion(_pointFaces[point]);
+            const size_t b = _findRegion(_pointFaces[reverse->second]);
+            _faceRegions[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    // the regions with more than one face in them, in the order we got
+    // their first faces, so the same model always comes out the same way
+    std::vector<size_t> regionSizes(_faces.size(), 0);
+    for (size_t f = 0; f < _faces.size(); f++) {
+        regionSizes[_findRegion(f)]++;
+    }
+    std::vector<size_t> regionIndices(_faces.size(), none);
+    std::vector<std::vector<size_t>> regions;
+    for (size_t f = 0; f < _faces.size(); f++) {
+        const size_t region = _findRegion(f);
+        if (regionSizes[region] < 2) {
+            continue;
+        }
+        if (regionIndices[region] == none) {
+            regionIndices[region] = regions.size();
+            regions.push_back(std::vector<size_t>());
+        }
+        regions[regionIndices[region]].push_back(f);
+    }
+    std::vector<bool> mergedAway(_faces.size(), false);
+    std::vector<_Face> mergedFaces;
+    for (const std::vector<size_t>& region : regions) {
+        _Face merged;
+        if (_mergeRegion(region, merged)) {
+            for (size_t f : region) {
+                mergedAway[f] = true;
+            }
+            mergedFaces.push_back(merged);
+        }
+    }
+    if (mergedFaces.empty()) {
+        return ;
+    }
+    std::vector<_Face> faces;
+    faces.reserve(_faces.size());
+    for (size_t f = 0; f < _faces.size(); f++) {
+        if (!mergedAway[f]) {
+            faces.push_back(_faces[f]);
+        }
+    }
+    faces.insert(faces.end(), mergedFaces.begin(), mergedFaces.end());
+    _faces.swap(faces);
+    _countFaces();
+}
+
+size_t
+SketchUpFaceCollector::_findRegion(size_t face) {
+    while (_faceRegions[face] != face) {
+        _faceRegions[face] = _faceRegions[_faceRegions[face]];
+        face = _faceRegions[face];
+    }
+    return face;
+}
+
+// whether the faces on either side of the edge starting at point can merge
+bool
+SketchUpFaceCollector::_canMerge(size_t point) const {
+    const size_t reverse = _reversePoints[point];
+    const _Face& a = _faces[_pointFaces[point]];
+    const _Face& b = _faces[_pointFaces[reverse]];
+    if (&a == &b || a.frontMaterial != b.frontMaterial ||
+        a.backMaterial != b.backMaterial) {
+        return false;
+    }
+    const SUVector3D& n = a.normal;
+    const SUVector3D& m = b.normal;
+    if (n.x * m.x + n.y * m.y + n.z * m.z < 1.0 - normalTolerance) {
+        return false;
+    }
+    // both faces share this edge, so any point of b will do
+    const SUPoint3D& p = _loopPoints[a.firstLoopPoint];
+    const SUPoint3D& q = _loopPoints[b.firstLoopPoint];
+    const double distance = n.x * (q.x - p.x) + n.y * (q.y - p.y) +
+                            n.z * (q.z - p.z);
+    if (std::fabs(distance) > coplanarTolerance) {
+        return false;
+    }
+    // The texture has to carry on across the edge without a seam, and not
+    // just along it: tiles that are mirrored (or sheared, or scaled) across
+    // the edge agree on it, but the triangles of the merged face would
+    // stretch the texture between the two.
+    if (!_sameUVs(point, _nextPoints[reverse]) ||
+        !_sameUVs(_nextPoints[point], reverse)) {
+        return false;
+    }
+    if (!a.frontMapping.Matches(b.frontMapping, uvMappingTolerance) ||
+        !b.frontMapping.Matches(a.frontMapping, uvMappingTolerance)) {
+        return false;
+    }
+    return !_collectBackUVs ||
+        (a.backMapping.Matches(b.backMapping, uvMappingTolerance) &&
+         b.backMapping.Matches(a.backMapping, uvMappingTolerance));
+}
+
+bool
+SketchUpFaceCollector::_sameUVs(size_t a, size_t b) const {
+    auto same = [](const SUPoint3D& p, const SUPoint3D& q) {
+        return std::fabs(p.x - q.x) <= uvTolerance &&
+            std::fabs(p.y - q.y) <= uvTolerance &&
+            std::fabs(p.z - q.z) <= uvTolerance;
+    };
+    return same(_loopFrontSTQs[a], _loopFrontSTQs[b]) &&
+        (!_collectBackUVs || same(_loopBackSTQs[a], _loopBackSTQs[b]));
+}
+
+// Walks the edges of the region that aren't seams into loops, and adds a
+// face made of them. Gives up (and the faces stay as they were) unless that
+// makes one outer loop with holes in it, without touching itself.
+bool
+SketchUpFaceCollector::_mergeRegion(const std::vector<size_t>& region,
+                                    _Face& merged) {
+    const size_t none = size_t(-1);
+    const size_t regionId = _findRegion(region[0]);
+    // each vertex on the outline should have exactly one edge leaving it
+    std::unordered_map<uintptr_t, size_t> outline;
+    std::vector<size_t> outlinePoints;
+    for (size_t f : region) {
+        const _Face& face = _faces[f];
+        const size_t end = face.firstLoopPoint + face.numVertices;
+        for (size_t point = face.firstLoopPoint; point < end; point++) {
+            const size_t reverse = _reversePoints[point];
+            if (reverse != none &&
+                _findRegion(_pointFaces[reverse]) == regionId) {
+                if (!_seams[point]) {
+                    // in the middle of the region, but not mergeable
+                    return false;
+                }
+                continue;
+            }
+            if (!outline.insert(std::make_pair(_loopVertexKeys[point],
+                                               point)).second) {
+                return false;
+            }
+            outlinePoints.push_back(point);
+        }
+    }
+    // each loop starts from the first of its points we came across
+    std::vector<std::vector<size_t>> loops;
+    for (size_t first : outlinePoints) {
+        auto found = outline.find(_loopVertexKeys[first]);
+        if (found == outline.end()) {
+            continue;
+        }
+        std::vector<size_t> loop;
+        size_t point = first;
+        outline.erase(found);
+        const uintptr_t start = _loopVertexKeys[point];
+        while (true) {
+            loop.push_back(point);
+            const uintptr_t next = _loopVertexKeys[_nextPoints[point]];
+            if (next == start) {
+                break;
+            }
+            auto following = outline.find(next);
+            if (following == outline.end()) {
+                return false;
+            }
+            point = following->second;
+            outline.erase(following);
+        }
+        if (loop.size() < 3) {
+            return false;
+        }
+        loops.push_back(loop);
+    }
+    // the outer loop is the one that goes counter-clockwise
+    const SUVector3D& normal = _faces[region[0]].normal;
+    int outer = -1;
+    for (size_t l = 0; l < loops.size(); l++) {
+        const SUPoint3D& o = _loopPoints[loops[l][0]];
+        double area = 0.0;
+        for (size_t i = 0; i < loops[l].size(); i++) {
+            const SUPoint3D& p = _loopPoints[loops[l][i]];
+            const SUPoint3D& q = _loopPoints[loops[l][(i + 1) % loops[l].size()]];
+            const double px = p.x - o.x, py = p.y - o.y, pz = p.z - o.z;
+            const double qx = q.x - o.x, qy = q.y - o.y, qz = q.z - o.z;
+            area += (py * qz - pz * qy) * normal.x +
+                    (pz * qx - px * qz) * normal.y +
+                    (px * qy - py * qx) * normal.z;
+        }
+        if (area > 0.0) {
+            if (outer >= 0) {
+                return false;
+            }
+            outer = (int)l;
+        }
+    }
+    if (outer < 0) {
+        return false;
+    }
+    std::swap(loops[0], loops[outer]);
+
+    merged = _faces[region[0]];
+    merged.firstLoopPoint = _loopPoints.size();
+    merged.firstLoop = _loopSizes.size();
+    merged.numLoops = loops.size();
+    merged.numVertices = 0;
+    for (const std::vector<size_t>& loop : loops) {
+        for (size_t point : loop) {
+            // copied first, in case the arrays move as they grow
+            const SUPoint3D position = _loopPoints[point];
+            const uintptr_t key = _loopVertexKeys[point];
+            const SUPoint3D frontSTQ = _loopFrontSTQs[point];
+            _loopPoints.push_back(position);
+            _loopVertexKeys.push_back(key);
+            _loopFrontSTQs.push_back(frontSTQ);
+            if (_collectNormals) {
+                const SUVector3D pointNormal = _loopNormals[point];
+                _loopNormals.push_back(pointNormal);
+            }
+            if (_collectBackUVs) {
+                const SUPoint3D backSTQ = _loopBackSTQs[point];
+                _loopBackSTQs.push_back(backSTQ);
+            }
+        }
+        _loopSizes.push_back(loop.size());
+        merged.numVertices += loop.size();
+    }
+    const bool asNGon = _collectNGons && loops.size() == 1 &&
+        _isConvex(merged.firstLoopPoint, merged.numVertices, normal);
+    merged.triangulate = !asNGon;
+    merged.numPolygons = asNGon ? 1 :
+        PolygonTriangulator::CountTriangles(&_loopSizes[merged.firstLoop],
+                                            merged.numLoops);
+    return true;
+}
+
+// works out the totals again once faces have been merged
+void
+SketchUpFaceCollector::_countFaces() {
+    _numVertices = 0;
+    _numPolygons = 0;
+    _numIndices = 0;
+    _maxFaceVertices = 0;
+    _maxFaceIndices = 0;
+    for (const _Face& face : _faces) {
+        const size_t numIndices = (SUIsInvalid(face.helper) &&
+                                   !face.triangulate) ?
+            face.numVertices : 3 * face.numPolygons;
+        _numVertices += face.numVertices;
+        _numPolygons += face.numPolygons;
+        _numIndices += numIndices;
+        _maxFaceVertices = std::max(_maxFaceVertices, face.numVertices);
+        _maxFaceIndices = std::max(_maxFaceIndices, numIndices);
+    }
+}
+
+void
+SketchUpFaceCollector::Fill(SceneMesh& mesh) {
+    if (_faces.empty()) {
+        return ;
+    }
+    if (_mergeCoplanarFaces) {
+        _mergeFaces();
+    }
+    const size_t vertexOrigin = mesh.points.size();
+    const size_t polygonOrigin = mesh.faceVertexCounts.size();
+    const size_t indexOrigin = mesh.faceVertexIndices.size();
+    mesh.points.resize(vertexOrigin + _numVertices);
+    mesh.frontUVs.resize(vertexOrigin + _numVertices);
+    if (_collectNormals) {
+        mesh.normals.resize(vertexOrigin + _numVertices);
+    }
+    if (_collectBackUVs) {
+        mesh.backUVs.resize(vertexOrigin + _numVertices);
+    }
+    mesh.faceVertexCounts.resize(polygonOrigin + _numPolygons);
+    mesh.faceVertexIndices.resize(indexOrigin + _numIndices);
+    mesh.frontMaterials.resize(polygonOrigin + _numPolygons);
+    mesh.backMaterials.resize(polygonOrigin + _numPolygons);
+
+    // VtArray::data() checks whether it needs to copy every time it's
+    // called, so we only ask once
+    pxr::GfVec3f* points = mesh.points.data() + vertexOrigin;
+    pxr::GfVec2f* frontUVs = mesh.frontUVs.data() + vertexOrigin;
+    pxr::GfVec3f* normals = _collectNormals ?
+        mesh.normals.data() + vertexOrigin : NULL;
+    pxr::GfVec2f* backUVs = _collectBackUVs ?
+        mesh.backUVs.data() + vertexOrigin : NULL;
+    int* counts = mesh.faceVertexCounts.data() + polygonOrigin;
+    int* indices = mesh.faceVertexIndices.data() + indexOrigin;
+
+    std::vector<SUPoint3D> faceVertices(_maxFaceVertices);
+    std::vector<SUVector3D> faceNormals(_collectNormals ? _maxFaceVertices : 0);
+    std::vector<SUPoint3D> faceSTQs(_maxFaceVertices);
+    std::vector<size_t> faceIndices(_maxFaceIndices);
+    size_t vertex = vertexOrigin;
+    size_t polygon = polygonOrigin;
+    // the faces we triangulate ourselves, and where their indices go
+    struct _Triangulation {
+        const _Face* face;
+        int firstVertex;
+        int* indices;
+    };
+    std::vector<_Triangulation> triangulations;
+    for (_Face& face : _faces) {
+        const size_t numVertices = face.numVertices;
+        // each polygon remembers the materials of the face it came from
+        std::fill(mesh.frontMaterials.begin() + polygon,
+                  mesh.frontMaterials.begin() + polygon + face.numPolygons,
+                  face.frontMaterial);
+        std::fill(mesh.backMaterials.begin() + polygon,
+                  mesh.backMaterials.begin() + polygon + face.numPolygons,
+                  face.backMaterial);
+        polygon += face.numPolygons;
+        if (SUIsInvalid(face.helper)) {
+            const size_t first = face.firstLoopPoint;
+            ConvertPointsToCM(&_loopPoints[first], numVertices, points);
+            points += numVertices;
+            if (normals) {
+                ConvertVectors(&_loopNormals[first], numVertices, normals);
+                normals += numVertices;
+            }
+            ConvertSTQsToUVs(&_loopFrontSTQs[first], numVertices, frontUVs);
+            frontUVs += numVertices;
+            if (backUVs) {
+                ConvertSTQsToUVs(&_loopBackSTQs[first], numVertices, backUVs);
+                backUVs += numVertices;
+            }
+            if (face.triangulate) {
+                std::fill(counts, counts + face.numPolygons, 3);
+                counts += face.numPolygons;
+                triangulations.push_back({&face, int(vertex), indices});
+                indices += 3 * face.numPolygons;
+            } else {
+                *counts++ = int(numVertices);
+                for (size_t i = 0; i < numVertices; i++) {
+                    *indices++ = int(vertex + i);
+                }
+            }
+            vertex += numVertices;
+            continue;
+        }
+        size_t actual = 0;
+        SU_CALL(SUMeshHelperGetVertices(face.helper, numVertices,
+                                        &faceVertices[0], &actual));
+        // note: SketchUp uses inches. Pretty much every other DCC out
+        // there uses metric units, and most use cm. Because of that,
+        // I'm going to export to cm. Note we'll need to modify the
+        // translate component of the objects' 4x4 and the camera's 4x4
+        ConvertPointsToCM(&faceVertices[0], numVertices, points);
+        points += numVertices;
+        if (normals) {
+            SU_CALL(SUMeshHelperGetNormals(face.helper, numVertices,
+                                           &faceNormals[0], &actual));
+            ConvertVectors(&faceNormals[0], numVertices, normals);
+            normals += numVertices;
+        }
+        SU_CALL(SUMeshHelperGetFrontSTQCoords(face.helper, numVertices,
+                                              &faceSTQs[0], &actual));
+        ConvertSTQsToUVs(&faceSTQs[0], numVertices, frontUVs);
+        frontUVs += numVertices;
+        if (backUVs) {
+            SU_CALL(SUMeshHelperGetBackSTQCoords(face.helper, numVertices,
+                                                 &faceSTQs[0], &actual));
+            ConvertSTQsToUVs(&faceSTQs[0], numVertices, backUVs);
+            backUVs += numVertices;
+        }
+        const size_t numIndices = 3 * face.numPolygons;
+        if (numIndices) {
+            SU_CALL(SUMeshHelperGetVertexIndices(face.helper, numIndices,
+                                                 &faceIndices[0], &actual));
+        }
+        std::fill(counts, counts + face.numPolygons, 3); // all triangles
+        counts += face.numPolygons;
+        for (size_t i = 0; i < numIndices; i++) {
+            *indices++ = int(vertex + faceIndices[i]);
+        }
+        vertex += numVertices;
+        // free all the memory we allocated here via the SU API
+        SU_CALL(SUMeshHelperRelease(&face.helper));
+    }
+    // every face already knows where its vertices and triangles go, so they
+    // can be triangulated in any order
+    pxr::WorkParallelForN(triangulations.size(),
+                          [this, &triangulations](size_t begin, size_t end) {
+        PolygonTriangulator triangulator;
+        for (size_t i = begin; i < end; i++) {
+            const _Face& face = *triangulations[i].face;
+            triangulator.Triangulate(&_loopPoints[face.firstLoopPoint],
+                                     &_loopSizes[face.firstLoop],
+                                     face.numLoops, face.normal,
+                                     triangulations[i].firstVertex,
+                                     triangulations[i].indices);
+        }
+    });
+    mesh.originalFacesCount += _numAddedFaces;
+    _faces.clear();
+    _numAddedFaces = 0;
+    _loopPoints.clear();
+    _loopVertexKeys.clear();
+    _loopNormals.clear();
+    _loopFrontSTQs.clear();
+    _loopBackSTQs.clear();
+    _loopSizes.clear();
+    _numVertices = 0;
+    _numPolygons = 0;
+    _numIndices = 0;
+    _maxFaceVertices = 0;
+    _maxFaceIndices = 0;
+}
+
+void
+SketchUpFaceCollector::_releaseFaces() {
+    for (_Face& face : _faces) {
+        if (!SUIsInvalid(face.helper)) {
+            SUMeshHelperRelease(&face.helper);
+        }
+    }
+    _faces.clear();
+}
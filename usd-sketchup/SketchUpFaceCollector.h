@@ -0,0 +1,146 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpFaceCollector.h
+//
+
+#ifndef SketchUpFaceCollector_h
+#define SketchUpFaceCollector_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <stdio.h>
+#include <vector>
+
+#include "SketchUpScene.h"
+#include "UVMapping.h"
+
+// Collects the faces of one SketchUp entities block into a SceneMesh in
+// two passes. AddFace triangulates a face (or, if asked to, reads its loops
+// to be triangulated later, or to go out as a single polygon) and counts its
+// vertices and polygons, and Fill then sizes every array in the mesh once for
+// all the faces together and copies each face straight into its place. That
+// way the mesh arrays never grow one element at a time.
+//
+// The SketchUp mesh helpers are held on to between the two passes, and
+// released by Fill (or when the collector goes away). The faces whose loops
+// were read are triangulated by Fill with a PolygonTriangulator, on as many
+// threads as we have, since that doesn't need the SketchUp API. Before that,
+// neighbouring faces that lie in the same plane and look the same can be
+// merged into one polygon.
+class SketchUpFaceCollector {
+public:
+    explicit SketchUpFaceCollector(SUTextureWriterRef textureWriter);
+    ~SketchUpFaceCollector();
+
+    // these all have to be set before the first face is added
+    void SetCollectNormals(bool flag);
+    void SetCollectBackUVs(bool flag);
+    // keep the convex faces without holes as single polygons
+    void SetCollectNGons(bool flag);
+    // triangulate with PolygonTriangulator rather than SketchUp
+    void SetTriangulateLoops(bool flag);
+    // Merge neighbouring faces that are in the same plane and have the same
+    // materials, with their textures laid out the same way (see UVMapping).
+    // The merged faces are always triangulated by us.
+    void SetMergeCoplanarFaces(bool flag);
+
+    // the materials are indices into SketchUpScene::materials, or -1
+    void AddFace(SUFaceRef face, int frontMaterial, int backMaterial);
+    // appends everything added since the last Fill to mesh
+    void Fill(SceneMesh& mesh);
+
+private:
+    SketchUpFaceCollector(const SketchUpFaceCollector&) = delete;
+    SketchUpFaceCollector& operator=(const SketchUpFaceCollector&) = delete;
+
+    // A face is either triangulated by its mesh helper, or (if the helper is
+    // invalid) its loops have been read into the _loop arrays, starting at
+    // firstLoopPoint, and it's either triangulated by us or a single polygon.
+    struct _Face {
+        SUMeshHelperRef helper;
+        int frontMaterial;
+        int backMaterial;
+        size_t numVertices;
+        size_t numPolygons;
+        size_t firstLoopPoint;
+        size_t firstLoop;
+        size_t numLoops;
+        SUVector3D normal;
+        bool triangulate;
+        // only fitted when we're merging faces
+        UVMapping frontMapping;
+        UVMapping backMapping;
+    };
+
+    SUTextureWriterRef _textureWriter;
+    bool _collectNormals;
+    bool _collectBackUVs;
+    bool _collectNGons;
+    bool _triangulateLoops;
+    bool _mergeCoplanarFaces;
+    std::vector<_Face> _faces;
+    // how many SketchUp faces were added, whether or not they were merged
+    size_t _numAddedFaces;
+    size_t _numVertices;
+    size_t _numPolygons;
+    size_t _numIndices;
+    // the biggest single face, so one set of scratch buffers fits them all
+    size_t _maxFaceVertices;
+    size_t _maxFaceIndices;
+
+    // the vertices of the faces whose loops we read (and which SketchUp
+    // vertex each one is), and how many of them are in each loop
+    std::vector<SUPoint3D> _loopPoints;
+    std::vector<uintptr_t> _loopVertexKeys;
+    std::vector<SUVector3D> _loopNormals;
+    std::vector<SUPoint3D> _loopFrontSTQs;
+    std::vector<SUPoint3D> _loopBackSTQs;
+    std::vector<size_t> _loopSizes;
+    // scratch space for reading a face's loops
+    std::vector<SULoopRef> _innerLoops;
+    std::vector<SUVertexRef> _loopVertices;
+    // Scratch space for merging faces, all indexed by loop point, where each
+    // point also stands for the edge from it to the next one in its loop.
+    // The reverse of an edge is the one going the other way on another face
+    // (if there's exactly one), and the edge is a seam if the two faces
+    // can be merged along it.
+    std::vector<size_t> _nextPoints;
+    std::vector<size_t> _reversePoints;
+    std::vector<size_t> _pointFaces;
+    std::vector<bool> _seams;
+    std::vector<size_t> _faceRegions;
+
+    bool _addLoops(SUFaceRef face, _Face& collected);
+    void _readLoop(SULoopRef loop);
+    bool _isConvex(size_t firstPoint, size_t numPoints,
+                   const SUVector3D& normal) const;
+    void _mergeFaces();
+    bool _canMerge(size_t point) const;
+    bool _sameUVs(size_t a, size_t b) const;
+    size_t _findRegion(size_t face);
+    bool _mergeRegion(const std::vector<size_t>& region, _Face& merged);
+    void _countFaces();
+    void _releaseFaces();
+};
+
+#endif /* SketchUpFaceCollector_h */
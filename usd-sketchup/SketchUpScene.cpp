@@ -0,0 +1,151 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+
+#include <iostream>
+
+#include "SketchUpScene.h"
+
+SceneMaterial::SceneMaterial() : hasColor(false), rgb(1.0, 1.0, 1.0),
+                                 opacity(1.0) {
+}
+
+SceneMesh::SceneMesh() : originalFacesCount(0) {
+}
+
+SceneInstance::SceneInstance() : definition(0), transform(1.0), material(-1) {
+}
+
+SceneGroup::SceneGroup() : transform(1.0),
+                           entities(std::make_shared<SceneEntities>()) {
+}
+
+SceneDefinition::SceneDefinition() : key(0), isBillboard(false),
+                                     instanceCount(0) {
+}
+
+SceneCamera::SceneCamera() : hasAspectRatio(false), aspectRatio(1.0),
+                             isPerspective(false), verticalFOV(0.0),
+                             orthographicHeight(1.0) {
+}
+
+SketchUpScene::SketchUpScene() {
+}
+
+SketchUpScene::~SketchUpScene() {
+}
+
+void
+SketchUpScene::Clear() {
+    materials.clear();
+    definitions.clear();
+    entities = SceneEntities();
+    children.clear();
+    cameras.clear();
+    _definitionIndices.clear();
+}
+
+const SceneDefinition*
+SketchUpScene::FindDefinition(uintptr_t key) const {
+    auto found = _definitionIndices.find(key);
+    if (found == _definitionIndices.end()) {
+        return NULL;
+    }
+    return &definitions[found->second];
+}
+
+SceneDefinition&
+SketchUpScene::AddDefinition(uintptr_t key) {
+    _definitionIndices[key] = definitions.size();
+    definitions.push_back(SceneDefinition());
+    SceneDefinition& definition = definitions.back();
+    definition.key = key;
+    return definition;
+}
+
+void
+SketchUpScene::OrderDefinitions(const std::vector<uintptr_t>& keys) {
+    std::deque<SceneDefinition> ordered;
+    std::map<uintptr_t, size_t> orderedIndices;
+    for (uintptr_t key : keys) {
+        auto found = _definitionIndices.find(key);
+        if (found == _definitionIndices.end()) {
+            continue;
+        }
+        orderedIndices[key] = ordered.size();
+        ordered.push_back(std::move(definitions[found->second]));
+    }
+    definitions.swap(ordered);
+    _definitionIndices.swap(orderedIndices);
+}
+
+// The definitions only ever instance each other one way (SketchUp won't let
+// a component contain itself), so we can go through them parents first and
+// hand each one's count down to its children. Every definition and every
+// parent/child pair is only looked at once.
+void
+SketchUpScene::CountInstances() {
+    std::vector<size_t> pendingParents(definitions.size(), 0);
+    for (SceneDefinition& definition : definitions) {
+        definition.instanceCount = 0;
+        for (auto& child : definition.children) {
+            auto found = _definitionIndices.find(child.first);
+            if (found != _definitionIndices.end()) {
+                pendingParents[found->second]++;
+            }
+        }
+    }
+    for (auto& child : children) {
+        auto found = _definitionIndices.find(child.first);
+        if (found != _definitionIndices.end()) {
+            definitions[found->second].instanceCount += child.second;
+        }
+    }
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < definitions.size(); i++) {
+        if (!pendingParents[i]) {
+            ready.push_back(i);
+        }
+    }
+    size_t counted = 0;
+    while (!ready.empty()) {
+        const SceneDefinition& definition = definitions[ready.back()];
+        ready.pop_back();
+        counted++;
+        for (auto& child : definition.children) {
+            auto found = _definitionIndices.find(child.first);
+            if (found == _definitionIndices.end()) {
+                continue;
+            }
+            SceneDefinition& childDefinition = definitions[found->second];
+            childDefinition.instanceCount += definition.instanceCount * child.second;
+            if (--pendingParents[found->second] == 0) {
+                ready.push_back(found->second);
+            }
+        }
+    }
+    if (counted != definitions.size()) {
+        std::cerr << "WARNING: component definitions instance each other"
+                  << " in a cycle, their instance counts will be incomplete"
+                  << std::endl;
+    }
+}
@@ -0,0 +1,190 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//
+//  SketchUpScene.h
+//
+// This is our in-memory version of a SketchUp model. The export happens in
+// two phases: first SketchUpSceneExtractor walks the model with the SketchUp
+// C API and fills one of these in, and then USDExporter authors the USD from
+// it. Nothing in here refers back to the SketchUp model, so once it has been
+// filled in the model can be released, and nothing that reads it needs to
+// call into the (not thread safe) SketchUp API.
+//
+// Units have already been converted where the conversion is unambiguous
+// (mesh points and curve points are in cm), everything else is as SketchUp
+// gave it to us.
+
+#ifndef SketchUpScene_h
+#define SketchUpScene_h
+
+#include <stdio.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/vec2f.h"
+#include "pxr/base/gf/vec3d.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/vt/array.h"
+
+// A SketchUp material, as it was found on a face, group or instance. We only
+// keep what we actually write out: the color and the texture file name.
+struct SceneMaterial {
+    SceneMaterial();
+
+    bool hasColor;
+    pxr::GfVec3f rgb;
+    float opacity;
+    // empty if this material has no texture
+    std::string textureName;
+};
+
+// All the faces of one SketchUp entities block as a single mesh. The faces
+// are triangulated, except for the ones the extractor was told it could keep
+// as polygons (see SketchUpSceneExtractor::SetExtractNGons). The per polygon
+// materials are indices into SketchUpScene::materials,
+// or -1 if that side of the face had no material.
+// The normals and back UVs are left empty if the extractor was told we won't
+// be writing them.
+struct SceneMesh {
+    SceneMesh();
+
+    pxr::VtArray<pxr::GfVec3f> points;
+    pxr::VtArray<pxr::GfVec3f> normals;
+    pxr::VtArray<pxr::GfVec2f> frontUVs;
+    pxr::VtArray<pxr::GfVec2f> backUVs;
+    pxr::VtArray<int> faceVertexCounts;
+    pxr::VtArray<int> faceVertexIndices;
+    std::vector<int> frontMaterials;
+    std::vector<int> backMaterials;
+    // how many SketchUp faces these polygons came from
+    size_t originalFacesCount;
+};
+
+// Edges, curves and polylines all end up as linear basis curves.
+struct SceneCurves {
+    pxr::VtArray<pxr::GfVec3f> points;
+    pxr::VtArray<int> vertexCounts;
+};
+
+struct SceneEntities;
+
+struct SceneInstance {
+    SceneInstance();
+
+    // the SketchUp pointer of the definition, see SketchUpScene::definitions
+    uintptr_t definition;
+    pxr::GfMatrix4d transform;
+    // index into SketchUpScene::materials, or -1
+    int material;
+};
+
+struct SceneGroup {
+    SceneGroup();
+
+    // the raw SketchUp name, which is often empty
+    std::string name;
+    pxr::GfMatrix4d transform;
+    std::shared_ptr<SceneEntities> entities;
+};
+
+// Only visible entities make it in here - hidden ones and those on hidden
+// layers are dropped during extraction.
+struct SceneEntities {
+    std::vector<SceneInstance> instances;
+    std::vector<SceneGroup> groups;
+    SceneMesh mesh;
+    SceneCurves edges;
+    SceneCurves curves;
+    SceneCurves polylines;
+};
+
+struct SceneDefinition {
+    SceneDefinition();
+
+    uintptr_t key;
+    std::string name;
+    bool isBillboard;
+    SceneEntities entities;
+    // The definitions instanced in this one (including inside its groups),
+    // keyed like SceneInstance::definition, with how many times each is
+    // instanced. Together with SketchUpScene::children, this is the graph
+    // of which definitions use which.
+    std::map<uintptr_t, unsigned long long> children;
+    // how many times this definition shows up in the scene once every
+    // instance has been flattened out, see SketchUpScene::CountInstances
+    unsigned long long instanceCount;
+};
+
+// The camera values are kept in SketchUp's units (inches), since we also
+// write them out as-is as custom data.
+struct SceneCamera {
+    SceneCamera();
+
+    std::string name;
+    pxr::GfVec3d position;
+    pxr::GfVec3d target;
+    pxr::GfVec3d upVector;
+    bool hasAspectRatio;
+    double aspectRatio;
+    bool isPerspective;
+    double verticalFOV;
+    double orthographicHeight;
+};
+
+class SketchUpScene {
+public:
+    SketchUpScene();
+    ~SketchUpScene();
+
+    void Clear();
+
+    // returns NULL if the definition was not extracted (i.e. is not used)
+    const SceneDefinition* FindDefinition(uintptr_t key) const;
+    // note: the returned reference stays good while more are added, so a
+    // definition can be filled in while the ones it instances are added
+    SceneDefinition& AddDefinition(uintptr_t key);
+    // puts the definitions in the given order; any that are not in keys
+    // are dropped
+    void OrderDefinitions(const std::vector<uintptr_t>& keys);
+    // fills in every definition's instanceCount from the children, in time
+    // linear in the size of the graph
+    void CountInstances();
+
+    std::vector<SceneMaterial> materials;
+    // once extracted, in the order SketchUp gave them to us, which is the
+    // order we write them
+    std::deque<SceneDefinition> definitions;
+    SceneEntities entities;
+    // the definitions instanced in entities (including inside its groups)
+    std::map<uintptr_t, unsigned long long> children;
+    std::vector<SceneCamera> cameras;
+
+private:
+    std::map<uintptr_t, size_t> _definitionIndices;
+};
+
+#endif /* SketchUpScene_h */
@@ -0,0 +1,557 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpSceneExtractor.cpp
+//
+#include <regex>
+#include <iostream>
+
+#include "GeometryConversion.h"
+#include "SketchUpSceneExtractor.h"
+#include "USDSketchUpUtilities.h"
+
+#include "pxr/base/tf/stringUtils.h"
+
+#pragma mark SketchUpSceneExtractor class:
+
+SketchUpSceneExtractor::SketchUpSceneExtractor() : _model(SU_INVALID),
+    _textureWriter(SU_INVALID), _scene(NULL), _visibility(NULL) {
+    SetExtractFaces(true);
+    SetExtractEdges(true);
+    SetExtractCurves(true);
+    SetExtractLines(true);
+    SetExtractCameras(true);
+    SetExtractNormals(true);
+    SetExtractBackUVs(true);
+    SetExtractNGons(false);
+    SetNativeTriangulation(false);
+    SetMergeCoplanarFaces(false);
+}
+
+SketchUpSceneExtractor::~SketchUpSceneExtractor() {
+}
+
+void
+SketchUpSceneExtractor::AddVisitor(SketchUpEntityVisitor* visitor) {
+    _visitors.push_back(visitor);
+}
+
+void
+SketchUpSceneExtractor::SetVisibilityResolver(const SketchUpVisibilityResolver* resolver) {
+    _visibility = resolver;
+}
+
+void
+SketchUpSceneExtractor::Extract(SUModelRef model,
+                                SUTextureWriterRef textureWriter,
+                                SketchUpScene& scene) {
+    _model = model;
+    _textureWriter = textureWriter;
+    _scene = &scene;
+    _scene->Clear();
+    _materialIndices.clear();
+
+    SketchUpEntityWalker walker;
+    walker.SetVisitFaces(GetExtractFaces());
+    walker.SetVisitEdges(GetExtractEdges());
+    walker.SetVisitCurves(GetExtractCurves());
+    walker.SetVisitPolylines(GetExtractLines());
+    walker.SetVisibilityResolver(_visibility);
+    for (SketchUpEntityVisitor* visitor : _visitors) {
+        walker.AddVisitor(visitor);
+    }
+    walker.AddVisitor(this);
+    _targets.clear();
+    _pushTarget(&_scene->entities, -1, &_scene->children);
+    walker.Walk(_model);
+    _popTarget();
+    _orderDefinitions();
+    _scene->CountInstances();
+
+    if (GetExtractCameras()) {
+        _ExtractCameras();
+    }
+    // we don't hold on to anything from the model past this point
+    _materialIndices.clear();
+    _scene = NULL;
+    SUSetInvalid(_textureWriter);
+    SUSetInvalid(_model);
+}
+
+void
+SketchUpSceneExtractor::_pushTarget(SceneEntities* entities, int material,
+                                    std::map<uintptr_t, unsigned long long>* children) {
+    std::unique_ptr<SketchUpFaceCollector> faces(
+        new SketchUpFaceCollector(_textureWriter));
+    faces->SetCollectNormals(_extractNormals);
+    faces->SetCollectBackUVs(_extractBackUVs);
+    faces->SetCollectNGons(_extractNGons);
+    faces->SetTriangulateLoops(_nativeTriangulation);
+    faces->SetMergeCoplanarFaces(_mergeCoplanarFaces);
+    _targets.push_back({entities, material, children, std::move(faces)});
+}
+
+void
+SketchUpSceneExtractor::_popTarget() {
+    _Target& target = _targets.back();
+    target.faces->Fill(target.entities->mesh);
+    _fillCurvePoints(target.edgePoints, target.entities->edges);
+    _fillCurvePoints(target.curvePoints, target.entities->curves);
+    _fillCurvePoints(target.polylinePoints, target.entities->polylines);
+    _targets.pop_back();
+}
+
+void
+SketchUpSceneExtractor::_fillCurvePoints(const std::vector<SUPoint3D>& points,
+                                         SceneCurves& curves) {
+    if (points.empty()) {
+        return ;
+    }
+    const size_t origin = curves.points.size();
+    curves.points.resize(origin + points.size());
+    ConvertPointsToCM(&points[0], points.size(), curves.points.data() + origin);
+}
+
+#pragma mark Components:
+
+// The walker hands us the definitions as it first finds an instance of
+// them, but we write them out in the order SketchUp keeps them in.
+void
+SketchUpSceneExtractor::_orderDefinitions() {
+    if (_scene->definitions.empty()) {
+        return ;
+    }
+    size_t num_comp_defs = 0;
+    SU_CALL(SUModelGetNumComponentDefinitions(_model, &num_comp_defs));
+    if (!num_comp_defs) {
+        return ;
+    }
+    std::vector<SUComponentDefinitionRef> comp_defs(num_comp_defs);
+    SU_CALL(SUModelGetComponentDefinitions(_model, num_comp_defs,
+                                           &comp_defs[0], &num_comp_defs));
+    std::vector<uintptr_t> keys;
+    keys.reserve(num_comp_defs);
+    for (size_t def = 0; def < num_comp_defs; ++def) {
+        keys.push_back(reinterpret_cast<uintptr_t>(comp_defs[def].ptr));
+    }
+    _scene->OrderDefinitions(keys);
+}
+
+void
+SketchUpSceneExtractor::BeginDefinition(SUComponentDefinitionRef comp_def) {
+    // unfortunately, we can't depend that the name of the definition will
+    // be unique across the file so we use its pointer as the key.
+    uintptr_t key = reinterpret_cast<uintptr_t>(comp_def.ptr);
+    SceneDefinition& definition = _scene->AddDefinition(key);
+    definition.name = GetComponentDefinitionName(comp_def);
+
+    SUComponentBehavior behavior;
+    SU_CALL(SUComponentDefinitionGetBehavior(comp_def, &behavior));
+    definition.isBillboard = behavior.component_always_face_camera;
+
+    int definitionMaterial = -1;
+    SUEntityRef entity = SUComponentDefinitionToEntity(comp_def);
+    if (SUIsValid(entity)) {
+        definitionMaterial = _drawingElementMaterialIndex(SUDrawingElementFromEntity(entity));
+    }
+    _pushTarget(&definition.entities, definitionMaterial,
+                &definition.children);
+}
+
+void
+SketchUpSceneExtractor::EndDefinition(SUComponentDefinitionRef comp_def) {
+    _popTarget();
+}
+
+#pragma mark Instances:
+
+void
+SketchUpSceneExtractor::VisitInstance(SUComponentInstanceRef instance,
+                                      SUComponentDefinitionRef definition) {
+    SceneInstance sceneInstance;
+    sceneInstance.definition = reinterpret_cast<uintptr_t>(definition.ptr);
+    SUTransformation t;
+    SU_CALL(SUComponentInstanceGetTransform(instance, &t));
+    sceneInstance.transform = usdTransformFromSUTransform(t);
+    // this instance might have a material bound to it
+    SUDrawingElementRef de = SUComponentInstanceToDrawingElement(instance);
+    sceneInstance.material = _drawingElementMaterialIndex(de);
+    const _Target& target = _targets.back();
+    target.entities->instances.push_back(sceneInstance);
+    (*target.children)[sceneInstance.definition]++;
+}
+
+#pragma mark Groups:
+
+void
+SketchUpSceneExtractor::BeginGroup(SUGroupRef group) {
+    const _Target& parent = _targets.back();
+    SceneGroup sceneGroup;
+    sceneGroup.name = GetGroupName(group);
+    SUTransformation t;
+    SU_CALL(SUGroupGetTransform(group, &t));
+    sceneGroup.transform = usdTransformFromSUTransform(t);
+    // faces without their own material pick up the material of the
+    // closest enclosing group that has one
+    int groupMaterial = _drawingElementMaterialIndex(SUGroupToDrawingElement(group));
+    if (groupMaterial < 0) {
+        groupMaterial = parent.material;
+    }
+    parent.entities->groups.push_back(sceneGroup);
+    // the group's entities are shared, so this pointer survives the groups
+    // vector growing
+    _pushTarget(sceneGroup.entities.get(), groupMaterial, parent.children);
+}
+
+void
+SketchUpSceneExtractor::EndGroup(SUGroupRef group) {
+    _popTarget();
+}
+
+#pragma mark Materials:
+
+int
+SketchUpSceneExtractor::_drawingElementMaterialIndex(SUDrawingElementRef drawingElement) {
+    if (SUIsInvalid(drawingElement)) {
+        return -1;
+    }
+    SUMaterialRef material = SU_INVALID;
+    SUDrawingElementGetMaterial(drawingElement, &material);
+    return _materialIndex(material);
+}
+
+// In SketchUp, a material can have:
+// - a color and NO texture
+// - NO color and A texture
+// - A solid color and A texture
+// We only look at each SketchUp material once, no matter how many faces,
+// groups or instances use it.
+int
+SketchUpSceneExtractor::_materialIndex(SUMaterialRef material) {
+    if (SUIsInvalid(material)) {
+        return -1;
+    }
+    uintptr_t key = reinterpret_cast<uintptr_t>(material.ptr);
+    auto found = _materialIndices.find(key);
+    if (found != _materialIndices.end()) {
+        return found->second;
+    }
+    SceneMaterial sceneMaterial;
+    SUColor color;
+    SU_RESULT result = SUMaterialGetColor(material, &color);
+    if (result == SU_ERROR_NONE) {
+        sceneMaterial.rgb[0] = ((int)color.red)/255.0;
+        sceneMaterial.rgb[1] = ((int)color.green)/255.0;
+        sceneMaterial.rgb[2] = ((int)color.blue)/255.0;
+        sceneMaterial.opacity = ((int)color.alpha)/255.0;
+        sceneMaterial.hasColor = true;
+    }
+    SUTextureRef textureRef = SU_INVALID;
+    if (SU_ERROR_NONE == SUMaterialGetTexture(material, &textureRef)) {
+        sceneMaterial.textureName = _textureFileName(textureRef);
+    }
+    int index = (int)_scene->materials.size();
+    _scene->materials.push_back(sceneMaterial);
+    _materialIndices[key] = index;
+    return index;
+}
+
+std::string
+SketchUpSceneExtractor::_textureFileName(SUTextureRef textureRef) {
+    SUStringRef fileName;
+    SUSetInvalid(fileName);
+    SUStringCreate(&fileName);
+    SUTextureGetFileName(textureRef, &fileName);
+    size_t length;
+    SUStringGetUTF8Length(fileName, &length);
+    std::string string;
+    string.resize(length);
+    size_t returned_length;
+    SUStringGetUTF8(fileName, length, &string[0], &returned_length);
+    SUStringRelease(&fileName);
+    // this might be some windows name that has directory info in it
+    // when we wrote it out, we ignored the path info, so we should ignore
+    // it here as well. The Tf code will deal with this on Windows, but on the
+    // Mac, it doesn't, so we'll need an additional check.
+    std::string baseName = pxr::TfGetBaseName(string);
+    if (pxr::TfGetPathName(string) == "") {
+        // make sure it's not got a windows path embedded in there, like:
+        // C:\Users\Owner\Pictures\Other\Textures for Google Sketchup\norway_maple_tree.jpg
+        const std::string::size_type i = string.find_last_of("\\/");
+        if (string.size() > i) {
+            baseName = string.substr(i+1, string.size());
+        }
+    }
+    // TODO: this is a bad hack. Need to revisit it soon...
+    // we really should check for the existence of this file here, but I'm
+    // not currently sure how to do that in a arch independent way. What I do
+    // know is that sometimes SketchUp takes a "BMP" extension file and silently
+    // converts it to a "png" (i.e. on disk), so for now, we will at least make
+    // that change here:
+    std::regex replaceExpr(".BMP|.bmp|.TGA|.tga");
+    std::string newBaseName = std::regex_replace(baseName, replaceExpr, ".png");
+    return newBaseName;
+}
+
+#pragma mark Faces:
+
+void
+SketchUpSceneExtractor::VisitFace(SUFaceRef face) {
+    const _Target& target = _targets.back();
+    // a face with no material of its own uses its group's (if any)
+    SUMaterialRef material = SU_INVALID;
+    SUFaceGetFrontMaterial(face, &material);
+    int frontMaterial = _materialIndex(material);
+    if (frontMaterial < 0) {
+        frontMaterial = target.material;
+    }
+    material = SU_INVALID;
+    SUFaceGetBackMaterial(face, &material);
+    int backMaterial = _materialIndex(material);
+    if (backMaterial < 0) {
+        backMaterial = target.material;
+    }
+    target.faces->AddFace(face, frontMaterial, backMaterial);
+}
+
+#pragma mark Edges:
+
+void
+SketchUpSceneExtractor::VisitEdge(SUEdgeRef edge) {
+    _Target& target = _targets.back();
+    SUVertexRef start_vertex = SU_INVALID;
+    SU_CALL(SUEdgeGetStartVertex(edge, &start_vertex));
+    SUPoint3D startP;
+    SU_CALL(SUVertexGetPosition(start_vertex, &startP));
+    target.edgePoints.push_back(startP);
+
+    SUVertexRef end_vertex = SU_INVALID;
+    SU_CALL(SUEdgeGetEndVertex(edge, &end_vertex));
+    SUPoint3D endP;
+    SU_CALL(SUVertexGetPosition(end_vertex, &endP));
+    target.edgePoints.push_back(endP);
+
+    target.entities->edges.vertexCounts.push_back(2);
+}
+
+#pragma mark Curves:
+
+void
+SketchUpSceneExtractor::VisitCurve(SUCurveRef curve) {
+    _Target& target = _targets.back();
+    SceneCurves& curves = target.entities->curves;
+    size_t num_edges = 0;
+    SU_CALL(SUCurveGetNumEdges(curve, &num_edges));
+    if (!num_edges) {
+        curves.vertexCounts.push_back(0);
+        return ;
+    }
+    std::vector<SUEdgeRef> edges(num_edges);
+    SU_CALL(SUCurveGetEdges(curve, num_edges, &edges[0], &num_edges));
+    int actuallyEdgesFound = 0;
+    for (size_t i = 0; i < num_edges; ++i) {
+        SUEdgeRef edge = edges[i];
+        if (SUIsInvalid(edge)) {
+            continue ;
+        }
+        actuallyEdgesFound++;
+        SUVertexRef start_vertex = SU_INVALID;
+        SU_CALL(SUEdgeGetStartVertex(edge, &start_vertex));
+        SUPoint3D startP;
+        SU_CALL(SUVertexGetPosition(start_vertex, &startP));
+        target.curvePoints.push_back(startP);
+
+        SUVertexRef end_vertex = SU_INVALID;
+        SU_CALL(SUEdgeGetEndVertex(edge, &end_vertex));
+        SUPoint3D endP;
+        SU_CALL(SUVertexGetPosition(end_vertex, &endP));
+        target.curvePoints.push_back(endP);
+    }
+    curves.vertexCounts.push_back(2 * actuallyEdgesFound);
+}
+
+#pragma mark Polyline3D:
+
+void
+SketchUpSceneExtractor::VisitPolyline(SUPolyline3dRef polyline) {
+    _Target& target = _targets.back();
+    size_t nPoints = 0;
+    SU_CALL(SUPolyline3dGetNumPoints(polyline, &nPoints));
+    if (nPoints) {
+        std::vector<SUPoint3D>& points = target.polylinePoints;
+        const size_t origin = points.size();
+        points.resize(origin + nPoints);
+        SU_CALL(SUPolyline3dGetPoints(polyline, nPoints, &points[origin],
+                                      &nPoints));
+        points.resize(origin + nPoints);
+    }
+    target.entities->polylines.vertexCounts.push_back((int)nPoints);
+}
+
+#pragma mark Cameras:
+
+void
+SketchUpSceneExtractor::_ExtractCameras() {
+    size_t num_scenes = 0;
+    SU_CALL(SUModelGetNumScenes(_model, &num_scenes));
+    if (!num_scenes) {
+        return ;
+    }
+    std::vector<SUSceneRef> scenes(num_scenes);
+    SU_CALL(SUModelGetScenes(_model, num_scenes, &scenes[0], &num_scenes));
+    _scene->cameras.reserve(num_scenes);
+    for (size_t i = 0; i < num_scenes; ++i) {
+        SUSceneRef scene = scenes[i];
+        SceneCamera sceneCamera;
+        sceneCamera.name = GetSceneName(scene);
+        SUCameraRef camera;
+        SU_CALL(SUSceneGetCamera(scene, &camera));
+
+        double aspect_ratio = 0;
+        SU_RESULT result = SUCameraGetAspectRatio(camera, &aspect_ratio);
+        if (result == SU_ERROR_NONE) {
+            // we got a specific aspect ratio for this camera
+            sceneCamera.hasAspectRatio = true;
+            sceneCamera.aspectRatio = aspect_ratio;
+        }
+        SUPoint3D position;
+        SUPoint3D target;
+        SUVector3D up_vector;
+        SU_CALL(SUCameraGetOrientation(camera, &position, &target, &up_vector));
+        sceneCamera.position = pxr::GfVec3d(position.x, position.y, position.z);
+        sceneCamera.target = pxr::GfVec3d(target.x, target.y, target.z);
+        sceneCamera.upVector = pxr::GfVec3d(up_vector.x, up_vector.y,
+                                            up_vector.z);
+
+        SU_CALL(SUCameraGetPerspective(camera, &sceneCamera.isPerspective));
+        if (sceneCamera.isPerspective) {
+            SU_CALL(SUCameraGetPerspectiveFrustumFOV(camera,
+                                                     &sceneCamera.verticalFOV));
+        } else {
+            SU_CALL(SUCameraGetOrthographicFrustumHeight(camera,
+                                                         &sceneCamera.orthographicHeight));
+        }
+        _scene->cameras.push_back(sceneCamera);
+    }
+}
+
+#pragma mark Setters/Getters:
+
+bool
+SketchUpSceneExtractor::GetExtractFaces() const {
+    return _extractFaces;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractEdges() const {
+    return _extractEdges;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractCurves() const {
+    return _extractCurves;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractLines() const {
+    return _extractLines;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractCameras() const {
+    return _extractCameras;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractNormals() const {
+    return _extractNormals;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractBackUVs() const {
+    return _extractBackUVs;
+}
+
+bool
+SketchUpSceneExtractor::GetExtractNGons() const {
+    return _extractNGons;
+}
+
+bool
+SketchUpSceneExtractor::GetNativeTriangulation() const {
+    return _nativeTriangulation;
+}
+
+bool
+SketchUpSceneExtractor::GetMergeCoplanarFaces() const {
+    return _mergeCoplanarFaces;
+}
+
+void
+SketchUpSceneExtractor::SetExtractFaces(bool flag) {
+    _extractFaces = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractEdges(bool flag) {
+    _extractEdges = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractCurves(bool flag) {
+    _extractCurves = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractLines(bool flag) {
+    _extractLines = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractCameras(bool flag) {
+    _extractCameras = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractNormals(bool flag) {
+    _extractNormals = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractBackUVs(bool flag) {
+    _extractBackUVs = flag;
+}
+
+void
+SketchUpSceneExtractor::SetExtractNGons(bool flag) {
+    _extractNGons = flag;
+}
+
+void
+SketchUpSceneExtractor::SetNativeTriangulation(bool flag) {
+    _nativeTriangulation = flag;
+}
+
+void
+SketchUpSceneExtractor::SetMergeCoplanarFaces(bool flag) {
+    _mergeCoplanarFaces = flag;
+}
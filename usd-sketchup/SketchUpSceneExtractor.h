@@ -0,0 +1,154 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpSceneExtractor.h
+//
+// The extractor is the only part of the exporter that reads the SketchUp
+// model. It fills in a SketchUpScene (see SketchUpScene.h) with everything
+// the USD side needs, so that the model can be released as soon as it is done.
+// It does that as a visitor of a single SketchUpEntityWalker walk, which
+// other visitors (e.g. the texture loading) can ride along on.
+
+#ifndef SketchUpSceneExtractor_h
+#define SketchUpSceneExtractor_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SketchUpEntityWalker.h"
+#include "SketchUpFaceCollector.h"
+#include "SketchUpScene.h"
+
+class SketchUpSceneExtractor : public SketchUpEntityVisitor {
+
+public:
+    SketchUpSceneExtractor();
+    ~SketchUpSceneExtractor();
+
+    // Visitors added here are walked along with the extraction, and see each
+    // entity before the extractor does. The face UVs are computed with the
+    // texture writer, so whatever loads the textures into it has to be
+    // added here.
+    void AddVisitor(SketchUpEntityVisitor* visitor);
+
+    // see SketchUpEntityWalker::SetVisibilityResolver
+    void SetVisibilityResolver(const SketchUpVisibilityResolver* resolver);
+
+    void Extract(SUModelRef model, SUTextureWriterRef textureWriter,
+                 SketchUpScene& scene);
+
+    bool GetExtractFaces() const;
+    bool GetExtractEdges() const;
+    bool GetExtractCurves() const;
+    bool GetExtractLines() const;
+    bool GetExtractCameras() const;
+    bool GetExtractNormals() const;
+    // the back side UVs are only needed if we might write a BackSide mesh
+    bool GetExtractBackUVs() const;
+    // keep the convex faces without holes as single polygons
+    bool GetExtractNGons() const;
+    // triangulate the faces with PolygonTriangulator rather than SketchUp
+    bool GetNativeTriangulation() const;
+    // see SketchUpFaceCollector::SetMergeCoplanarFaces
+    bool GetMergeCoplanarFaces() const;
+
+    void SetExtractFaces(bool flag);
+    void SetExtractEdges(bool flag);
+    void SetExtractCurves(bool flag);
+    void SetExtractLines(bool flag);
+    void SetExtractCameras(bool flag);
+    void SetExtractNormals(bool flag);
+    void SetExtractBackUVs(bool flag);
+    void SetExtractNGons(bool flag);
+    void SetNativeTriangulation(bool flag);
+    void SetMergeCoplanarFaces(bool flag);
+
+    void BeginDefinition(SUComponentDefinitionRef definition) override;
+    void EndDefinition(SUComponentDefinitionRef definition) override;
+    void VisitInstance(SUComponentInstanceRef instance,
+                       SUComponentDefinitionRef definition) override;
+    void BeginGroup(SUGroupRef group) override;
+    void EndGroup(SUGroupRef group) override;
+    void VisitFace(SUFaceRef face) override;
+    void VisitEdge(SUEdgeRef edge) override;
+    void VisitCurve(SUCurveRef curve) override;
+    void VisitPolyline(SUPolyline3dRef polyline) override;
+
+private:
+    SUModelRef _model;
+    SUTextureWriterRef _textureWriter;
+    SketchUpScene* _scene;
+
+    bool _extractFaces;
+    bool _extractEdges;
+    bool _extractCurves;
+    bool _extractLines;
+    bool _extractCameras;
+    bool _extractNormals;
+    bool _extractBackUVs;
+    bool _extractNGons;
+    bool _nativeTriangulation;
+    bool _mergeCoplanarFaces;
+
+    std::vector<SketchUpEntityVisitor*> _visitors;
+    const SketchUpVisibilityResolver* _visibility;
+
+    // where the entities being visited go, the material that faces without
+    // one of their own pick up there, and where the instances found there
+    // are counted. The back is the innermost definition or group we're in.
+    // Its faces are collected as they're visited, and only go into its mesh
+    // once we leave it.
+    struct _Target {
+        SceneEntities* entities;
+        int material;
+        std::map<uintptr_t, unsigned long long>* children;
+        std::unique_ptr<SketchUpFaceCollector> faces;
+        // same for the points of the edges, curves and polylines, which are
+        // converted all at once
+        std::vector<SUPoint3D> edgePoints;
+        std::vector<SUPoint3D> curvePoints;
+        std::vector<SUPoint3D> polylinePoints;
+    };
+    std::vector<_Target> _targets;
+
+    void _pushTarget(SceneEntities* entities, int material,
+                     std::map<uintptr_t, unsigned long long>* children);
+    void _popTarget();
+    void _fillCurvePoints(const std::vector<SUPoint3D>& points,
+                          SceneCurves& curves);
+
+    // SketchUp material pointer to its index in _scene->materials
+    std::map<uintptr_t, int> _materialIndices;
+
+    void _orderDefinitions();
+    void _ExtractCameras();
+
+    int _materialIndex(SUMaterialRef material);
+    int _drawingElementMaterialIndex(SUDrawingElementRef drawingElement);
+    std::string _textureFileName(SUTextureRef textureRef);
+};
+
+#endif /* SketchUpSceneExtractor_h */
@@ -0,0 +1,126 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpVisibilityResolver.cpp
+//
+#include <vector>
+
+#include "SketchUpVisibilityResolver.h"
+#include "USDSketchUpUtilities.h"
+
+SketchUpVisibilityResolver::SketchUpVisibilityResolver() {
+}
+
+SketchUpVisibilityResolver::~SketchUpVisibilityResolver() {
+}
+
+void
+SketchUpVisibilityResolver::Resolve(SUModelRef model) {
+    _layerVisibility.clear();
+    SULayerRef defaultLayer = SU_INVALID;
+    SUModelGetDefaultLayer(model, &defaultLayer);
+    size_t num_layers = 0;
+    SU_CALL(SUModelGetNumLayers(model, &num_layers));
+    if (!num_layers) {
+        return ;
+    }
+    std::vector<SULayerRef> layers(num_layers);
+    SU_CALL(SUModelGetLayers(model, num_layers, &layers[0], &num_layers));
+    for (size_t i = 0; i < num_layers; i++) {
+        SULayerRef layer = layers[i];
+        bool visible = true;
+        SU_CALL(SULayerGetVisibility(layer, &visible));
+        const bool isDefault = (layer.ptr == defaultLayer.ptr);
+        uintptr_t key = reinterpret_cast<uintptr_t>(layer.ptr);
+        _layerVisibility[key] = _isTagVisible(GetLayerName(layer), visible,
+                                              isDefault);
+    }
+}
+
+bool
+SketchUpVisibilityResolver::IsVisible(SUDrawingElementRef drawingElement) const {
+    if (SUIsInvalid(drawingElement)) {
+        return true;
+    }
+    bool isHidden = false;
+    SUDrawingElementGetHidden(drawingElement, &isHidden);
+    if (isHidden) {
+        return false;
+    }
+    SULayerRef layer = SU_INVALID;
+    SU_CALL(SUDrawingElementGetLayer(drawingElement, &layer));
+    return IsLayerVisible(layer);
+}
+
+bool
+SketchUpVisibilityResolver::IsLayerVisible(SULayerRef layer) const {
+    if (SUIsInvalid(layer)) {
+        return true;
+    }
+    auto found = _layerVisibility.find(reinterpret_cast<uintptr_t>(layer.ptr));
+    if (found != _layerVisibility.end()) {
+        return found->second;
+    }
+    // not one of the model's layers, so not something we've resolved; just
+    // ask SketchUp about it
+    bool visible = true;
+    SU_CALL(SULayerGetVisibility(layer, &visible));
+    return _isTagVisible(GetLayerName(layer), visible, false);
+}
+
+bool
+SketchUpVisibilityResolver::_isTagVisible(const std::string& name,
+                                          bool visibleInSketchUp,
+                                          bool isDefault) const {
+    if (_excludedTags.count(name)) {
+        return false;
+    }
+    if (isDefault) {
+        return true;
+    }
+    if (_includedTags.empty()) {
+        return visibleInSketchUp;
+    }
+    return _includedTags.count(name) != 0;
+}
+
+#pragma mark Setters/Getters:
+
+const std::set<std::string>&
+SketchUpVisibilityResolver::GetIncludedTags() const {
+    return _includedTags;
+}
+
+const std::set<std::string>&
+SketchUpVisibilityResolver::GetExcludedTags() const {
+    return _excludedTags;
+}
+
+void
+SketchUpVisibilityResolver::SetIncludedTags(const std::set<std::string>& tags) {
+    _includedTags = tags;
+}
+
+void
+SketchUpVisibilityResolver::SetExcludedTags(const std::set<std::string>& tags) {
+    _excludedTags = tags;
+}
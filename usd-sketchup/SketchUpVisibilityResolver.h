@@ -0,0 +1,75 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  SketchUpVisibilityResolver.h
+//
+// Answers whether a SketchUp drawing element should be exported, i.e. it is
+// not hidden and its tag (what the API still calls a layer) is visible. The
+// tags are all looked up once up front, so an element only costs its hidden
+// flag and its layer pointer.
+//
+// By default a tag is visible if it is visible in SketchUp. An explicit
+// include list exports only the tags in it, whether or not they are visible
+// in the .skp, and an exclude list drops the tags in it. The default tag
+// ("Untagged", which SketchUp itself never lets you hide) is kept unless it
+// is excluded, as that is where groups and components usually live.
+
+#ifndef SketchUpVisibilityResolver_h
+#define SketchUpVisibilityResolver_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <set>
+#include <string>
+#include <unordered_map>
+
+class SketchUpVisibilityResolver {
+
+public:
+    SketchUpVisibilityResolver();
+    ~SketchUpVisibilityResolver();
+
+    const std::set<std::string>& GetIncludedTags() const;
+    const std::set<std::string>& GetExcludedTags() const;
+
+    // an empty include list means every tag
+    void SetIncludedTags(const std::set<std::string>& tags);
+    void SetExcludedTags(const std::set<std::string>& tags);
+
+    // looks up every tag in the model, needs to be called again if the tag
+    // lists change
+    void Resolve(SUModelRef model);
+
+    bool IsVisible(SUDrawingElementRef drawingElement) const;
+    bool IsLayerVisible(SULayerRef layer) const;
+
+private:
+    std::set<std::string> _includedTags;
+    std::set<std::string> _excludedTags;
+    // SketchUp layer pointer to whether its elements are exported
+    std::unordered_map<uintptr_t, bool> _layerVisibility;
+
+    bool _isTagVisible(const std::string& name, bool visibleInSketchUp,
+                       bool isDefault) const;
+};
+
+#endif /* SketchUpVisibilityResolver_h */
@@ -27,7 +27,8 @@ StatsDataPoint::StatsDataPoint() :  _meshesCount(0), _linesCount(0),
                                     _edgesCount(0), _curvesCount(0),
                                     _originalFacesCount(0),
                                     _geomSubsetsCount(0), _materialsCount(0),
-                                    _shadersCount(0), _trianglesCount(0) {
+                                    _shadersCount(0), _trianglesCount(0),
+                                    _removedFacesCount(0) {
     
 }
 
@@ -78,6 +79,11 @@ StatsDataPoint::GetOriginalFacesCount() {
     return _originalFacesCount;
 }
 
+unsigned long long
+StatsDataPoint::GetRemovedFacesCount() {
+    return _removedFacesCount;
+}
+
 void
 StatsDataPoint::SetMeshesCount(unsigned long long value) {
     _meshesCount = value;
@@ -123,3 +129,8 @@ StatsDataPoint::SetOriginalFacesCount(unsigned long long value) {
     _originalFacesCount = value;
 }
 
+void
+StatsDataPoint::SetRemovedFacesCount(unsigned long long value) {
+    _removedFacesCount = value;
+}
+
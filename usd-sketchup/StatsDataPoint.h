@@ -53,6 +53,8 @@ public:
     unsigned long long GetMaterialsCount();
     unsigned long long GetGeomSubsetsCount();
     unsigned long long GetOriginalFacesCount();
+    // degenerate and duplicate polygons left out of the meshes
+    unsigned long long GetRemovedFacesCount();
 
     void SetMeshesCount(unsigned long long value);
     void SetLinesCount(unsigned long long value);
@@ -63,6 +65,7 @@ public:
     void SetMaterialsCount(unsigned long long value);
     void SetGeomSubsetsCount(unsigned long long value);
     void SetOriginalFacesCount(unsigned long long value);
+    void SetRemovedFacesCount(unsigned long long value);
 
 private:
     unsigned long long _meshesCount;
@@ -74,6 +77,7 @@ private:
     unsigned long long _materialsCount;
     unsigned long long _geomSubsetsCount;
     unsigned long long _originalFacesCount;
+    unsigned long long _removedFacesCount;
 };
 
 #endif /* StatsDataPoint_h */
@@ -25,16 +25,23 @@
 //
 //  Created by Michael B. Johnson on 11/22/17, based on previous work from 2015.
 //
+#include <algorithm>
+#include <functional>
 #include <regex>
 #include <iostream>
 #include <fstream>
+#include <cmath>
 
 #include "USDExporter.h"
 #include "USDTextureHelper.h"
 #include "USDSketchUpUtilities.h"
+#include "SketchUpSceneExtractor.h"
+#include "SketchUpVisibilityResolver.h"
 
 #include "pxr/base/arch/systemInfo.h"
 #include "pxr/base/arch/fileSystem.h"
+#include "pxr/base/gf/quath.h"
+#include "pxr/base/gf/rotation.h"
 #include "pxr/base/tf/setenv.h"
 #include "pxr/base/tf/stringUtils.h"
 #include "pxr/base/tf/envSetting.h"
@@ -43,22 +50,14 @@
 #include "pxr/usd/kind/registry.h"
 #include "pxr/usd/sdf/layer.h"
 #include "pxr/usd/sdf/changeBlock.h"
-#include "pxr/usd/usd/editContext.h"
+#include "pxr/usd/sdf/reference.h"
+#include "pxr/usd/sdf/schema.h"
+#include "pxr/usd/usd/stage.h"
 #include "pxr/usd/usd/zipFile.h"
 #include "pxr/usd/usdUtils/dependencies.h"
-#include "pxr/usd/usdGeom/basisCurves.h"
-#include "pxr/usd/usdGeom/camera.h"
-#include "pxr/usd/usdGeom/mesh.h"
-#include "pxr/usd/usdGeom/metrics.h"
-#include "pxr/usd/usdGeom/primvar.h"
-#include "pxr/usd/usdGeom/scope.h"
-#include "pxr/usd/usdGeom/subset.h"
-#include "pxr/usd/usdShade/shader.h"
+#include "pxr/usd/usdGeom/curves.h"
 #include "pxr/usd/usdGeom/tokens.h"
-#include "pxr/usd/usdGeom/xform.h"
-#include "pxr/usd/usdGeom/xformCommonAPI.h"
-#include "pxr/usd/usdShade/shader.h"
-#include "pxr/usd/usdShade/material.h"
+#include "pxr/usd/usdShade/tokens.h"
 
 #include <sys/time.h>
 
@@ -78,17 +77,20 @@ double _getCurrentTime_() {
 
 // SketchUp thinks in inches, we want centimeters
 static double inchesToCM = 2.54;
-// SketchUp's default frontface color
-static pxr::GfVec4d defaultFrontFaceRGBA(1.0, 1.0, 1.0, 1.0);
-// SketchUp's default backface color
-static pxr::GfVec4d defaultBackFaceRGBA(198.0/255.0, 214.0/255.0, 224.0/255.0,
-                                        1.0);
 static std::string componentDefinitionSuffix = "__SUComponentDefinition";
 static std::string instanceSuffix = "__USDInstance_";
+static std::string instancerSuffix = "__USDPointInstancer_";
 
 static std::string frontSide = "FrontSide";
 static std::string backSide = "BackSide";
 static std::string bothSides = "BothSides";
+static std::string sideTopology = "SideTopology";
+
+// same as UsdGeomSetStageUpAxis, but on the layer
+static void _setUpAxisZ(const pxr::SdfLayerRefPtr& layer) {
+    layer->GetPseudoRoot()->SetInfo(pxr::UsdGeomTokens->upAxis,
+                                    pxr::VtValue(pxr::UsdGeomTokens->z));
+}
 
 #pragma mark static constructor stuff for USD plugin discovery
 class InitUSDPluginPath {
@@ -119,6 +121,22 @@ USDExporter::USDExporter(): _model(SU_INVALID), _textureWriter(SU_INVALID), _cur
     SetExportToSingleFile(false);
     SetExportARKitCompatibleUSDZ(true);
     SetExportDoubleSided(true);
+    SetExportNGons(false);
+    SetNativeTriangulation(false);
+    SetMergeCoplanarFaces(false);
+    SetWeldVertices(true);
+    SetWeldTolerance(0.0);
+    SetCleanUpMeshes(true);
+    SetSortFacesByMaterial(false);
+    SetSplitMeshesByMaterial(false);
+    SetShareMeshTopology(false);
+    SetOmitClosedBackSides(false);
+    SetExportPointInstancers(false);
+    SetPointInstancerMinimum(16);
+    SetChooseInstancingByCost(false);
+    SetFlattenTriangleMaximum(64);
+    SetFlattenTriangleBudget(100000);
+    SetMergeIdenticalDefinitions(true);
     SetAspectRatio(1.85);
     SetSensorHeight(24.0);
     SetStartFrame(101.0);
@@ -126,6 +144,14 @@ USDExporter::USDExporter(): _model(SU_INVALID), _textureWriter(SU_INVALID), _cur
     _progressCallback = NULL;
 }
 
+USDExporter::_DefinitionRecord::_DefinitionRecord() : isBillboard(false),
+                                                      instanceCount(0),
+                                                      instancerCount(0),
+                                                      definition(NULL),
+                                                      flatten(false),
+                                                      pointInstance(false) {
+}
+
 USDExporter::~USDExporter() {
     if (!SUIsInvalid(_textureWriter)) {
         SUTextureWriterRelease(&_textureWriter);
@@ -148,11 +174,14 @@ bool
 USDExporter::_performExport(const std::string& skpSrc,
                             const std::string& usdDst) {
     double startTime = _getCurrentTime_();
+    double extractTime = 0.0;
+    double meshesTime = 0.0;
     double geomTime = 0.0;
     double texturesTime = 0.0;
     double componentsTime = 0.0;
     double camerasTime = 0.0;
     double usdzTime = 0.0;
+    double validateTime = 0.0;
     double exportTime = 0.0;
     
     // these values will get updated while we do the export, and will be
@@ -170,21 +199,32 @@ USDExporter::_performExport(const std::string& skpSrc,
     _geomSubsetsCount = 0;
     _originalFacesCount = 0;
     _trianglesCount = 0;
+    _removedFacesCount = 0;
+    _flattenedDefinitionCount = 0;
+    _mergedDefinitionCount = 0;
+    _pointInstancedDefinitionCount = 0;
     _filePathsForZip.clear();
     _exportTimeSummary.clear();
+    _instancingSummary.clear();
     _shaderPathsCounts.clear();
     _materialPathsCounts.clear();
     _componentDefinitionPaths.clear();
+    _originalComponentNameSafeNameDictionary.clear();
+    _definitionRecords.clear();
+    _deduplicator.Clear();
     _useSharedFallbackMaterial = true;
-    _groupMaterial = SU_INVALID;
+    _fallbackDisplayMaterialPath = pxr::SdfPath();
+    _topLevelFallbackDisplayMaterialPath = pxr::SdfPath();
+    _geomLayer = nullptr;
+    _componentDefinitionLayer = nullptr;
 
     _exportingUSDZ = false;
     SetSkpFileName(skpSrc);
     SU_CALL(SUModelCreateFromFile(&_model, _skpFileName.c_str()));
     SetUSDFileName(usdDst);
 
-    _stage = pxr::UsdStage::CreateNew(_baseFileName);
-    if (!_stage) {
+    _rootLayer = pxr::SdfLayer::CreateNew(_baseFileName);
+    if (!_rootLayer) {
         if (!SUIsInvalid(_model)) {
             SUModelRelease(&_model);
             SUSetInvalid(_model);
@@ -201,7 +241,8 @@ USDExporter::_performExport(const std::string& skpSrc,
         // directory. All that machinery is hidden when the name is set.
     }
 
-    UsdGeomSetStageUpAxis(_stage, pxr::UsdGeomTokens->z); // SketchUp is Z-up
+    _setUpAxisZ(_rootLayer); // SketchUp is Z-up
+    _writer.SetLayer(_rootLayer);
     std::string parentPath("/");
     // now make a top level scope that is the name of the file
     // to hold the scene & cameras.
@@ -217,44 +258,96 @@ USDExporter::_performExport(const std::string& skpSrc,
         << std::endl;
     }
     pxr::SdfPath path(parentPath + safeBaseNameNoExt);
+    // Everything we need from the SketchUp model is pulled out here, in one
+    // walk that also loads the textures, so we can let go of the model
+    // before we start writing USD.
+    USDTextureHelper textureHelper;
+    double startTimeExtract = _getCurrentTime_();
+    _ExtractScene(textureHelper);
+    extractTime = _getCurrentTime_() - startTimeExtract;
     if (GetExportMaterials()) {
         // only do this if we're exporting materials
         double startTimeTextures = _getCurrentTime_();
-        _ExportTextures(path); // do this first so we know our _textureDirectory
+        _ExportTextures(textureHelper); // sets our _textureDirectory
         texturesTime = _getCurrentTime_() - startTimeTextures;
-        if (!GetExportARKitCompatibleUSDZ()) {
+    }
+    if (!SUIsInvalid(_model)) {
+        SUModelRelease(&_model);
+        SUSetInvalid(_model);
+    }
+
+    double startTimeMeshes = _getCurrentTime_();
+    _BuildMeshes();
+    meshesTime = _getCurrentTime_() - startTimeMeshes;
+    if (GetMergeIdenticalDefinitions()) {
+        _mergedDefinitionCount = _deduplicator.Find(_scene);
+    }
+    _ChooseInstancing();
+
+    {
+        // Nothing is listening to these layers while we write them, but
+        // every edit would still be processed as its own change, so we
+        // batch all of them up into one.
+        pxr::SdfChangeBlock changeBlock;
+        if (GetExportMaterials() && !GetExportARKitCompatibleUSDZ()) {
             // currently, macOS and iOS don't support this shader, so don't bother
             _ExportFallbackDisplayMaterial(path);
+            _topLevelFallbackDisplayMaterialPath = _fallbackDisplayMaterialPath;
+        }
+        pxr::SdfPath parentPathS(parentPath);
+        double startTimeComponents = _getCurrentTime_();
+        _ExportComponentDefinitions(parentPathS);
+        componentsTime = _getCurrentTime_() - startTimeComponents;
+
+        auto prim = _writer.DefinePrim(path, "Xform");
+        _rootLayer->SetDefaultPrim(path.GetNameToken());
+        prim->SetKind(pxr::KindTokens->assembly);
+
+        double startTimeGeom = _getCurrentTime_();
+        _ExportGeom(path);
+        geomTime =  _getCurrentTime_() - startTimeGeom;
+
+        if (GetExportCameras()) {
+            double startTimeCameras = _getCurrentTime_();
+            _ExportCameras(path);
+            camerasTime = _getCurrentTime_() - startTimeCameras;
         }
+        _FinalizeComponentDefinitions();
     }
-    pxr::SdfPath parentPathS(parentPath);
-    double startTimeComponents = _getCurrentTime_();
-    _ExportComponentDefinitions(parentPathS);
-    componentsTime = _getCurrentTime_() - startTimeComponents;
+    // we're done with the scene, no need to hold on to all that memory
+    _meshBuilder.Clear();
+    _deduplicator.Clear();
+    _scene.Clear();
 
-    auto primSchema = pxr::UsdGeomXform::Define(_stage,
-                                                pxr::SdfPath(path));
-    _stage->SetDefaultPrim(primSchema.GetPrim());
-    pxr::UsdPrim prim = primSchema.GetPrim();
-    prim.SetMetadata(pxr::SdfFieldKeys->Kind, pxr::KindTokens->assembly);
-
-    double startTimeGeom = _getCurrentTime_();
-    _ExportGeom(path);
-    geomTime =  _getCurrentTime_() - startTimeGeom;
+    _rootLayer->Save();
+    if (_geomLayer) {
+        _geomLayer->Save();
+    }
+    if (!GetExportToSingleFile() && _componentDefinitionPaths.size()) {
+        _componentDefinitionLayer->Save();
+    }
 
-    if (GetExportCameras()) {
-        double startTimeCameras = _getCurrentTime_();
-        _ExportCameras(path);
-        camerasTime = _getCurrentTime_() - startTimeCameras;
+    {
+        // This is the first time what we wrote gets composed, so make sure
+        // it holds together before we hand it off.
+        double startTimeValidate = _getCurrentTime_();
+        pxr::UsdStageRefPtr stage = pxr::UsdStage::Open(_rootLayer);
+        if (!stage) {
+            std::cerr << "ERROR: unable to open the USD we just wrote to "
+                      << _usdFileName << std::endl;
+            throw std::exception();
+        }
+        if (!stage->GetDefaultPrim()) {
+            std::cerr << "WARNING: " << _usdFileName
+                      << " does not have a valid default prim" << std::endl;
+        }
+        validateTime = _getCurrentTime_() - startTimeValidate;
     }
-    _FinalizeComponentDefinitions();
-    
-    _stage->Save();
-    
+
     if (_exportingUSDZ) {
         double startTimeUSDZ = _getCurrentTime_();
         if (GetExportARKitCompatibleUSDZ()) {
-            pxr::SdfAssetPath p = pxr::SdfAssetPath(_stage->GetRootLayer()->GetRealPath());
+            pxr::SdfAssetPath p = pxr::SdfAssetPath(_rootLayer->GetRealPath());
             pxr::ArGetResolver().CreateDefaultContextForAsset(p.GetAssetPath());
             bool wroteIt = pxr::UsdUtilsCreateNewARKitUsdzPackage(p,
                                                                   _zipFileName);
@@ -280,6 +373,14 @@ USDExporter::_performExport(const std::string& skpSrc,
         sprintf(buffer, "\tTextures Export took %3.2lf secs\n", texturesTime);
         _exportTimeSummary += std::string(buffer);
     }
+    if (extractTime > 1.0) {
+        sprintf(buffer, "\tScene Extraction took %3.2lf secs\n", extractTime);
+        _exportTimeSummary += std::string(buffer);
+    }
+    if (meshesTime > 1.0) {
+        sprintf(buffer, "\tMesh Building took %3.2lf secs\n", meshesTime);
+        _exportTimeSummary += std::string(buffer);
+    }
     if (componentsTime > 1.0) {
         sprintf(buffer, "\tComponents Export took %3.2lf secs\n", componentsTime);
         _exportTimeSummary += std::string(buffer);
@@ -292,44 +393,221 @@ USDExporter::_performExport(const std::string& skpSrc,
         sprintf(buffer, "\tCameras Export took %3.2lf secs\n", camerasTime);
         _exportTimeSummary += std::string(buffer);
     }
+    if (validateTime > 1.0) {
+        sprintf(buffer, "\tValidation took %3.2lf secs\n", validateTime);
+        _exportTimeSummary += std::string(buffer);
+    }
     if (usdzTime > 1.0) {
         sprintf(buffer, "\tUSDZ Export took %3.2lf secs\n", usdzTime);
         _exportTimeSummary += std::string(buffer);
     }
+    return true;
+}
 
-    if (!SUIsInvalid(_model)) {
-        SUModelRelease(&_model);
-        SUSetInvalid(_model);
+void
+USDExporter::_ExtractScene(USDTextureHelper& textureHelper) {
+    std::string msg = std::string("Reading SketchUp Model");
+    SU_HandleProgress(_progressCallback, 5.0, msg);
+    SketchUpSceneExtractor extractor;
+    extractor.SetExtractFaces(GetExportMeshes());
+    extractor.SetExtractEdges(GetExportEdges());
+    extractor.SetExtractCurves(GetExportCurves());
+    extractor.SetExtractLines(GetExportLines());
+    extractor.SetExtractCameras(GetExportCameras());
+    extractor.SetExtractNormals(GetExportNormals());
+    // with double-sided export on, every mesh is written once, front side up
+    extractor.SetExtractBackUVs(!GetExportDoubleSided());
+    extractor.SetExtractNGons(GetExportNGons());
+    extractor.SetNativeTriangulation(GetNativeTriangulation());
+    extractor.SetMergeCoplanarFaces(GetMergeCoplanarFaces());
+    // every tag is looked up once here, rather than for every element
+    SketchUpVisibilityResolver visibility;
+    visibility.SetIncludedTags(GetIncludedTags());
+    visibility.SetExcludedTags(GetExcludedTags());
+    visibility.Resolve(_model);
+    extractor.SetVisibilityResolver(&visibility);
+    if (GetExportMaterials()) {
+        // the textures have to be loaded before the faces are read
+        textureHelper.SetTextureWriter(_textureWriter);
+        extractor.AddVisitor(&textureHelper);
+    }
+    extractor.Extract(_model, _textureWriter, _scene);
+}
+
+// Builds the mesh buffers for every definition and the scene on as many
+// threads as we have, and fills in the geometry counts for the summary.
+void
+USDExporter::_BuildMeshes() {
+    std::string msg = std::string("Building Meshes");
+    SU_HandleProgress(_progressCallback, 8.0, msg);
+    _meshBuilder.SetExportNormals(GetExportNormals());
+    _meshBuilder.SetExportMaterials(GetExportMaterials());
+    _meshBuilder.SetExportDoubleSided(GetExportDoubleSided());
+    _meshBuilder.SetWeldVertices(GetWeldVertices());
+    _meshBuilder.SetWeldTolerance(GetWeldTolerance());
+    _meshBuilder.SetCleanUpMeshes(GetCleanUpMeshes());
+    _meshBuilder.SetSortFacesByMaterial(GetSortFacesByMaterial());
+    // see _cacheDisplayMaterial
+    _meshBuilder.SetShareDisplayMaterial(!GetExportARKitCompatibleUSDZ() &&
+                                         _useSharedFallbackMaterial);
+    _meshBuilder.SetOmitClosedBackSides(GetOmitClosedBackSides());
+    _meshBuilder.Build(_scene);
+    StatsDataPoint* sceneStats = _meshBuilder.GetSceneStats();
+    if (sceneStats) {
+        _originalFacesCount = sceneStats->GetOriginalFacesCount();
+        _trianglesCount = sceneStats->GetTrianglesCount();
+        _removedFacesCount = sceneStats->GetRemovedFacesCount();
+        _meshesCount = sceneStats->GetMeshesCount();
+        _edgesCount = sceneStats->GetEdgesCount();
+        _curvesCount = sceneStats->GetCurvesCount();
+        _linesCount = sceneStats->GetLinesCount();
     }
-    return true;
 }
 
 #pragma mark Components:
 
+// Instancing a definition costs a master, a Materials scope in it, and a
+// reference and instance prim for every instance, which is more than a
+// definition with only a handful of triangles, or one that is used only
+// once, costs to write out in place. So with the cost model on, those are
+// flattened into their instances until, all together, the flattened
+// definitions have had GetFlattenTriangleBudget() triangles written out in
+// place. Of the rest, the ones with at least GetPointInstancerMinimum()
+// instances are the ones worth a point instancer.
+//
+// What an instance costs depends on where it's written: an instance inside
+// a master is written once however many times the master is instanced, but
+// one inside a flattened definition is written with every copy of it. So
+// the definitions are gone through parents first, and each hands down to
+// its children how many of their instances it writes.
 void
-USDExporter::_ExportComponentDefinitions(const pxr::SdfPath parentPath) {
-    size_t num_comp_defs = 0;
-    SU_CALL(SUModelGetNumComponentDefinitions(_model, &num_comp_defs));
-    if (!num_comp_defs) {
+USDExporter::_ChooseInstancing() {
+    const bool pointInstancers = GetExportPointInstancers() &&
+        !GetExportARKitCompatibleUSDZ();
+    const bool byCost = GetChooseInstancingByCost();
+    std::vector<const SceneDefinition*> definitions;
+    for (const SceneDefinition& definition : _scene.definitions) {
+        // the copies of a definition are written as the definition itself
+        if (_deduplicator.GetCanonicalKey(definition.key) != definition.key) {
+            continue;
+        }
+        _DefinitionRecord& record = _definitionRecords[definition.key];
+        record.definition = &definition;
+        record.pointInstance = pointInstancers;
+        definitions.push_back(&definition);
+    }
+    if (!byCost) {
         return ;
     }
-    if (!_countComponentDefinitionsActuallyUsed()) {
+    // how many instances of each definition we'll write, and how many of
+    // the definitions that instance it are still to be gone through
+    std::map<uintptr_t, unsigned long long> instanceCounts;
+    std::map<uintptr_t, size_t> pendingParents;
+    for (auto& child : _scene.children) {
+        instanceCounts[_deduplicator.GetCanonicalKey(child.first)] += child.second;
+    }
+    for (const SceneDefinition* definition : definitions) {
+        for (auto& child : definition->children) {
+            pendingParents[_deduplicator.GetCanonicalKey(child.first)]++;
+        }
+    }
+    std::vector<const SceneDefinition*> ready;
+    for (auto it = definitions.rbegin(); it != definitions.rend(); ++it) {
+        if (!pendingParents[(*it)->key]) {
+            ready.push_back(*it);
+        }
+    }
+    unsigned long long flattenedTriangles = 0;
+    size_t decided = 0;
+    while (decided < definitions.size()) {
+        if (ready.empty()) {
+            // SketchUp doesn't let a component contain itself, but if a file
+            // ever manages it, decide the rest with what we have so far
+            for (auto it = definitions.rbegin(); it != definitions.rend(); ++it) {
+                if (pendingParents[(*it)->key]) {
+                    pendingParents[(*it)->key] = 0;
+                    ready.push_back(*it);
+                }
+            }
+        }
+        const SceneDefinition& definition = *ready.back();
+        ready.pop_back();
+        decided++;
+        _DefinitionRecord& record = _definitionRecords[definition.key];
+        // the triangles of a definition include the ones of the definitions
+        // it instances, but flattening it only writes its own out in place
+        StatsDataPoint* stats = _meshBuilder.GetDefinitionStats(definition.key);
+        const unsigned long long triangles = stats ? stats->GetTrianglesCount() : 0;
+        unsigned long long ownTriangles = triangles;
+        for (auto& child : definition.children) {
+            StatsDataPoint* childStats = _meshBuilder.GetDefinitionStats(child.first);
+            if (childStats) {
+                const unsigned long long nested = child.second *
+                    childStats->GetTrianglesCount();
+                ownTriangles -= std::min(ownTriangles, nested);
+            }
+        }
+        const unsigned long long instances = instanceCounts[definition.key];
+        const unsigned long long cost = ownTriangles * instances;
+        std::string choice;
+        if ((triangles <= GetFlattenTriangleMaximum() || instances <= 1) &&
+            flattenedTriangles + cost <= GetFlattenTriangleBudget()) {
+            flattenedTriangles += cost;
+            record.flatten = true;
+            record.pointInstance = false;
+            _flattenedDefinitionCount++;
+            choice = "flattened";
+        } else if (pointInstancers &&
+                   instances >= GetPointInstancerMinimum()) {
+            _pointInstancedDefinitionCount++;
+            choice = "point instanced";
+        } else {
+            record.pointInstance = false;
+            choice = "instanced";
+        }
+        _instancingSummary += definition.name + ": " + choice + " (" +
+            std::to_string(triangles) + " triangles, " +
+            std::to_string(instances) + " instances)\n";
+        // a master writes its instances once, a flattened definition once
+        // for each of its own
+        const unsigned long long copies = record.flatten ? instances : 1;
+        for (auto& child : definition.children) {
+            const uintptr_t key = _deduplicator.GetCanonicalKey(child.first);
+            instanceCounts[key] += child.second * copies;
+            size_t& pending = pendingParents[key];
+            if (pending && !--pending) {
+                auto found = _definitionRecords.find(key);
+                if (found != _definitionRecords.end() && found->second.definition) {
+                    ready.push_back(found->second.definition);
+                }
+            }
+        }
+    }
+}
+
+void
+USDExporter::_ExportComponentDefinitions(const pxr::SdfPath parentPath) {
+    const size_t numMasters = _scene.definitions.size() -
+        _flattenedDefinitionCount - _mergedDefinitionCount;
+    if (!numMasters) {
+        // either there are none, or none of them need a master
         return ;
     }
-    pxr::UsdStageRefPtr topLevelStage = _stage;
+    pxr::SdfLayerHandle topLevelLayer = _writer.GetLayer();
+    _componentDefinitionLayer = _rootLayer;
     if (!GetExportToSingleFile()) {
         // open a new file and write the SketchUp component definitions there:
-        _stage = pxr::UsdStage::CreateNew(_componentDefinitionsFileName);
-        if (!_stage) {
+        _componentDefinitionLayer = pxr::SdfLayer::CreateNew(_componentDefinitionsFileName);
+        if (!_componentDefinitionLayer) {
             std::cerr << "Failed to create USD file "
                       << _componentDefinitionsFileName << std::endl;
             throw std::exception();
         }
         std::string fileNameOnly = pxr::TfGetBaseName(_componentDefinitionsFileName);
         _filePathsForZip.insert(fileNameOnly);
-        UsdGeomSetStageUpAxis(_stage, pxr::UsdGeomTokens->z); // SketchUp is Z-up
+        _setUpAxisZ(_componentDefinitionLayer); // SketchUp is Z-up
     }
-    // let's hold on to this stage. We need to do this because when we go
+    // let's hold on to this layer. We need to do this because when we go
     // through the rest of the scene graph, we may run into instances of
     // a component that has a material bound to it. We can't define that
     // material with the instance (that's not how instancing works), so
@@ -339,74 +617,65 @@ USDExporter::_ExportComponentDefinitions(const pxr::SdfPath parentPath) {
     // after the whole scene graph is looked at. At that point, we'll make
     // sure that all our components start with "over" (not "def"), since
     // we want them to not be visible on the stage. Also, if we're writing
-    // out to multiple files, we'll want to save our layer stage there.
-    _componentDefinitionStage = _stage;
-
-    auto primSchema = pxr::UsdGeomXform::Define(_stage, parentPath);
+    // out to multiple files, we'll want to save this layer at the end.
+    _writer.SetLayer(_componentDefinitionLayer);
 
-    _usedComponentNames.clear();
-    std::vector<SUComponentDefinitionRef> comp_defs(num_comp_defs);
-    SU_CALL(SUModelGetComponentDefinitions(_model, num_comp_defs,
-                                           &comp_defs[0], &num_comp_defs));
-    _componentDefinitionCount = num_comp_defs;
+    _componentNames.Clear();
+    const size_t num_comp_defs = _scene.definitions.size();
+    _componentDefinitionCount = numMasters;
     std::string msg = std::string("Writing ") + std::to_string(num_comp_defs)
         + " Component Definitions";
     SU_HandleProgress(_progressCallback, 10.0, msg);
-    for (size_t def = 0; def < num_comp_defs; ++def) {
-        _ExportComponentDefinition(parentPath, comp_defs[def]);
+    for (const SceneDefinition& definition : _scene.definitions) {
+        if (_deduplicator.GetCanonicalKey(definition.key) != definition.key) {
+            // its instances use the master of the one it's a copy of
+            continue;
+        }
+        _ExportComponentDefinition(parentPath, definition);
     }
     _currentDataPoint = NULL;
-    if (!GetExportToSingleFile()) {
-        _stage = topLevelStage;
-    }
+    // each definition had its own fallback material, the geometry below
+    // needs to go back to using the top level one.
+    _fallbackDisplayMaterialPath = _topLevelFallbackDisplayMaterialPath;
+    _writer.SetLayer(topLevelLayer);
 }
 
 void
 USDExporter::_ExportComponentDefinition(const pxr::SdfPath parentPath,
-                                        SUComponentDefinitionRef comp_def) {
-    _currentComponentDefinition = comp_def;
-    std::string name = GetComponentDefinitionName(comp_def);
-    if (_instancedComponentNames.find(name) == _instancedComponentNames.end()) {
-        // this component was not actually instanced, so move on to the next one
-        return;
-    }
+                                        const SceneDefinition& definition) {
+    const std::string& name = definition.name;
     // this name might not be a valid USD scope name so we have to make it safe
     std::string cName = pxr::TfMakeValidIdentifier(name) + componentDefinitionSuffix;
-    cName = SafeNameFromExclusionList(cName, _usedComponentNames);
+    cName = _componentNames.Allocate(cName);
     // okay, now that we have a version of this name that we can use as a USD
     // scope, we need to store a few relationships that we'll need later to
     // track back to this specific component definition:
     _originalComponentNameSafeNameDictionary[name] = cName; // for metadata
-    _usedComponentNames.insert(cName); // so we know not to reuse it
-    uintptr_t index = reinterpret_cast<uintptr_t>(comp_def.ptr);
-    // so we can find this name given an instance
-    _componentPtrSafeNameMap[index] = cName;
-    
-    SUEntityRef entity = SUComponentDefinitionToEntity(comp_def);
-    if (SUIsValid(entity)) {
-        SUDrawingElementRef de = SUDrawingElementFromEntity(entity);
-        if (SUIsValid(de)) {
-            SUMaterialRef thisComponentMaterial = SU_INVALID;
-            SUDrawingElementGetMaterial(de, &thisComponentMaterial);
-            if (SUIsValid(thisComponentMaterial)) {
-                //std::cerr << "found a material on the component definition" << std::endl;
-                _groupMaterial = thisComponentMaterial;
-            }
-        }
-    }
-    SUEntitiesRef entities = SU_INVALID;
-    SUComponentDefinitionGetEntities(comp_def, &entities);
-    
+
     const pxr::TfToken child(cName);
     const pxr::SdfPath path = parentPath.AppendChild(child);
+    // so we can find all this given an instance
+    _DefinitionRecord& record = _definitionRecords[definition.key];
+    record.masterPath = path;
+    // Swap "__SUComponentDefinition" with "__USDInstance_", each instance
+    // will then suffix it with its count
+    std::regex replaceExpr(componentDefinitionSuffix);
+    record.instanceBaseName = std::regex_replace(cName, replaceExpr,
+                                                 instanceSuffix);
+    record.instancerBaseName = std::regex_replace(cName, replaceExpr,
+                                                  instancerSuffix);
+    record.isBillboard = definition.isBillboard;
+    if (record.flatten) {
+        // its instances carry its geometry, so there's no master to write
+        return ;
+    }
     // we want to track stats for this particular component so that every time
     // we instance one, we can increment our export info appropriately.
-    StatsDataPoint* newDataPoint = new StatsDataPoint();
-    _componentMasterStats[path] = newDataPoint;
-    _currentDataPoint = newDataPoint;
+    record.stats.reset(new StatsDataPoint());
+    _currentDataPoint = record.stats.get();
     
-    auto primSchema = pxr::UsdGeomXform::Define(_stage, path);
-    // note: we're using "Define" here, but we really want an "Over" so that
+    auto prim = _writer.DefinePrim(path, "Xform");
+    // note: we're using "def" here, but we really want an "Over" so that
     // these component "masters" don't get drawn in the scene - we just want
     // them defined so we can reference them later when making instances.
     // We will have a "finalize" pass where we go through at the end and make
@@ -418,106 +687,29 @@ USDExporter::_ExportComponentDefinition(const pxr::SdfPath parentPath,
     // arbitrary distance away in references. For example (explain the
     // prop/set/shot scenario here).
     _componentDefinitionPaths.insert(path);
-    auto prim = primSchema.GetPrim();
-    prim.SetMetadata(pxr::SdfFieldKeys->Kind,
-                     pxr::KindTokens->component);
-    auto keyPath = pxr::TfToken("SketchUp:name");
-    pxr::VtValue nameV(name);
-    prim.SetCustomDataByKey(keyPath, nameV);
-
-    SUComponentBehavior behavior;
-    SU_CALL(SUComponentDefinitionGetBehavior(comp_def, &behavior));
-    _isBillboard = behavior.component_always_face_camera;
-    
+    prim->SetKind(pxr::KindTokens->component);
+    _writer.SetCustomData(prim, "SketchUp:name", pxr::VtValue(name));
+
     // Before we do anything else, we should export our fallback material here
     if (!GetExportARKitCompatibleUSDZ()) {
         // currently, the fallback material doesn't work on macOS or iOS
         _ExportFallbackDisplayMaterial(path);
     }
     
-    _ExportEntities(path, entities);
-}
-
-int
-USDExporter::_countComponentDefinitionsActuallyUsed() {
-    SUEntitiesRef model_entities;
-    SU_CALL(SUModelGetEntities(_model, &model_entities));
-    // We first need to confirm that a given definition is actually instanced
-    // in this file. If not, we shouldn't bother to write it out.
-    _instancedComponentNames.clear();
-    return _countEntities(model_entities);
-}
-
-int
-USDExporter::_countEntities(SUEntitiesRef entities) {
-    int instancedComponents = 0;
-    size_t num_instances = 0;
-    SU_CALL(SUEntitiesGetNumInstances(entities, &num_instances));
-    if (num_instances > 0) {
-        std::vector<SUComponentInstanceRef> instances(num_instances);
-        SU_CALL(SUEntitiesGetInstances(entities, num_instances,
-                                       &instances[0], &num_instances));
-        for (size_t c = 0; c < num_instances; c++) {
-            SUComponentInstanceRef instance = instances[c];
-            SUComponentDefinitionRef definition = SU_INVALID;
-            
-            SUDrawingElementRef de = SUComponentInstanceToDrawingElement(instance);
-            if (SUIsValid(de)) {
-                bool isHidden = false;
-                SUDrawingElementGetHidden(de, &isHidden);
-                if (isHidden) {
-                    continue;
-                }
-                // need to find out what layer it's on, and make sure that layer
-                // is visible
-                SULayerRef layer;
-                SU_CALL(SUDrawingElementGetLayer(de, &layer));
-                bool visible = true;
-                SU_CALL(SULayerGetVisibility(layer, &visible));
-                if (!visible) {
-                    //std::cerr << cName << " is on a hidden layer - skipping" << std::endl;
-                    continue;
-                }
-            }
-            SU_CALL(SUComponentInstanceGetDefinition(instance, &definition));
-            std::string definitionName = GetComponentDefinitionName(definition);
-            _instancedComponentNames.insert(definitionName);
-            SUEntitiesRef subEntities = SU_INVALID;
-            SUComponentDefinitionGetEntities(definition, &subEntities);
-            instancedComponents += _countEntities(subEntities);
-        }
-        instancedComponents += num_instances;
-    }
-    size_t num_groups = 0;
-    SU_CALL(SUEntitiesGetNumGroups(entities, &num_groups));
-    if (!num_groups) {
-        return  instancedComponents;
-    }
-    std::vector<SUGroupRef> groups(num_groups);
-    SU_CALL(SUEntitiesGetGroups(entities, num_groups, &groups[0], &num_groups));
-    for (size_t g = 0; g < num_groups; g++) {
-        SUGroupRef group = groups[g];
-        SUEntitiesRef group_entities = SU_INVALID;
-        SU_CALL(SUGroupGetEntities(group, &group_entities));
-        instancedComponents += _countEntities(group_entities);
-    }
-    return instancedComponents;
+    _ExportEntities(path, definition.entities);
 }
 
 void
 USDExporter::_FinalizeComponentDefinitions() {
     for (pxr::SdfPath path : _componentDefinitionPaths) {
-        auto prim = _componentDefinitionStage->GetPrimAtPath(path);
+        pxr::SdfPrimSpecHandle prim = _componentDefinitionLayer->GetPrimAtPath(path);
         // we're using a pattern from:
         // https://graphics.pixar.com/usd/docs/api/class_usd_geom_point_instancer.html
         // note that it is vital that we set the specifier *after* we
         // have specified all our children, as we expect them to be using
         // "def" with abandon. We do it here, after we have done all the
-        // modifications to the stage that have these component definitions.
-        prim.SetSpecifier(pxr::SdfSpecifierOver);
-    }
-    if (!GetExportToSingleFile() && _componentDefinitionPaths.size()) {
-        _componentDefinitionStage->Save();
+        // modifications to the layer that have these component definitions.
+        prim->SetSpecifier(pxr::SdfSpecifierOver);
     }
 }
 
@@ -525,11 +717,10 @@ USDExporter::_FinalizeComponentDefinitions() {
 #pragma mark SceneGraph:
 
 void
-USDExporter::_ExportTextures(const pxr::SdfPath parentPath) {
+USDExporter::_ExportTextures(USDTextureHelper& textureHelper) {
     // note: if this is a usdz file, we put the textureDirectory
     // into the tmp dir we're writing the usdc to
-    USDTextureHelper textureHelper;
-    if (!textureHelper.LoadAllTextures(_model, _textureWriter, false)) {
+    if (!textureHelper.GetNumTextures()) {
         return ;
     }
     if (textureHelper.MakeTextureDirectory(_textureDirectory)) {
@@ -555,309 +746,428 @@ USDExporter::_ExportFallbackDisplayMaterial(const pxr::SdfPath path) {
 
 void
 USDExporter::_ExportGeom(const pxr::SdfPath parentPath) {
-    // If not saving to a single file, create a new sublayer for geometry on
-    // the stage and grab an edit target that points to that sublayer,
-    // otherwise leave the editTarget to the current one on the stage.
+    // If not saving to a single file, create a new sublayer for geometry
+    // under the root layer and write into that, otherwise keep writing into
+    // the root layer.
     // Note that this is a different approach than we took for writing out
-    // the components where we opened a new stage and wrote them there.
-    pxr::UsdEditTarget editTarget = _stage->GetEditTarget();
+    // the components, which are referenced rather than sublayered in.
     if (!GetExportToSingleFile()) {
-        pxr::SdfLayerRefPtr geomSublayer = pxr::SdfLayer::CreateNew(_geomFileName);
+        _geomLayer = pxr::SdfLayer::CreateNew(_geomFileName);
+        if (!_geomLayer) {
+            std::cerr << "Failed to create USD file "
+                      << _geomFileName << std::endl;
+            throw std::exception();
+        }
         std::string fileNameOnly = pxr::TfGetBaseName(_geomFileName);
         _filePathsForZip.insert(fileNameOnly);
         // we want to make this path relative:
         std::string layerPath("./" + pxr::TfGetBaseName(_geomFileName));
-        _stage->GetRootLayer()->InsertSubLayerPath(layerPath);
-        editTarget = _stage->GetEditTargetForLocalLayer(geomSublayer);
+        _rootLayer->InsertSubLayerPath(layerPath);
+        _writer.SetLayer(_geomLayer);
     }
-    // Use a UsdEditContext to direct subsequent edits to the desired edit
-    // target until it goes out of scope.
-    pxr::UsdEditContext editContext(_stage, editTarget);
 
-    SUEntitiesRef model_entities;
-    SU_CALL(SUModelGetEntities(_model, &model_entities));
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Geom"));
-    auto primSchema = pxr::UsdGeomXform::Define(_stage, path);
-    // this will be eventually be used to figure out which shader to emit.
-    _isBillboard = false;
+    _writer.DefinePrim(path, "Xform");
     std::string msg = std::string("Writing Geometry");
     SU_HandleProgress(_progressCallback, 40.0, msg);
-    _ExportEntities(path, model_entities);
+    _ExportEntities(path, _scene.entities);
+    // everything after this (i.e. the cameras) goes in the root layer
+    _writer.SetLayer(_rootLayer);
 }
 
 void
 USDExporter::_ExportEntities(const pxr::SdfPath parentPath,
-                             SUEntitiesRef entities) {
-    _ExportInstances(parentPath, entities);
-    _ExportGroups(parentPath, entities);
-    if (GetExportMeshes()) {
-        _ExportFaces(parentPath, entities);
+                             const SceneEntities& entities) {
+    _ExportInstances(parentPath, entities.instances);
+    _ExportGroups(parentPath, entities.groups);
+    // the extractor only fills in what we asked it to, so we just write
+    // out whatever is there.
+    if (!entities.mesh.faceVertexCounts.empty()) {
+        _ExportFaces(parentPath, entities.mesh);
     }
-    if (GetExportEdges()) {
-        _ExportEdges(parentPath, entities);
+    if (!entities.edges.vertexCounts.empty()) {
+        _ExportEdges(parentPath, entities.edges);
     }
-    if (GetExportCurves()) {
-        _ExportCurves(parentPath, entities);
+    if (!entities.curves.vertexCounts.empty()) {
+        _ExportCurves(parentPath, entities.curves);
     }
-    if (GetExportLines()) {
-        _ExportPolylines(parentPath, entities);
+    if (!entities.polylines.vertexCounts.empty()) {
+        _ExportPolylines(parentPath, entities.polylines);
     }
 }
 
 #pragma mark Instances:
 void
 USDExporter::_ExportInstances(const pxr::SdfPath parentPath,
-                              SUEntitiesRef entities) {
-    size_t num = 0;
-    SU_CALL(SUEntitiesGetNumInstances(entities, &num));
-    if (!num) {
+                              const std::vector<SceneInstance>& instances) {
+    // ARKit doesn't read point instancers, so it always gets Xforms
+    if (!GetExportPointInstancers() || GetExportARKitCompatibleUSDZ()) {
+        for (const SceneInstance& instance : instances) {
+            if (_ExportInstance(parentPath, instance)) {
+                _componentInstanceCount++;
+            }
+        }
         return ;
     }
-    std::vector<SUComponentInstanceRef> instances(num);
-    SU_CALL(SUEntitiesGetInstances(entities, num, &instances[0], &num));
-    _componentInstanceCount += num;
-    for (size_t i = 0; i < num; i++) {
-        _ExportInstance(parentPath, instances[i]);
+    // the definitions in the order their first instance comes in
+    std::vector<uintptr_t> definitions;
+    std::unordered_map<uintptr_t, std::vector<const SceneInstance*>> definitionInstances;
+    for (const SceneInstance& instance : instances) {
+        const uintptr_t definition = _deduplicator.GetCanonicalKey(instance.definition);
+        auto& list = definitionInstances[definition];
+        if (list.empty()) {
+            definitions.push_back(definition);
+        }
+        list.push_back(&instance);
+    }
+    for (uintptr_t definition : definitions) {
+        const std::vector<const SceneInstance*>& list = definitionInstances[definition];
+        auto found = _definitionRecords.find(definition);
+        if (found != _definitionRecords.end() && found->second.pointInstance &&
+            list.size() >= GetPointInstancerMinimum()) {
+            _componentInstanceCount += _ExportPointInstancer(parentPath,
+                                                             found->second,
+                                                             list);
+            continue;
+        }
+        for (const SceneInstance* instance : list) {
+            if (_ExportInstance(parentPath, *instance)) {
+                _componentInstanceCount++;
+            }
+        }
     }
 }
 
-bool
-USDExporter::_ExportInstance(const pxr::SdfPath parentPath,
-                             SUComponentInstanceRef instance) {
-    SUComponentDefinitionRef definition = SU_INVALID;
-    SU_CALL(SUComponentInstanceGetDefinition(instance, &definition));
-    // unfortunately, we can't depend that the name of the definition will
-    // be unique across the file so we need to turn this specific component's
-    // pointer into something we can use as an index to find this later
-    // we'll want to go from this void* to our transformed name
-    uintptr_t index = reinterpret_cast<uintptr_t>(definition.ptr);
-    auto cName = _componentPtrSafeNameMap[index];
-    pxr::SdfPath componentMasterPath("/" + cName);
-    // Convert this to a drawing entity and see if it is hidden.
-    // if it is, we skip to the next one:
-    SUDrawingElementRef de = SUComponentInstanceToDrawingElement(instance);
-    if (SUIsValid(de)) {
-        bool isHidden = false;
-        SUDrawingElementGetHidden(de, &isHidden);
-        if (isHidden) {
-            //std::cerr << cName << " is hidden - skipping" << std::endl;
+// A point instancer can only scale, rotate and then move each instance, so
+// this fails for a transform with any shear or projection in it. SketchUp
+// keeps a uniform scale in the w of the transform (w = 1/scale), which we
+// write out as-is for Xforms, so it's divided through here first.
+static bool
+_factorInstanceTransform(const pxr::GfMatrix4d& transform,
+                         pxr::GfVec3f& position, pxr::GfQuath& orientation,
+                         pxr::GfVec3f& scale) {
+    static const double tolerance = 1.0e-5;
+    const double w = transform[3][3];
+    if (std::fabs(w) <= tolerance) {
+        return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (std::fabs(transform[i][3]) > tolerance) {
+            return false;
+        }
+    }
+    pxr::GfVec3d axes[3];
+    double scales[3];
+    for (int i = 0; i < 3; i++) {
+        axes[i] = pxr::GfVec3d(transform[i][0] / w, transform[i][1] / w,
+                               transform[i][2] / w);
+        scales[i] = axes[i].GetLength();
+        if (scales[i] <= tolerance) {
             return false;
         }
-        // need to find out what layer it's on, and make sure that layer
-        // is visible
-        SULayerRef layer;
-        SU_CALL(SUDrawingElementGetLayer(de, &layer));
-        bool visible = true;
-        SU_CALL(SULayerGetVisibility(layer, &visible));
-        if (!visible) {
-            //std::cerr << cName << " is on a hidden layer - skipping" << std::endl;
+        axes[i] = axes[i] / scales[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        if (std::fabs(pxr::GfDot(axes[i], axes[(i + 1) % 3])) > tolerance) {
             return false;
         }
     }
+    // a mirrored instance gets a negative scale along x
+    if (pxr::GfDot(pxr::GfCross(axes[0], axes[1]), axes[2]) < 0.0) {
+        scales[0] = -scales[0];
+        axes[0] = -axes[0];
+    }
+    pxr::GfMatrix4d rotation(axes[0][0], axes[0][1], axes[0][2], 0.0,
+                             axes[1][0], axes[1][1], axes[1][2], 0.0,
+                             axes[2][0], axes[2][1], axes[2][2], 0.0,
+                             0.0, 0.0, 0.0, 1.0);
+    orientation = pxr::GfQuath(rotation.ExtractRotation().GetQuat());
+    scale = pxr::GfVec3f(scales[0], scales[1], scales[2]);
+    position = pxr::GfVec3f(transform[3][0] / w, transform[3][1] / w,
+                            transform[3][2] / w);
+    return true;
+}
+
+// All the instances of one definition under the same parent go out as a
+// single UsdGeomPointInstancer, with a prototype for each material they're
+// painted with. The instance colors also go out as per instance primvars.
+// Instances with a transform the instancer can't express are written as
+// Xforms as usual. Returns how many instances were written.
+size_t
+USDExporter::_ExportPointInstancer(const pxr::SdfPath parentPath,
+                                   _DefinitionRecord& record,
+                                   const std::vector<const SceneInstance*>& instances) {
+    pxr::VtArray<pxr::GfVec3f> positions;
+    pxr::VtArray<pxr::GfQuath> orientations;
+    pxr::VtArray<pxr::GfVec3f> scales;
+    pxr::VtArray<int> protoIndices;
+    pxr::VtArray<pxr::GfVec3f> rgbs;
+    pxr::VtArray<float> opacities;
+    bool painted = false;
+    // the material of each prototype
+    std::vector<int> prototypes;
+    size_t count = 0;
+    for (const SceneInstance* instance : instances) {
+        pxr::GfVec3f position;
+        pxr::GfQuath orientation;
+        pxr::GfVec3f scale;
+        if (!_factorInstanceTransform(instance->transform, position,
+                                      orientation, scale)) {
+            if (_ExportInstance(parentPath, *instance)) {
+                count++;
+            }
+            continue;
+        }
+        auto prototype = std::find(prototypes.begin(), prototypes.end(),
+                                   instance->material);
+        protoIndices.push_back((int)(prototype - prototypes.begin()));
+        if (prototype == prototypes.end()) {
+            prototypes.push_back(instance->material);
+        }
+        positions.push_back(position);
+        orientations.push_back(orientation);
+        scales.push_back(scale);
+        pxr::GfVec3f rgb(1.0f, 1.0f, 1.0f);
+        float opacity = 1.0f;
+        if (instance->material >= 0) {
+            const SceneMaterial& material = _scene.materials[instance->material];
+            if (material.hasColor) {
+                rgb = material.rgb;
+                opacity = material.opacity;
+            }
+            painted = true;
+        }
+        rgbs.push_back(rgb);
+        opacities.push_back(opacity);
+        _countInstance(record);
+        count++;
+    }
+    if (positions.empty()) {
+        return count;
+    }
+    const std::string instancerName = record.instancerBaseName +
+        std::to_string(++record.instancerCount);
+    pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken(instancerName));
+    auto instancer = _writer.DefinePrim(path, "PointInstancer");
+    pxr::SdfPath prototypesPath = path.AppendChild(pxr::TfToken("Prototypes"));
+    _writer.DefinePrim(prototypesPath, "Scope");
+    pxr::SdfPathVector prototypePaths;
+    for (size_t i = 0; i < prototypes.size(); i++) {
+        std::string prototypeName = "Prototype";
+        if (i != 0) {
+            prototypeName += "_" + std::to_string(i);
+        }
+        pxr::SdfPath prototypePath = prototypesPath.AppendChild(pxr::TfToken(prototypeName));
+        auto prototype = _writer.DefinePrim(prototypePath, "Xform");
+        if (prototypes[i] >= 0) {
+            _bindInstanceMaterial(prototype, record.masterPath, prototypes[i]);
+        }
+        _referenceComponentMaster(prototype, record);
+        prototypePaths.push_back(prototypePath);
+    }
+    // each target goes in front of the ones before it, so the last goes first
+    for (auto it = prototypePaths.rbegin(); it != prototypePaths.rend(); ++it) {
+        _writer.AddRelationshipTarget(instancer, "prototypes", *it);
+    }
+    _writer.SetAttribute(instancer, "protoIndices",
+                         pxr::SdfValueTypeNames->IntArray,
+                         pxr::VtValue(protoIndices));
+    _writer.SetAttribute(instancer, "positions",
+                         pxr::SdfValueTypeNames->Point3fArray,
+                         pxr::VtValue(positions));
+    _writer.SetAttribute(instancer, "orientations",
+                         pxr::SdfValueTypeNames->QuathArray,
+                         pxr::VtValue(orientations));
+    _writer.SetAttribute(instancer, "scales",
+                         pxr::SdfValueTypeNames->Float3Array,
+                         pxr::VtValue(scales));
+    if (painted) {
+        // per instance, which is what vertex interpolation means here
+        _writer.SetPrimvar(instancer, "displayColor",
+                           pxr::SdfValueTypeNames->Color3fArray,
+                           pxr::VtValue(rgbs), pxr::UsdGeomTokens->vertex);
+        _writer.SetPrimvar(instancer, "displayOpacity",
+                           pxr::SdfValueTypeNames->FloatArray,
+                           pxr::VtValue(opacities), pxr::UsdGeomTokens->vertex);
+    }
+    return count;
+}
+
+bool
+USDExporter::_ExportInstance(const pxr::SdfPath parentPath,
+                             const SceneInstance& instance) {
+    auto found = _definitionRecords.find(
+        _deduplicator.GetCanonicalKey(instance.definition));
+    if (found == _definitionRecords.end()) {
+        std::cerr << "WARNING: instance under " << parentPath;
+        std::cerr << " refers to a component that was not exported" << std::endl;
+        return false;
+    }
+    _DefinitionRecord& record = found->second;
+    if (record.flatten) {
+        return _ExportFlattenedInstance(parentPath, instance, record);
+    }
     // we want to keep track of how many instances for a given master/class
     // we've declared, so that we can name them with a running value.
-    auto status = _instanceCountPerClass.emplace(cName, 0);
-    const int instanceCount = ++(status.first->second);
-    _instanceCountPerClass[cName] = instanceCount;
-
-    // Swap "__SUComponentDefinition" with "__USDInstance_"
-    // and then suffix it with the current instanceCount
-    std::regex replaceExpr(componentDefinitionSuffix);
-    std::string baseName = std::regex_replace(cName,
-                                              replaceExpr, instanceSuffix);
-    std::string instanceName = baseName + std::to_string(instanceCount);
-    std::string realInstanceName = GetComponentInstanceName(instance);
-    
-    SUComponentBehavior behavior;
-    SU_CALL(SUComponentDefinitionGetBehavior(definition, &behavior));
-    _isBillboard = behavior.component_always_face_camera;
+    const int instanceCount = ++record.instanceCount;
+    std::string instanceName = record.instanceBaseName + std::to_string(instanceCount);
 
     //std::cerr << "appending instanceName " << instanceName << " to parentPath " << parentPath << std::endl;
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken(instanceName));
-    auto primSchema = pxr::UsdGeomXform::Define(_stage, path);
-    auto instancePrim = primSchema.GetPrim();
-
-    // this instance might have a material bound to it, so we need to
-    // find it and use it here
-    SUMaterialRef instanceMaterial = SU_INVALID;
-    SUDrawingElementGetMaterial(de, &instanceMaterial);
-    if (SUIsValid(instanceMaterial)) {
-        // in theory, we could have a texture, a color, or neither
-        // in practice, I expect we'll have a texture or a color
-        // we might have a single mesh that has many materials, many of which are
-        // the same. Since SketchUp has such a simple material schema (just a
-        // texture map at most), we want to coalesce these as much as possible.
-        pxr::SdfPath materialsPath = componentMasterPath.AppendChild(pxr::TfToken("Materials"));
-        auto primSchema = pxr::UsdGeomScope::Define(_stage, materialsPath);
-        pxr::TfToken relName = pxr::UsdShadeTokens->materialBinding;
-
-        SUTextureRef textureRef = SU_INVALID;
-        if (SU_ERROR_NONE == SUMaterialGetTexture(instanceMaterial, &textureRef)) {
-            std::string textureName = _textureFileName(textureRef);
-            std::string texturePath = _textureDirectory + "/" + textureName;
-            std::string safeName = "TextureMaterial_" + pxr::TfMakeValidIdentifier(texturePath);
-            pxr::TfToken materialName(safeName);
-            pxr::SdfPath materialPath = materialsPath.AppendChild(materialName);
-            _ExportTextureMaterial(materialPath, texturePath);
-            instancePrim.CreateRelationship(relName).AddTarget(materialPath);
-        } else {
-            SUColor color;
-            SU_RESULT result = SUMaterialGetColor(instanceMaterial, &color);
-            if (result == SU_ERROR_NONE) {
-                pxr::GfVec3f rgb;
-                rgb[0] = ((int)color.red)/255.0;
-                rgb[1] = ((int)color.green)/255.0;
-                rgb[2] = ((int)color.blue)/255.0;
-                float opacity = ((int)color.alpha)/255.0;
-                pxr::TfToken materialName(_generateRGBAMaterialName(rgb, opacity));
-                pxr::SdfPath materialPath = materialsPath.AppendChild(materialName);
-                _ExportRGBAMaterial(materialPath, rgb, opacity);
-                instancePrim.CreateRelationship(relName).AddTarget(materialPath);
-            } else {
-                std::cerr << "WARNING: material on instance" << path;
-                std::cerr << "has no texture or color!" << std::endl;
-            }
-        }
+    auto instancePrim = _writer.DefinePrim(path, "Xform");
+    // this instance might have a material bound to it
+    if (instance.material >= 0) {
+        _bindInstanceMaterial(instancePrim, record.masterPath,
+                              instance.material);
+    }
+    _referenceComponentMaster(instancePrim, record);
+    _writer.SetTransform(instancePrim, instance.transform);
+    _countInstance(record);
+    return true;
+}
+
+void
+USDExporter::_bindInstanceMaterial(const pxr::SdfPrimSpecHandle& prim,
+                                   const pxr::SdfPath& materialsParentPath,
+                                   int material) {
+    const SceneMaterial& instanceMaterial = _scene.materials[material];
+    // in theory, we could have a texture, a color, or neither
+    // in practice, I expect we'll have a texture or a color
+    // we might have a single mesh that has many materials, many of which are
+    // the same. Since SketchUp has such a simple material schema (just a
+    // texture map at most), we want to coalesce these as much as possible.
+    pxr::SdfPath materialsPath = materialsParentPath.AppendChild(pxr::TfToken("Materials"));
+    _writer.DefinePrim(materialsPath, "Scope");
+    const std::string& relName = pxr::UsdShadeTokens->materialBinding.GetString();
+
+    if (!instanceMaterial.textureName.empty()) {
+        std::string texturePath = _textureDirectory + "/" + instanceMaterial.textureName;
+        std::string safeName = "TextureMaterial_" + pxr::TfMakeValidIdentifier(texturePath);
+        pxr::TfToken materialName(safeName);
+        pxr::SdfPath materialPath = materialsPath.AppendChild(materialName);
+        _ExportTextureMaterial(materialPath, texturePath);
+        _writer.AddRelationshipTarget(prim, relName, materialPath);
+    } else if (instanceMaterial.hasColor) {
+        pxr::GfVec3f rgb = instanceMaterial.rgb;
+        float opacity = instanceMaterial.opacity;
+        pxr::TfToken materialName(_generateRGBAMaterialName(rgb, opacity));
+        pxr::SdfPath materialPath = materialsPath.AppendChild(materialName);
+        _ExportRGBAMaterial(materialPath, rgb, opacity);
+        _writer.AddRelationshipTarget(prim, relName, materialPath);
+    } else {
+        std::cerr << "WARNING: material on instance" << prim->GetPath();
+        std::cerr << "has no texture or color!" << std::endl;
+    }
+}
+
+// Writes the definition's geometry in place of a reference to its master.
+// The instance's material goes in a Materials scope of its own, and its
+// materials are counted as they're written rather than by _countInstance.
+bool
+USDExporter::_ExportFlattenedInstance(const pxr::SdfPath parentPath,
+                                      const SceneInstance& instance,
+                                      _DefinitionRecord& record) {
+    const int instanceCount = ++record.instanceCount;
+    std::string instanceName = record.instanceBaseName + std::to_string(instanceCount);
+    pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken(instanceName));
+    auto prim = _writer.DefinePrim(path, "Xform");
+    if (instance.material >= 0) {
+        _bindInstanceMaterial(prim, path, instance.material);
     }
+    if (record.isBillboard) {
+        _writer.SetCustomData(prim, "SketchUp:billboard",
+                              pxr::VtValue(record.isBillboard));
+    }
+    _writer.SetTransform(prim, instance.transform);
+    _ExportEntities(path, record.definition->entities);
+    return true;
+}
 
+// Makes prim an instance of the component master: everything but where it
+// goes and what material it has.
+void
+USDExporter::_referenceComponentMaster(const pxr::SdfPrimSpecHandle& prim,
+                                       const _DefinitionRecord& record) {
+    const pxr::SdfPath& componentMasterPath = record.masterPath;
     if (GetExportARKitCompatibleUSDZ()) {
         // ARKit 2 in iOS 12.0 can't handle instances
-        primSchema.GetPrim().SetInstanceable(false);
+        prim->SetInstanceable(false);
     } else {
-        primSchema.GetPrim().SetInstanceable(true);
+        prim->SetInstanceable(true);
     }
-    if (_isBillboard) {
-        auto keyPath = pxr::TfToken("SketchUp:billboard");
-        pxr::VtValue billboard(_isBillboard);
-        primSchema.GetPrim().SetCustomDataByKey(keyPath, billboard);
+    if (record.isBillboard) {
+        _writer.SetCustomData(prim, "SketchUp:billboard",
+                              pxr::VtValue(record.isBillboard));
     }
     if (GetExportToSingleFile()) {
-        // masters are always at the root
-        std::string referencePath("/" + cName);
-        auto prim = primSchema.GetPrim();
-        prim.GetReferences().AddInternalReference(pxr::SdfPath(referencePath));
+        // masters are always at the root, and an empty asset path makes
+        // this an internal reference
+        pxr::SdfReference reference(std::string(), componentMasterPath);
+        prim->GetReferenceList().Prepend(reference);
     } else {
         std::string baseName = pxr::TfGetBaseName(_componentDefinitionsFileName);
         std::string assetPath("./" + baseName);
-        pxr::SdfPath primPath("/" + cName);
-        primSchema.GetPrim().GetReferences().AddReference(assetPath, primPath);
-    }
-    SUTransformation t;
-    SU_CALL(SUComponentInstanceGetTransform(instance, &t));
-    pxr::GfMatrix4d usdMatrix = usdTransformFromSUTransform(t);
-    primSchema.MakeMatrixXform().Set(usdMatrix, pxr::UsdTimeCode::Default());
-    // finally, let's increment our various counters based on what's in
-    // this instance.
-    if (_componentMasterStats.find(componentMasterPath) != _componentMasterStats.end()) {
-        StatsDataPoint* masterDataPoint = _componentMasterStats[componentMasterPath];
-        if (masterDataPoint) {
-            _originalFacesCount += masterDataPoint->GetOriginalFacesCount();
-            _trianglesCount += masterDataPoint->GetTrianglesCount();
-             _meshesCount +=  masterDataPoint->GetMeshesCount();
-            _edgesCount += masterDataPoint->GetEdgesCount();
-            _curvesCount += masterDataPoint->GetCurvesCount();
-            _linesCount += masterDataPoint->GetLinesCount();
-            _materialsCount += masterDataPoint->GetMaterialsCount();
-            _shadersCount += masterDataPoint->GetShadersCount();
-        } else {
-            std::cerr << "ERROR: unable to find stats for component master ";
-            std::cerr << componentMasterPath << std::endl;
-        }
-    }  else {
-        std::cerr << "ERROR: unable to find stats for component master ";
-        std::cerr << componentMasterPath << std::endl;
-    }
-    // We also need to count an extra material if we made one
-    if (SUIsValid(instanceMaterial)) {
-        
+        pxr::SdfReference reference(assetPath, componentMasterPath);
+        prim->GetReferenceList().Prepend(reference);
     }
+}
 
-    return true;
+// increments our various counters based on what's in an instance
+void
+USDExporter::_countInstance(const _DefinitionRecord& record) {
+    StatsDataPoint* masterDataPoint = record.stats.get();
+    if (masterDataPoint) {
+        // the geometry counts were already rolled up by the mesh
+        // builder, this is just what we counted while writing the master
+        _materialsCount += masterDataPoint->GetMaterialsCount();
+        _shadersCount += masterDataPoint->GetShadersCount();
+        _geomSubsetsCount += masterDataPoint->GetGeomSubsetsCount();
+    } else {
+        std::cerr << "ERROR: unable to find stats for component master ";
+        std::cerr << record.masterPath << std::endl;
+    }
 }
 
 #pragma mark Groups:
 void
 USDExporter::_ExportGroups(const pxr::SdfPath parentPath,
-                           SUEntitiesRef entities) {
-    size_t num = 0;
-    SU_CALL(SUEntitiesGetNumGroups(entities, &num));
-    if (!num) {
-        return ;
-    }
-    std::vector<SUGroupRef> groups(num);
-    SU_CALL(SUEntitiesGetGroups(entities, num, &groups[0], &num));
-    std::set<std::string> groupNamesUsed;
-    for (size_t i = 0; i < num; i++) {
-        std::string groupName = _ExportGroup(parentPath,
-                                             groups[i], groupNamesUsed);
-        if (groupName != "") {
-            groupNamesUsed.insert(groupName);
-        }
+                           const std::vector<SceneGroup>& groups) {
+    UniqueNameAllocator groupNames;
+    for (const SceneGroup& group : groups) {
+        _ExportGroup(parentPath, group, groupNames);
     }
 }
 
 std::string
-USDExporter::_ExportGroup(const pxr::SdfPath parentPath, SUGroupRef group,
-                          std::set<std::string>& usedGroupNames) {
-    SUDrawingElementRef drawingElement = SUGroupToDrawingElement(group);
-    if (SUIsValid(drawingElement)) {
-        bool isHidden = false;
-        SUDrawingElementGetHidden(drawingElement, &isHidden);
-        if (isHidden) {
-            return "";
-        }
-        // need to find out what layer it's on, and make sure that layer
-        // is visible
-        SULayerRef layer;
-        SU_CALL(SUDrawingElementGetLayer(drawingElement, &layer));
-        bool visible = true;
-        SU_CALL(SULayerGetVisibility(layer, &visible));
-        if (!visible) {
-            //std::cerr << cName << " is on a hidden layer - skipping" << std::endl;
-            return "";
-        }
-
-    }
+USDExporter::_ExportGroup(const pxr::SdfPath parentPath,
+                          const SceneGroup& group,
+                          UniqueNameAllocator& groupNames) {
     std::string groupName;
-    std::string gName = GetGroupName(group);
+    const std::string& gName = group.name;
     bool namedGroup = false;
     // If a group is left with the default name, it is a string that is
     // not empty - it has length 1, and the character is 0, so check for that.
     if (gName.empty() || (gName.length() && (gName[0] == '\0'))) {
         // unnamed group - give it a unique name
-        std::string seed = "GRP_" + std::to_string(usedGroupNames.size());
+        std::string seed = "GRP_" + std::to_string(groupNames.GetCount());
         groupName = pxr::TfMakeValidIdentifier(seed);
     } else {
         groupName = pxr::TfMakeValidIdentifier(gName);
         namedGroup = true;
     }
-    groupName = SafeNameFromExclusionList(groupName, usedGroupNames);
-    SUMaterialRef thisGroupMaterial = SU_INVALID;
-    SUDrawingElementGetMaterial(drawingElement, &thisGroupMaterial);
-    _groupMaterial = thisGroupMaterial;
-
-    SUEntitiesRef group_entities = SU_INVALID;
-    SU_CALL(SUGroupGetEntities(group, &group_entities));
+    groupName = groupNames.Allocate(groupName);
 
     //std::cerr << "appending group " << groupName << " to parentPath" << parentPath << std::endl;
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken(groupName));
-    auto primSchema = pxr::UsdGeomXform::Define(_stage, path);
-    SUTransformation t;
-    SU_CALL(SUGroupGetTransform(group, &t));
-    pxr::GfMatrix4d usdMatrix = usdTransformFromSUTransform(t);
-    primSchema.MakeMatrixXform().Set(usdMatrix);
+    auto prim = _writer.DefinePrim(path, "Xform");
+    _writer.SetTransform(prim, group.transform);
     if (namedGroup) {
-        auto prim = primSchema.GetPrim();
-        prim.SetMetadata(pxr::SdfFieldKeys->Kind,
-                         pxr::KindTokens->group);
-        auto keyPath = pxr::TfToken("SketchUp:name");
-        pxr::VtValue gNameV(gName);
-        prim.SetCustomDataByKey(keyPath, gNameV);
+        prim->SetKind(pxr::KindTokens->group);
+        _writer.SetCustomData(prim, "SketchUp:name", pxr::VtValue(gName));
     }
     // now recursively export all the children, which can contain any
     // valid SketchUp entity.
-    _ExportEntities(path, group_entities);
-    _groupMaterial = SU_INVALID;
+    _ExportEntities(path, *group.entities);
     
     return groupName;
 }
@@ -879,160 +1189,156 @@ USDExporter::_incrementCountForShaderPath(pxr::SdfPath path) {
     _shaderPathsCounts[path] = 1 + _shaderPathsCounts[path];
 }
                                
+pxr::SdfPrimSpecHandle
+USDExporter::_exportShaderPrim(const pxr::SdfPath path,
+                               const std::string& shaderId) {
+    _incrementCountForShaderPath(path);
+    auto shader = _writer.DefinePrim(path, "Shader");
+    _writer.SetAttribute(shader, "info:id", pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::TfToken(shaderId)),
+                         pxr::SdfVariabilityUniform);
+    return shader;
+}
+
+void
+USDExporter::_exportPreviewSurfaceDefaults(const pxr::SdfPrimSpecHandle& shader) {
+    // this is all boilerplate, and we should eventually be able to omit it
+    // for now, omit if we're making ARKit compatible stuff, as it doesn't
+    // need it
+    if (GetExportARKitCompatibleUSDZ()) {
+        return ;
+    }
+    _writer.SetAttribute(shader, "inputs:useSpecularWorkflow",
+                         pxr::SdfValueTypeNames->Int,
+                         pxr::VtValue(0));
+    _writer.SetAttribute(shader, "inputs:specularColor",
+                         pxr::SdfValueTypeNames->Color3f,
+                         pxr::VtValue(pxr::GfVec3f(0, 0, 0)));
+    _writer.SetAttribute(shader, "inputs:clearcoat",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(0.0f));
+    _writer.SetAttribute(shader, "inputs:clearcoatRoughness",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(0.01f));
+    _writer.SetAttribute(shader, "inputs:emissiveColor",
+                         pxr::SdfValueTypeNames->Color3f,
+                         pxr::VtValue(pxr::GfVec3f(0, 0, 0)));
+    _writer.SetAttribute(shader, "inputs:displacement",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(0.0f));
+    _writer.SetAttribute(shader, "inputs:occlusion",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(1.0f));
+    _writer.SetAttribute(shader, "inputs:normal",
+                         pxr::SdfValueTypeNames->Float3,
+                         pxr::VtValue(pxr::GfVec3f(0, 0, 1)));
+    _writer.SetAttribute(shader, "inputs:ior",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(1.5f));
+    _writer.SetAttribute(shader, "inputs:metallic",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(0.0f));
+    _writer.SetAttribute(shader, "inputs:roughness",
+                         pxr::SdfValueTypeNames->Float,
+                         pxr::VtValue(0.8f));
+}
+
 void
 USDExporter::_exportRGBAShader(const pxr::SdfPath path,
-                               pxr::UsdShadeOutput materialSurface,
+                               pxr::SdfAttributeSpecHandle materialSurface,
                                pxr::GfVec3f rgb, float opacity) {
     pxr::SdfPath shaderPath = path.AppendChild(pxr::TfToken("RGBA"));
-    _incrementCountForShaderPath(shaderPath);
-    auto schema = pxr::UsdShadeShader::Define(_stage, shaderPath);
-    schema.CreateIdAttr().Set(pxr::TfToken("UsdPreviewSurface"));
-    auto surfaceOutput = schema.CreateOutput(pxr::TfToken("surface"),
-                                             pxr::SdfValueTypeNames->Token);
-    materialSurface.ConnectToSource(surfaceOutput);
-    schema.CreateInput(pxr::TfToken("opacity"),
-                       pxr::SdfValueTypeNames->Float).Set(opacity);
-    schema.CreateInput(pxr::TfToken("diffuseColor"),
-                       pxr::SdfValueTypeNames->Color3f).Set(rgb);
-    if (!GetExportARKitCompatibleUSDZ()) {
-        // this is all boilerplate, and we should eventually be able to omit it
-        // for now, omit if we're making ARKit compatible stuff, as it doesn't
-        // need it
-        schema.CreateInput(pxr::TfToken("useSpecularWorkflow"),
-                           pxr::SdfValueTypeNames->Int).Set(0);
-        schema.CreateInput(pxr::TfToken("specularColor"),
-                           pxr::SdfValueTypeNames->Color3f).Set(pxr::GfVec3f(0, 0, 0));
-        schema.CreateInput(pxr::TfToken("clearcoat"),
-                           pxr::SdfValueTypeNames->Float).Set(0.0f);
-        schema.CreateInput(pxr::TfToken("clearcoatRoughness"),
-                           pxr::SdfValueTypeNames->Float).Set(0.01f);
-        schema.CreateInput(pxr::TfToken("emissiveColor"),
-                           pxr::SdfValueTypeNames->Color3f).Set(pxr::GfVec3f(0, 0, 0));
-        schema.CreateInput(pxr::TfToken("displacement"),
-                           pxr::SdfValueTypeNames->Float).Set(0.0f);
-        schema.CreateInput(pxr::TfToken("occlusion"),
-                           pxr::SdfValueTypeNames->Float).Set(1.0f);
-        schema.CreateInput(pxr::TfToken("normal"),
-                           pxr::SdfValueTypeNames->Float3).Set(pxr::GfVec3f(0, 0, 1));
-        schema.CreateInput(pxr::TfToken("ior"),
-                           pxr::SdfValueTypeNames->Float).Set(1.5f);
-        schema.CreateInput(pxr::TfToken("metallic"),
-                           pxr::SdfValueTypeNames->Float).Set(0.0f);
-        schema.CreateInput(pxr::TfToken("roughness"),
-                           pxr::SdfValueTypeNames->Float).Set(0.8f);
-    }
+    auto shader = _exportShaderPrim(shaderPath, "UsdPreviewSurface");
+    auto surfaceOutput = _writer.CreateAttribute(shader, "outputs:surface",
+                                                 pxr::SdfValueTypeNames->Token);
+    _writer.SetConnection(materialSurface, surfaceOutput->GetPath());
+    _writer.SetAttribute(shader, "inputs:opacity",
+                         pxr::SdfValueTypeNames->Float, pxr::VtValue(opacity));
+    _writer.SetAttribute(shader, "inputs:diffuseColor",
+                         pxr::SdfValueTypeNames->Color3f, pxr::VtValue(rgb));
+    _exportPreviewSurfaceDefaults(shader);
     return ;
 }
 
-std::pair<pxr::UsdShadeInput, pxr::UsdShadeInput>
+std::pair<pxr::SdfAttributeSpecHandle, pxr::SdfAttributeSpecHandle>
 USDExporter::_exportPreviewShader(const pxr::SdfPath path,
-                                  pxr::UsdShadeOutput materialSurface) {
+                                  pxr::SdfAttributeSpecHandle materialSurface) {
     pxr::SdfPath shaderPath = path.AppendChild(pxr::TfToken("PbrPreview"));
-    _incrementCountForShaderPath(shaderPath);
-    auto schema = pxr::UsdShadeShader::Define(_stage, shaderPath);
-    schema.CreateIdAttr().Set(pxr::TfToken("UsdPreviewSurface"));
-    auto surfaceOutput = schema.CreateOutput(pxr::TfToken("surface"),
-                                             pxr::SdfValueTypeNames->Token);
-    materialSurface.ConnectToSource(surfaceOutput);
-    auto opacity = schema.CreateInput(pxr::TfToken("opacity"),
-                                      pxr::SdfValueTypeNames->Float);
-    auto diffuseColor = schema.CreateInput(pxr::TfToken("diffuseColor"),
-                                           pxr::SdfValueTypeNames->Color3f);
-    if (!GetExportARKitCompatibleUSDZ()) {
-        // this is all boilerplate, and we should eventually be able to omit it
-        // for now, omit if we're making ARKit compatible stuff, as it doesn't
-        // need it
-        schema.CreateInput(pxr::TfToken("useSpecularWorkflow"),
-                           pxr::SdfValueTypeNames->Int).Set(0);
-        schema.CreateInput(pxr::TfToken("specularColor"),
-                           pxr::SdfValueTypeNames->Color3f).Set(pxr::GfVec3f(0, 0, 0));
-        schema.CreateInput(pxr::TfToken("clearcoat"),
-                           pxr::SdfValueTypeNames->Float).Set(0.0f);
-        schema.CreateInput(pxr::TfToken("clearcoatRoughness"),
-                           pxr::SdfValueTypeNames->Float).Set(0.01f);
-        schema.CreateInput(pxr::TfToken("emissiveColor"),
-                           pxr::SdfValueTypeNames->Color3f).Set(pxr::GfVec3f(0, 0, 0));
-        schema.CreateInput(pxr::TfToken("displacement"),
-                           pxr::SdfValueTypeNames->Float).Set(0.0f);
-        schema.CreateInput(pxr::TfToken("occlusion"),
-                           pxr::SdfValueTypeNames->Float).Set(1.0f);
-        schema.CreateInput(pxr::TfToken("normal"),
-                           pxr::SdfValueTypeNames->Float3).Set(pxr::GfVec3f(0, 0, 1));
-        schema.CreateInput(pxr::TfToken("ior"),
-                           pxr::SdfValueTypeNames->Float).Set(1.5f);
-        schema.CreateInput(pxr::TfToken("metallic"),
-                           pxr::SdfValueTypeNames->Float).Set(0.0f);
-        schema.CreateInput(pxr::TfToken("roughness"),
-                           pxr::SdfValueTypeNames->Float).Set(0.8f);
-    }
+    auto shader = _exportShaderPrim(shaderPath, "UsdPreviewSurface");
+    auto surfaceOutput = _writer.CreateAttribute(shader, "outputs:surface",
+                                                 pxr::SdfValueTypeNames->Token);
+    _writer.SetConnection(materialSurface, surfaceOutput->GetPath());
+    auto opacity = _writer.CreateAttribute(shader, "inputs:opacity",
+                                           pxr::SdfValueTypeNames->Float);
+    auto diffuseColor = _writer.CreateAttribute(shader, "inputs:diffuseColor",
+                                                pxr::SdfValueTypeNames->Color3f);
+    _exportPreviewSurfaceDefaults(shader);
     return std::make_pair(diffuseColor, opacity);
 }
 
 
-pxr::UsdShadeOutput
+pxr::SdfPath
 USDExporter::_exportSTPrimvarShader(const pxr::SdfPath path) {
     pxr::SdfPath shaderPath = path.AppendChild(pxr::TfToken("PrimvarST"));
-    _incrementCountForShaderPath(shaderPath);
-    auto schema = pxr::UsdShadeShader::Define(_stage, shaderPath);
-    schema.CreateIdAttr().Set(pxr::TfToken("UsdPrimvarReader_float2"));
-    schema.CreateInput(pxr::TfToken("varname"),
-                       pxr::SdfValueTypeNames->Token).Set(pxr::TfToken("st"));
-    return schema.CreateOutput(pxr::TfToken("result"),
-                               pxr::SdfValueTypeNames->Float2);
+    auto shader = _exportShaderPrim(shaderPath, "UsdPrimvarReader_float2");
+    _writer.SetAttribute(shader, "inputs:varname",
+                         pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::TfToken("st")));
+    return _writer.CreateAttribute(shader, "outputs:result",
+                                   pxr::SdfValueTypeNames->Float2)->GetPath();
 }
 
-pxr::UsdShadeOutput
+pxr::SdfPath
 USDExporter::_exportDisplayColorPrimvarShader(const pxr::SdfPath path) {
     pxr::SdfPath shaderPath = path.AppendChild(pxr::TfToken("PrimvarDisplayColor"));
-    _incrementCountForShaderPath(shaderPath);
-    auto schema = pxr::UsdShadeShader::Define(_stage, shaderPath);
-    schema.CreateIdAttr().Set(pxr::TfToken("UsdPrimvarReader_float3"));
-    schema.CreateInput(pxr::TfToken("varname"),
-                       pxr::SdfValueTypeNames->Token).Set(pxr::TfToken("displayColor"));
-    return schema.CreateOutput(pxr::TfToken("result"),
-                               pxr::SdfValueTypeNames->Float3);
+    auto shader = _exportShaderPrim(shaderPath, "UsdPrimvarReader_float3");
+    _writer.SetAttribute(shader, "inputs:varname",
+                         pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::TfToken("displayColor")));
+    return _writer.CreateAttribute(shader, "outputs:result",
+                                   pxr::SdfValueTypeNames->Float3)->GetPath();
 }
 
-pxr::UsdShadeOutput
+pxr::SdfPath
 USDExporter::_exportDisplayOpacityPrimvarShader(const pxr::SdfPath path) {
     pxr::SdfPath shaderPath = path.AppendChild(pxr::TfToken("PrimvarDisplayOpacity"));
-    _incrementCountForShaderPath(shaderPath);
-    auto schema = pxr::UsdShadeShader::Define(_stage, shaderPath);
-    schema.CreateIdAttr().Set(pxr::TfToken("UsdPrimvarReader_float"));
-    schema.CreateInput(pxr::TfToken("varname"),
-                       pxr::SdfValueTypeNames->Token).Set(pxr::TfToken("displayOpacity"));
-    return schema.CreateOutput(pxr::TfToken("result"),
-                               pxr::SdfValueTypeNames->Float);
+    auto shader = _exportShaderPrim(shaderPath, "UsdPrimvarReader_float");
+    _writer.SetAttribute(shader, "inputs:varname",
+                         pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::TfToken("displayOpacity")));
+    return _writer.CreateAttribute(shader, "outputs:result",
+                                   pxr::SdfValueTypeNames->Float)->GetPath();
 }
 
 void
 USDExporter::_exportTextureShader(const pxr::SdfPath path,
                                   std::string texturePath,
-                                  pxr::UsdShadeOutput primvar,
-                                  pxr::UsdShadeInput diffuseColor,
-                                  pxr::UsdShadeInput alpha) {
+                                  pxr::SdfPath primvar,
+                                  pxr::SdfAttributeSpecHandle diffuseColor,
+                                  pxr::SdfAttributeSpecHandle alpha) {
     pxr::SdfPath  shaderPath = path.AppendChild(pxr::TfToken("Texture"));
-    _incrementCountForShaderPath(shaderPath);
-    auto schema = pxr::UsdShadeShader::Define(_stage,  shaderPath);
-    schema.CreateIdAttr().Set(pxr::TfToken("UsdUVTexture"));
-    auto rgb = schema.CreateOutput(pxr::TfToken("rgb"),
-                                   pxr::SdfValueTypeNames->Float3);
-    diffuseColor.ConnectToSource(rgb);
-    auto a = schema.CreateOutput(pxr::TfToken("a"),
-                                 pxr::SdfValueTypeNames->Float);
-    alpha.ConnectToSource(a);
-    
+    auto shader = _exportShaderPrim(shaderPath, "UsdUVTexture");
+    auto rgb = _writer.CreateAttribute(shader, "outputs:rgb",
+                                       pxr::SdfValueTypeNames->Float3);
+    _writer.SetConnection(diffuseColor, rgb->GetPath());
+    auto a = _writer.CreateAttribute(shader, "outputs:a",
+                                     pxr::SdfValueTypeNames->Float);
+    _writer.SetConnection(alpha, a->GetPath());
+
     _filePathsForZip.insert(texturePath);
     pxr::SdfAssetPath relativePath(texturePath);
-    schema.CreateInput(pxr::TfToken("file"),
-                         pxr::SdfValueTypeNames->Asset).Set(relativePath);
-    schema.CreateInput(pxr::TfToken("wrapS"),
-                         pxr::SdfValueTypeNames->Token).Set(pxr::TfToken("repeat"));
-    schema.CreateInput(pxr::TfToken("wrapT"),
-                         pxr::SdfValueTypeNames->Token).Set(pxr::TfToken("repeat"));
-    auto st = schema.CreateInput(pxr::TfToken("st"),
-                                   pxr::SdfValueTypeNames->Float2);
-    st.ConnectToSource(primvar);
+    _writer.SetAttribute(shader, "inputs:file",
+                         pxr::SdfValueTypeNames->Asset,
+                         pxr::VtValue(relativePath));
+    _writer.SetAttribute(shader, "inputs:wrapS",
+                         pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::TfToken("repeat")));
+    _writer.SetAttribute(shader, "inputs:wrapT",
+                         pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::TfToken("repeat")));
+    auto st = _writer.CreateAttribute(shader, "inputs:st",
+                                      pxr::SdfValueTypeNames->Float2);
+    _writer.SetConnection(st, primvar);
 }
 
 #pragma mark Materials:
@@ -1052,13 +1358,18 @@ USDExporter:: _incrementCountForMaterialPath(pxr::SdfPath path) {
     _materialPathsCounts[path] = 1 + _materialPathsCounts[path];
 }
 
+pxr::SdfAttributeSpecHandle
+USDExporter::_exportMaterialPrim(const pxr::SdfPath path) {
+    _incrementCountForMaterialPath(path);
+    auto material = _writer.DefinePrim(path, "Material");
+    return _writer.CreateAttribute(material, "outputs:surface",
+                                   pxr::SdfValueTypeNames->Token);
+}
+
 void
 USDExporter::_ExportTextureMaterial(const pxr::SdfPath path,
                                     std::string texturePath) {
-    _incrementCountForMaterialPath(path);
-    auto mSchema = pxr::UsdShadeMaterial::Define(_stage, path);
-    auto materialSurface = mSchema.CreateOutput(pxr::TfToken("surface"),
-                                                pxr::SdfValueTypeNames->Token);
+    auto materialSurface = _exportMaterialPrim(path);
     auto diffuseColor_opacity = _exportPreviewShader(path, materialSurface);
     auto diffuseColor = diffuseColor_opacity.first;
     auto opacity = diffuseColor_opacity.second;
@@ -1069,33 +1380,27 @@ USDExporter::_ExportTextureMaterial(const pxr::SdfPath path,
 void
 USDExporter::_ExportRGBAMaterial(const pxr::SdfPath path,
                                  pxr::GfVec3f rgb, float opacity) {
-    _incrementCountForMaterialPath(path);
-    auto mSchema = pxr::UsdShadeMaterial::Define(_stage, path);
-    auto materialSurface = mSchema.CreateOutput(pxr::TfToken("surface"),
-                                                pxr::SdfValueTypeNames->Token);
+    auto materialSurface = _exportMaterialPrim(path);
     _exportRGBAShader(path, materialSurface, rgb, opacity);
 }
 
 void
 USDExporter::_ExportDisplayMaterial(const pxr::SdfPath path) {
-    _incrementCountForMaterialPath(path);
-    auto mSchema = pxr::UsdShadeMaterial::Define(_stage, path);
-    auto materialSurface = mSchema.CreateOutput(pxr::TfToken("surface"),
-                                                pxr::SdfValueTypeNames->Token);
+    auto materialSurface = _exportMaterialPrim(path);
     auto diffuseColor_opacity = _exportPreviewShader(path, materialSurface);
 
     auto primvarRGB = _exportDisplayColorPrimvarShader(path);
     auto diffuseColor = diffuseColor_opacity.first;
-    diffuseColor.ConnectToSource(primvarRGB);
+    _writer.SetConnection(diffuseColor, primvarRGB);
 
     auto primvarOpacity = _exportDisplayOpacityPrimvarShader(path);
     auto opacity = diffuseColor_opacity.second;
-    opacity.ConnectToSource(primvarOpacity);
+    _writer.SetConnection(opacity, primvarOpacity);
 }
 
 int
 USDExporter::_cacheTextureMaterial(pxr::SdfPath path, MeshSubset& subset, int index) {
-    std::string textureName = subset.GetMaterialTextureName();
+    const std::string& textureName = subset.GetMaterialTextureName();
     std::string texturePath = _textureDirectory + "/" + textureName;
     if (_texturePathMaterialPath.find(texturePath) == _texturePathMaterialPath.end()) {
         // okay, we have not yet made a material with this texture, so
@@ -1201,7 +1506,7 @@ USDExporter::_ExportMaterials(const pxr::SdfPath parentPath) {
     // texture map at most), we want to coalesce these as much as possible.
     if (_someMaterialsToExport()) {
         pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Materials"));
-        auto primSchema = pxr::UsdGeomScope::Define(_stage, path);
+        _writer.DefinePrim(path, "Scope");
         int displayIndex = 0;
         int textureIndex = 0;
         for (MeshSubset& subset : _meshFrontFaceSubsets) {
@@ -1234,386 +1539,41 @@ USDExporter::_ExportMaterials(const pxr::SdfPath parentPath) {
     return true;
 }
 
-bool
-USDExporter::_bothDisplayColorAreEqual() {
-    if (_frontFaceRGBs.size() != _backFaceRGBs.size()) {
-        //std::cerr << "display color lengths different" << std::endl;
-        return false;
-    }
-    for (int i = 0; i < _frontFaceRGBs.size(); i++) {
-        pxr::GfVec3f frontFaceRGB = _frontFaceRGBs[i];
-        pxr::GfVec3f backFaceRGB = _backFaceRGBs[i];
-        if (frontFaceRGB != backFaceRGB) {
-            //std::cerr << "one of the display color values are different" << std::endl;
-            return false;
-        }
-    }
-    return true;
-}
-
-bool
-USDExporter::_bothDisplayOpacityAreEqual() {
-    if (_frontFaceAs.size() != _backFaceAs.size()) {
-        //std::cerr << "display opacity lengths different" << std::endl;
-        return false;
-    }
-    for (int i = 0; i < _frontFaceAs.size(); i++) {
-        float frontFaceA = _frontFaceAs[i];
-        float backFaceA = _backFaceAs[i];
-        if (frontFaceA != backFaceA) {
-            //std::cerr << "one of the display opacity values are different" << std::endl;
-            return false;
-        }
-    }
-    return true;
-}
-
 #pragma mark Faces:
-bool
-USDExporter::_reallyExportDoubleSided(const pxr::SdfPath parentPath) {
-    if (GetExportDoubleSided()) {
-        return true;
-    }
-    if (_bothDisplayColorAreEqual() && _bothDisplayOpacityAreEqual()) {
-        return true;
-    }
-    //std::cerr << "unable to export " << parentPath << " double-sided" << std::endl;
-    return false;
-}
-
 void
 USDExporter::_ExportFaces(const pxr::SdfPath parentPath,
-                          SUEntitiesRef entities) {
-    size_t num = 0;
-    SU_CALL(SUEntitiesGetNumFaces(entities, &num));
-    if (!num) {
-        return;
+                          const SceneMesh& mesh) {
+    const MeshBuffers* buffers = _meshBuilder.GetMeshBuffers(&mesh);
+    if (!buffers) {
+        std::cerr << "ERROR: no mesh was built for " << parentPath << std::endl;
+        return ;
     }
     _clearFacesExport();
-    std::vector<SUFaceRef> faces(num);
-    SU_CALL(SUEntitiesGetFaces(entities, num, &faces[0], &num));
-    size_t exportedFaceCount = 0;
     // if there is more than one face, we need to use the UsdGeomSubset API
     // to specify the materials.
     // if we bisect a quad in both ways, we have 4 faces, but then each of these
     // faces generates two triangles, each of which is a separate face to USD
     // Note that as of USD 18.09 Hydra does not currently render GeomSubsets,
     // but SceneKit on iOS 12 and macOS Mojave does.
-    // If all of the faces of a given mesh are used in a subset, there's no reason
-    // to subset it, right?
-    // wave: come back here
-    for (size_t i = 0; i < num; i++) {
-        pxr::VtArray<int> currentFaceIndices;
-        size_t faceCount = _gatherFaceInfo(parentPath, faces[i]);
-        for (size_t i = 0; i < faceCount; i++) {
-            int index = (int)(i + exportedFaceCount);
-            currentFaceIndices.push_back(index);
-        }
-        exportedFaceCount += faceCount;
-        if (GetExportMaterials()) {
-            // only make a mesh subset if we found a color or texture
-            if (_foundAFrontColor || _foundAFrontTexture) {
-                pxr::GfVec3f rgb(_frontRGBA[0], _frontRGBA[1], _frontRGBA[2]);
-                float opacity = _frontRGBA[3];
-                MeshSubset frontSubset(_frontFaceTextureName, rgb, opacity,
-                                       currentFaceIndices);
-                _meshFrontFaceSubsets.push_back(frontSubset);
-            }
-            if (_foundABackColor || _foundABackTexture) {
-                pxr::GfVec3f rgb = pxr::GfVec3f(_backRGBA[0], _backRGBA[1], _backRGBA[2]);
-                float opacity = _backRGBA[3];
-                MeshSubset backSubset(_backFaceTextureName, rgb, opacity,
-                                      currentFaceIndices);
-                _meshBackFaceSubsets.push_back(backSubset);
-            }
-        }
-    }
-    if (exportedFaceCount) {
-        _ExportMaterials(parentPath);
-        if (_reallyExportDoubleSided(parentPath)) {
-            _ExportDoubleSidedMesh(parentPath);
-        } else {
-            _ExportMeshes(parentPath);
-        }
-    }
-}
-
-size_t
-USDExporter::_gatherFaceInfo(const pxr::SdfPath parentPath, SUFaceRef face) {
-    SUDrawingElementRef drawingElement = SUFaceToDrawingElement(face);
-    if (SUIsValid(drawingElement)) {
-        bool isHidden = 0;
-        SUDrawingElementGetHidden(drawingElement, &isHidden);
-        if (isHidden) {
-            return 0;
-        }
-        // need to find out what layer it's on, and make sure that layer
-        // is visible
-        SULayerRef layer;
-        SU_CALL(SUDrawingElementGetLayer(drawingElement, &layer));
-        bool visible = true;
-        SU_CALL(SULayerGetVisibility(layer, &visible));
-        if (!visible) {
-            //std::cerr << cName << " is on a hidden layer - skipping" << std::endl;
-            return 0;
-        }
-    }
-    return _addFaceAsTexturedTriangles(parentPath, face);
-}
-
-std::string
-USDExporter::_textureFileName(SUTextureRef textureRef) {
-    SUStringRef fileName;
-    SUSetInvalid(fileName);
-    SUStringCreate(&fileName);
-    SUTextureGetFileName(textureRef, &fileName);
-    size_t length;
-    SUStringGetUTF8Length(fileName, &length);
-    std::string string;
-    string.resize(length);
-    size_t returned_length;
-    SUStringGetUTF8(fileName, length, &string[0], &returned_length);
-    // this might be some windows name that has directory info in it
-    // when we wrote it out, we ignored the path info, so we should ignore
-    // it here as well. The Tf code will deal with this on Windows, but on the
-    // Mac, it doesn't, so we'll need an additional check.
-    std::string baseName = pxr::TfGetBaseName(string);
-    if (pxr::TfGetPathName(string) == "") {
-        // make sure it's not got a windows path embedded in there, like:
-        // C:\Users\Owner\Pictures\Other\Textures for Google Sketchup\norway_maple_tree.jpg
-        const std::string::size_type i = string.find_last_of("\\/");
-        if (string.size() > i) {
-            baseName = string.substr(i+1, string.size());
-        }
-    }
-    // TODO: this is a bad hack. Need to revisit it soon...
-    // we really should check for the existence of this file here, but I'm
-    // not currently sure how to do that in a arch independent way. What I do
-    // know is that sometimes SketchUp takes a "BMP" extension file and silently
-    // converts it to a "png" (i.e. on disk), so for now, we will at least make
-    // that change here:
-    std::regex replaceExpr(".BMP|.bmp|.TGA|.tga");
-    std::string newBaseName = std::regex_replace(baseName, replaceExpr, ".png");
-    return newBaseName;
-}
-
-// In SketchUp, a face can have:
-// - no material (so we use a default color based on if it's front or back)
-// - material containing a color and NO texture
-// - material containing NO color and A texture
-// - material containing A solid color and A texture
-// so we're guaranteed to have a color, but not a texture
-// we return a bool that corresponds to if we've changed from the default
-bool
-USDExporter::_addFrontFaceMaterial(SUFaceRef face) {
-    SUMaterialRef material = SU_INVALID;
-    SUFaceGetFrontMaterial(face, &material);
-    if SUIsInvalid(material) {
-        if (!SUIsInvalid(_groupMaterial)) {
-            //std::cerr << "no front material, using group material" << std::endl;
-            material = _groupMaterial;
-        } else {
-            return false;
-        }
-    }
-    _frontRGBA = defaultFrontFaceRGBA;
-    SUColor color;
-    SU_RESULT result = SUMaterialGetColor(material, &color);
-    if (result == SU_ERROR_NONE) {
-        _frontRGBA[0] = ((int)color.red)/255.0;
-        _frontRGBA[1] = ((int)color.green)/255.0;
-        _frontRGBA[2] = ((int)color.blue)/255.0;
-        _frontRGBA[3] = ((int)color.alpha)/255.0;
-        _foundAFrontColor = true;
-    }
-    SUTextureRef textureRef = SU_INVALID;
-    if (SU_ERROR_NONE == SUMaterialGetTexture(material, &textureRef)) {
-        _frontFaceTextureName = _textureFileName(textureRef);
-        _foundAFrontTexture = true;
-    } else {
-        _frontFaceTextureName.clear();
-    }
-    return true;
-}
-
-bool
-USDExporter::_addBackFaceMaterial(SUFaceRef face) {
-    SUMaterialRef material = SU_INVALID;
-    SUFaceGetBackMaterial(face, &material);
-    if SUIsInvalid(material) {
-        if (!SUIsInvalid(_groupMaterial)) {
-            //std::cerr << "no back material, using group material" << std::endl;
-            material = _groupMaterial;
-        } else {
-            return false;
-        }
-    }
-    _backRGBA = defaultBackFaceRGBA;
-    SUColor color;
-    SU_RESULT result = SUMaterialGetColor(material, &color);
-    if (result == SU_ERROR_NONE) {
-        _backRGBA[0] = ((int)color.red)/255.0;
-        _backRGBA[1] = ((int)color.green)/255.0;
-        _backRGBA[2] = ((int)color.blue)/255.0;
-        _backRGBA[3] = ((int)color.alpha)/255.0;
-        _foundABackColor = true;
-    }
-    SUTextureRef textureRef = SU_INVALID;
-    if (SU_ERROR_NONE == SUMaterialGetTexture(material, &textureRef)) {
-        _backFaceTextureName = _textureFileName(textureRef);
-        _foundABackColor = true;
+    _meshFrontFaceSubsets = buffers->frontSubsets;
+    const MeshBuffers* backBuffers = _backSideBuffers(*buffers);
+    if (backBuffers) {
+        _meshBackFaceSubsets = backBuffers->backSubsets;
+    }
+    const bool exportedMaterials = _ExportMaterials(parentPath);
+    if (GetSplitMeshesByMaterial() && exportedMaterials) {
+        _ExportSplitMeshes(parentPath, *buffers);
+    } else if (buffers->doubleSided) {
+        _ExportDoubleSidedMesh(parentPath, *buffers);
     } else {
-        _backFaceTextureName.clear();
+        _ExportMeshes(parentPath, *buffers);
     }
-    return true;
-}
-
-size_t
-USDExporter::_addFaceAsTexturedTriangles(const pxr::SdfPath parentPath, SUFaceRef face) {
-    if (SUIsInvalid(face)) {
-        return 0;
-    }
-    // let's cache our material info - if we have a non-default color & texture
-    /*bool foundFrontFaceMaterial = */ _addFrontFaceMaterial(face);
-    /*bool foundBackFaceMaterial = */ _addBackFaceMaterial(face);
-    // Create a triangulated mesh from face.
-    SUMeshHelperRef mesh_ref = SU_INVALID;
-    SU_CALL(SUMeshHelperCreateWithTextureWriter(&mesh_ref, face,
-                                                _textureWriter));
-    size_t num_vertices = 0;
-    SU_CALL(SUMeshHelperGetNumVertices(mesh_ref, &num_vertices));
-    if (!num_vertices) {
-        // free all the memory we allocated here via the SU API
-        SU_CALL(SUMeshHelperRelease(&mesh_ref));
-        return num_vertices;
-    }
-    /*
-    if (!foundFrontFaceMaterial) {
-        std::cerr << "didn't find a front material at " << parentPath;
-        std::cerr << " but we have a mesh with " << num_vertices;
-        std::cerr << " vertices" << std::endl;
-    }
-    if (!foundBackFaceMaterial) {
-        std::cerr << "didn't find a back material at " << parentPath;
-        std::cerr << " but we have a mesh with " << num_vertices;
-        std::cerr << " vertices" << std::endl;
-    }
-    */
-    std::vector<SUPoint3D> vertices(num_vertices);
-    SU_CALL(SUMeshHelperGetVertices(mesh_ref, num_vertices,
-                                    &vertices[0], &num_vertices));
-    
-    size_t actual;
-    std::vector<SUVector3D> normals(num_vertices);
-    SU_CALL(SUMeshHelperGetNormals(mesh_ref, num_vertices,
-                                   &normals[0], &actual));
-
-    std::vector<SUPoint3D> front_stq(num_vertices);
-    SU_CALL(SUMeshHelperGetFrontSTQCoords(mesh_ref, num_vertices,
-                                          &front_stq[0], &actual));
-
-    std::vector<SUPoint3D> back_stq(num_vertices);
-    SU_CALL(SUMeshHelperGetBackSTQCoords(mesh_ref, num_vertices,
-                                         &back_stq[0], &actual));
-
-    for (size_t i = 0; i < num_vertices; i++) {
-        SUPoint3D pt = vertices[i];
-        // note: SketchUp uses inches. Pretty much every other DCC out
-        // there uses metric units, and most use cm. Because of that,
-        // I'm going to export to cm. Note we'll need to modify the
-        // translate component of the objects' 4x4 and the camera's 4x4
-        pxr::GfVec3f vertex(inchesToCM * pt.x,
-                            inchesToCM * pt.y,
-                            inchesToCM * pt.z);
-        _points.push_back(vertex);
-
-        SUVector3D nv = normals[i];
-        pxr::GfVec3f vertexNormal(nv.x, nv.y, nv.z);
-        _vertexNormals.push_back(vertexNormal);
-        pxr::GfVec3f vertexFlippedNormal(-1.0 * nv.x, -1.0 * nv.y, -1.0 * nv.z);
-        _vertexFlippedNormals.push_back(vertexFlippedNormal);
-        
-        pxr::GfVec2f uvFront(front_stq[i].x, front_stq[i].y);
-        _frontUVs.push_back(uvFront);
-        pxr::GfVec2f uvBack(back_stq[i].x, back_stq[i].y);
-        _backUVs.push_back(uvBack);
-    }
-    size_t num_triangles = 0;
-    SU_CALL(SUMeshHelperGetNumTriangles(mesh_ref, &num_triangles));
-    // for tracking purposes:
-    if (_currentDataPoint) {
-        auto count = _currentDataPoint->GetOriginalFacesCount();
-        _currentDataPoint->SetOriginalFacesCount(1 + count);
-        count = _currentDataPoint->GetTrianglesCount();
-        _currentDataPoint->SetTrianglesCount(1 + count);
-    } else {
-        _originalFacesCount++;
-        _trianglesCount += num_triangles;
-    }
-    const size_t num_indices = 3 * num_triangles;
-    size_t num_retrieved = 0;
-    std::vector<size_t> indices(num_indices);
-    SU_CALL(SUMeshHelperGetVertexIndices(mesh_ref, num_indices,
-                                         &indices[0], &num_retrieved));
-    int indexOrigin = _currentVertexIndex;
-    pxr::GfVec3f frontRGB(_frontRGBA[0], _frontRGBA[1], _frontRGBA[2]);
-    float frontA = _frontRGBA[3];
-    pxr::GfVec3f backRGB(_backRGBA[0], _backRGBA[1], _backRGBA[2]);
-    float backA = _backRGBA[3];
-    pxr::VtArray<int> submeshIndices;
-    for (size_t i = 0; i < num_triangles; i++) {
-        size_t index = i * 3;
-        _faceVertexCounts.push_back(3); // Three vertices per triangle
-        
-        size_t localIndex = indices[index++];
-        int meshIndex = int(indexOrigin + localIndex);
-        submeshIndices.push_back(meshIndex);
-        _flattenedFaceVertexIndices.push_back(meshIndex);
-        localIndex = indices[index++];
-        meshIndex = int(indexOrigin + localIndex);
-        submeshIndices.push_back(meshIndex);
-        _flattenedFaceVertexIndices.push_back(meshIndex);
-        localIndex = indices[index++];
-        meshIndex = int(indexOrigin + localIndex);
-        submeshIndices.push_back(meshIndex);
-        _flattenedFaceVertexIndices.push_back(meshIndex);
-        // we have a front & back RGBA for each triangle, from the original face
-        _frontFaceRGBs.push_back(frontRGB);
-        _frontFaceAs.push_back(frontA);
-        _backFaceRGBs.push_back(backRGB);
-        _backFaceAs.push_back(backA);
-    }
-    _currentVertexIndex += num_vertices;
-    // free all the memory we allocated here via the SU API
-    SU_CALL(SUMeshHelperRelease(&mesh_ref));
-    return num_triangles;
+    _clearFacesExport(); // free the info
 }
 
 #pragma mark Meshes:
 void
 USDExporter::_clearFacesExport() {
-    _points.clear();
-    _vertexNormals.clear();
-    _vertexFlippedNormals.clear();
-    _frontFaceTextureName.clear();
-    _frontFaceTextureName.clear();
-    _backUVs.clear();
-    _frontUVs.clear();
-    for (int i = 0; i < 4; i++) {
-        _frontRGBA[i] = -1.0;
-        _backRGBA[i] = -1.0;
-    }
-    _foundAFrontColor = false;
-    _foundABackColor = false;
-    _foundAFrontTexture = false;
-    _foundABackTexture = false;
-    _frontFaceRGBs.clear();
-    _frontFaceAs.clear();
-    _backFaceRGBs.clear();
-    _backFaceAs.clear();
-    _faceVertexCounts.clear();
-    _flattenedFaceVertexIndices.clear();
-    _currentVertexIndex = 0;
     _meshFrontFaceSubsets.clear();
     _meshBackFaceSubsets.clear();
     _texturePathMaterialPath.clear();
@@ -1622,102 +1582,130 @@ USDExporter::_clearFacesExport() {
 
 void
 USDExporter::_coalesceAllGeomSubsets() {
-    _meshFrontFaceSubsets = _coalesceGeomSubsets(_meshFrontFaceSubsets);
-    _meshBackFaceSubsets = _coalesceGeomSubsets(_meshBackFaceSubsets);
-}
-
-std::vector<MeshSubset>
-USDExporter::_coalesceGeomSubsets(std::vector<MeshSubset> originalSubsets) {
-    std::vector<MeshSubset> newSubsets;
-    std::map<pxr::SdfPath, std::vector<MeshSubset>> pathSubsets;
-    for (MeshSubset& subset : originalSubsets) {
-        pxr::SdfPath path = subset.GetMaterialPath();
-        if (pathSubsets.find(path) == pathSubsets.end()) {
-            std::vector<MeshSubset> list;
-            list.push_back(subset);
-            pathSubsets[path] = list;
+    _coalesceGeomSubsets(_meshFrontFaceSubsets);
+    _coalesceGeomSubsets(_meshBackFaceSubsets);
+}
+
+// Every subset bound to the same material is folded into the first one of
+// them, in place, so the subsets keep the order they first appear in. The
+// texture name and color are the first one's.
+void
+USDExporter::_coalesceGeomSubsets(std::vector<MeshSubset>& subsets) {
+    std::unordered_map<pxr::SdfPath, size_t, pxr::SdfPath::Hash> groups;
+    groups.reserve(subsets.size());
+    size_t numGroups = 0;
+    for (size_t i = 0; i < subsets.size(); i++) {
+        auto inserted = groups.insert(
+            std::make_pair(subsets[i].GetMaterialPath(), numGroups));
+        if (inserted.second) {
+            if (i != numGroups) {
+                subsets[numGroups] = std::move(subsets[i]);
+            }
+            numGroups++;
         } else {
-            std::vector<MeshSubset>& list = pathSubsets[path];
-            list.push_back(subset);
+            subsets[inserted.first->second].AppendFaceIndices(
+                subsets[i].GetFaceIndices());
         }
     }
-    for (std::map<pxr::SdfPath, std::vector<MeshSubset>>::iterator it=pathSubsets.begin(); it!=pathSubsets.end(); ++it) {
-        pxr::SdfPath path = it->first;
-        std::vector<MeshSubset> list = it->second;
-        pxr::VtArray<int> faceIndices;
-        for (MeshSubset& subset : list) {
-            pxr::VtArray<int> theseIndices = subset.GetFaceIndices();
-            size_t faceSize = faceIndices.size();
-            faceIndices.resize(faceIndices.size() + theseIndices.size());
-            std::copy(theseIndices.begin(), theseIndices.end(), faceIndices.begin() + faceSize);
-        }
-        MeshSubset& firstSubset = list[0];
-        std::string textureName = firstSubset.GetMaterialTextureName();
-        pxr::GfVec3f rgb = firstSubset.GetRGB();
-        float opacity = firstSubset.GetOpacity();
-        MeshSubset coalescedSubset = MeshSubset(textureName, rgb, opacity, faceIndices);
-        coalescedSubset.SetMaterialPath(path);
-        newSubsets.push_back(coalescedSubset);
+    subsets.erase(subsets.begin() + numGroups, subsets.end());
+}
+
+// The per face colors come as a palette and an index per face. If the faces
+// all use the same entry, that goes out as a constant primvar, otherwise the
+// palette and indices go out as an indexed uniform one.
+template <typename T>
+static void
+_writeFacePrimvar(USDLayerWriter& writer, const pxr::SdfPrimSpecHandle& mesh,
+                  const std::string& name,
+                  const pxr::SdfValueTypeName& typeName,
+                  const pxr::VtArray<T>& palette,
+                  const pxr::VtArray<int>& indices) {
+    if (palette.empty() || indices.empty()) {
+        return ;
+    }
+    const int* begin = indices.cdata();
+    const int* end = begin + indices.size();
+    if (std::adjacent_find(begin, end, std::not_equal_to<int>()) == end) {
+        pxr::VtArray<T> value(1, palette[*begin]);
+        writer.SetPrimvar(mesh, name, typeName, pxr::VtValue(value),
+                          pxr::UsdGeomTokens->constant);
+        return ;
     }
-    return newSubsets;
+    writer.SetIndexedPrimvar(mesh, name, typeName, pxr::VtValue(palette),
+                             indices, pxr::UsdGeomTokens->uniform);
 }
 
+// what the two sides of a mesh have in common
 void
+USDExporter::_exportMeshTopology(const pxr::SdfPrimSpecHandle& mesh,
+                                 const MeshBuffers& buffers) {
+    _writer.SetAttribute(mesh, "extent", pxr::SdfValueTypeNames->Float3Array,
+                         pxr::VtValue(buffers.extent));
+    _writer.SetAttribute(mesh, "subdivisionScheme",
+                         pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::UsdGeomTokens->none),
+                         pxr::SdfVariabilityUniform);
+    _writer.SetAttribute(mesh, "points", pxr::SdfValueTypeNames->Point3fArray,
+                         pxr::VtValue(buffers.points));
+    _writer.SetAttribute(mesh, "faceVertexCounts",
+                         pxr::SdfValueTypeNames->IntArray,
+                         pxr::VtValue(buffers.faceVertexCounts));
+    _writer.SetAttribute(mesh, "faceVertexIndices",
+                         pxr::SdfValueTypeNames->IntArray,
+                         pxr::VtValue(buffers.faceVertexIndices));
+}
+
+pxr::SdfPrimSpecHandle
 USDExporter::_exportMesh(pxr::SdfPath path,
-                         std::vector<MeshSubset> meshSubsets,
+                         const MeshBuffers& buffers,
+                         const std::vector<MeshSubset>& meshSubsets,
                          pxr::TfToken const orientation,
-                         pxr::VtArray<pxr::GfVec3f>& rgb,
-                         pxr::VtArray<float>& a,
-                         pxr::VtArray<pxr::GfVec2f>& uv,
-                         pxr::VtArray<pxr::GfVec3f>& extent,
-                         bool flipNormals, bool doubleSided, bool colorsSet) {
-
-    if (_currentDataPoint) {
-        auto count = _currentDataPoint->GetMeshesCount();
-        count++;
-        _currentDataPoint->SetMeshesCount(count);
+                         const pxr::VtArray<pxr::GfVec3f>& rgb,
+                         const pxr::VtArray<int>& rgbIndices,
+                         const pxr::VtArray<float>& a,
+                         const pxr::VtArray<int>& aIndices,
+                         const pxr::VtArray<pxr::GfVec2f>& uv,
+                         bool flipNormals, bool doubleSided, bool colorsSet,
+                         const pxr::SdfPath& topologyPath) {
+    auto mesh = _writer.DefinePrim(path, "Mesh");
+    if (topologyPath.IsEmpty()) {
+        _exportMeshTopology(mesh, buffers);
     } else {
-        _meshesCount++;
-    }
-    auto primSchema = pxr::UsdGeomMesh::Define(_stage, path);
-    primSchema.CreateExtentAttr().Set(extent);
-    primSchema.CreateSubdivisionSchemeAttr().Set(pxr::UsdGeomTokens->none);
-    primSchema.CreateOrientationAttr().Set(orientation);
-    primSchema.CreateDoubleSidedAttr().Set(doubleSided);
-    primSchema.CreatePointsAttr().Set(_points);
+        _writer.AddInherit(mesh, topologyPath);
+    }
+    _writer.SetAttribute(mesh, "orientation", pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(orientation), pxr::SdfVariabilityUniform);
+    _writer.SetAttribute(mesh, "doubleSided", pxr::SdfValueTypeNames->Bool,
+                         pxr::VtValue(doubleSided), pxr::SdfVariabilityUniform);
     if (GetExportNormals()) {
-        if (_points.size() != _vertexNormals.size()) {
+        if (buffers.points.size() != buffers.normals.size()) {
             // What's the right TF_XXX call to log this?
-            std::cerr << "we have " << _points.size() << " points" << std::endl;
-            std::cerr << "BUT we have " << _vertexNormals.size()
+            std::cerr << "we have " << buffers.points.size() << " points" << std::endl;
+            std::cerr << "BUT we have " << buffers.normals.size()
             << " normals" << std::endl;
         } else {
-            primSchema.SetNormalsInterpolation(pxr::UsdGeomTokens->vertex);
-            if (flipNormals) {
-                primSchema.CreateNormalsAttr().Set(_vertexNormals);
-            } else {
-                primSchema.CreateNormalsAttr().Set(_vertexFlippedNormals);
-            }
+            pxr::VtValue normals(flipNormals ? buffers.normals
+                                             : buffers.flippedNormals);
+            auto normalsAttr = _writer.SetAttribute(mesh, "normals",
+                                                    pxr::SdfValueTypeNames->Normal3fArray,
+                                                    normals);
+            _writer.SetInterpolation(normalsAttr, pxr::UsdGeomTokens->vertex);
         }
     }
-    primSchema.CreateFaceVertexCountsAttr().Set(_faceVertexCounts);
-    primSchema.CreateFaceVertexIndicesAttr().Set(_flattenedFaceVertexIndices);
     // if the colors were never set, don't put them out
     if (colorsSet) {
-        auto displayColorPrimvar = primSchema.CreateDisplayColorPrimvar();
-        displayColorPrimvar.Set(rgb);
-        displayColorPrimvar.SetInterpolation(pxr::UsdGeomTokens->uniform);
-        auto alphaPrimvar = primSchema.CreateDisplayOpacityPrimvar();
-        alphaPrimvar.Set(a);
-        alphaPrimvar.SetInterpolation(pxr::UsdGeomTokens->uniform);
-    }
-    auto uvPrimvar = primSchema.CreatePrimvar(pxr::TfToken("st"),
-                                              pxr::SdfValueTypeNames->Float2Array,
-                                              pxr::UsdGeomTokens->vertex);
-    uvPrimvar.Set(uv);
+        _writeFacePrimvar(_writer, mesh, "displayColor",
+                          pxr::SdfValueTypeNames->Color3fArray,
+                          rgb, rgbIndices);
+        _writeFacePrimvar(_writer, mesh, "displayOpacity",
+                          pxr::SdfValueTypeNames->FloatArray,
+                          a, aIndices);
+    }
+    _writer.SetPrimvar(mesh, "st", pxr::SdfValueTypeNames->Float2Array,
+                       pxr::VtValue(uv), pxr::UsdGeomTokens->vertex);
     if (!GetExportMaterials()) {
         // not exporting materials - we're done
-        return ;
+        return mesh;
     }
     // we should first bind a "default material" to this mesh that will map
     // its displayColor and displayOpacity to it. Ideally, that shader would
@@ -1732,69 +1720,50 @@ USDExporter::_exportMesh(pxr::SdfPath path,
     // mesh and bind each material to the appropriate set of indices
     // note: even if there is only one, we need to use the geom subset stuff,
     // because the material might be only on a subset of the faces of this mesh.
-    pxr::TfToken relName = pxr::UsdShadeTokens->materialBinding;
-    pxr::TfToken bindName = pxr::UsdShadeTokens->materialBind;
-    std::string subsetBaseName = "SubsetForMaterial";
-    int index = 0;
-    
-    bool needWorkaround = true; // needed as of USD release 18.09
-    if (meshSubsets.size() < 500) {
-        // if we have less than 500 (pretty arbitrary), this will be performant
-        needWorkaround = false;
-    }
-    if (needWorkaround) {
-        // this is a workaround for the fact that currently, if I have to
-        // create a lot (say, 1,000s or more) subsets, it can run very
-        // slowly in Usd.  So we break it up into two parts - the first
-        // we use the Sdf API to declare the GeomSubset, and then we assign
-        // it later on, avoiding the slowdown, but is clearly a short term hack.
-        {
-            pxr::SdfChangeBlock block;
-            auto l = _stage->GetRootLayer();
-            pxr::SdfPrimSpecHandle prim = l->GetPrimAtPath(path);
-            for (MeshSubset& meshSubset : meshSubsets) {
-                (void)meshSubset; // to silence the unused variable warning
-                std::string subsetName = subsetBaseName;
-                if (index != 0) {
-                    subsetName += "_" + std::to_string(index);
-                }
-                index++;
-                pxr::SdfPrimSpec::New(prim,
-                                      subsetName,
-                                      pxr::SdfSpecifierDef,
-                                      "GeomSubset");
-            }
-        }
+    // All the subsets go out in one batch, so this costs the same per
+    // subset whether there is one or many thousands of them.
+    std::vector<pxr::VtArray<int>> faceIndices;
+    pxr::SdfPathVector materialPaths;
+    faceIndices.reserve(meshSubsets.size());
+    materialPaths.reserve(meshSubsets.size());
+    for (const MeshSubset& meshSubset : meshSubsets) {
+        faceIndices.push_back(meshSubset.GetFaceIndices());
+        materialPaths.push_back(meshSubset.GetMaterialPath());
     }
-    index = 0;
-    for (MeshSubset& meshSubset : meshSubsets) {
-        if (_currentDataPoint) {
-            auto count = _currentDataPoint->GetGeomSubsetsCount();
-            _currentDataPoint->SetGeomSubsetsCount(1 + count);
-        } else {
-            _geomSubsetsCount++;
-        }
-        std::string subsetName = subsetBaseName;
-        if (index != 0) {
-            subsetName += "_" + std::to_string(index);
-        }
-        index++;
-        pxr::SdfPath subsetPath = path.AppendChild(pxr::TfToken(subsetName));
-        auto subset = pxr::UsdGeomSubset::CreateGeomSubset(primSchema,
-                                                           pxr::TfToken(subsetName),
-                                                           pxr::UsdGeomTokens->face,
-                                                           meshSubset.GetFaceIndices(),
-                                                           bindName,
-                                                           pxr::UsdGeomTokens->nonOverlapping);
-        pxr::UsdPrim prim = subset.GetPrim();
-        pxr::SdfPath materialPath = meshSubset.GetMaterialPath();
-        prim.CreateRelationship(relName).AddTarget(materialPath);
+    if (_currentDataPoint) {
+        auto count = _currentDataPoint->GetGeomSubsetsCount();
+        _currentDataPoint->SetGeomSubsetsCount(count + meshSubsets.size());
+    } else {
+        _geomSubsetsCount += meshSubsets.size();
     }
-    return ;
+    _writer.WriteFaceSubsets(mesh, "SubsetForMaterial",
+                             pxr::UsdShadeTokens->materialBind,
+                             pxr::UsdGeomTokens->nonOverlapping,
+                             faceIndices, materialPaths);
+    return mesh;
+}
+
+// Where the BackSide mesh comes from, or NULL if the back side of every
+// polygon is hidden inside a closed shell. With double-sided meshes, where
+// the back is the front, it's always the mesh itself.
+const MeshBuffers*
+USDExporter::_backSideBuffers(const MeshBuffers& buffers) const {
+    if (!buffers.closedFacesCount || buffers.doubleSided) {
+        return &buffers;
+    }
+    return buffers.openBackSide.get();
+}
+
+// true if nothing can see the back side of the mesh, so it doesn't need to
+// be double-sided
+static bool
+_isClosed(const MeshBuffers& buffers) {
+    return buffers.closedFacesCount == buffers.faceVertexCounts.size();
 }
 
 void
-USDExporter::_ExportMeshes(const pxr::SdfPath parentPath) {
+USDExporter::_ExportMeshes(const pxr::SdfPath parentPath,
+                           const MeshBuffers& buffers) {
     // In SketchUp, each face has two distinct sides. USD can have double-sided
     // geometry, but both sides would have the same material assignment.
     // Therefore, we write out two meshes for each face, each with the
@@ -1802,314 +1771,231 @@ USDExporter::_ExportMeshes(const pxr::SdfPath parentPath) {
     // We also mark the front mesh as rightHanded, and the back mesh
     // as left handed, which will allow the normals to be treated correctly.
     // Note that if we wrote out explicit normals, we flip them for the back
-    pxr::VtArray<pxr::GfVec3f> extent(2);
-    pxr::UsdGeomPointBased::ComputeExtent(_points, &extent);
-    const pxr::TfToken materials("Materials");
-    pxr::SdfPath materialsPath = parentPath.AppendChild(materials);
-    
     _coalesceAllGeomSubsets();
+    // When we share the topology, it's written once to a class that both
+    // sides inherit, and they only add what is different about them.
+    pxr::SdfPath topologyPath;
+    if (GetShareMeshTopology()) {
+        topologyPath = parentPath.AppendChild(pxr::TfToken(sideTopology));
+        auto topology = _writer.DefineClass(topologyPath, "Mesh");
+        _exportMeshTopology(topology, buffers);
+    }
     bool doubleSided = false;
     bool flipNormals = false;
-    bool foundColors = _foundAFrontColor;
+    bool foundColors = buffers.foundAFrontColor;
     pxr::SdfPath frontPath = parentPath.AppendChild(pxr::TfToken(frontSide));
-    _exportMesh(frontPath, _meshFrontFaceSubsets,
+    _exportMesh(frontPath, buffers, _meshFrontFaceSubsets,
                 pxr::UsdGeomTokens->rightHanded,
-                _frontFaceRGBs, _frontFaceAs, _frontUVs, extent,
-                flipNormals, doubleSided, foundColors);
-
+                buffers.frontRGBs, buffers.frontRGBIndices,
+                buffers.frontAs, buffers.frontAIndices, buffers.frontUVs,
+                flipNormals, doubleSided, foundColors, topologyPath);
+
+    // the back sides of closed shells are left out, so what's left of the
+    // BackSide only shares its topology if nothing was
+    const MeshBuffers* back = _backSideBuffers(buffers);
+    if (!back) {
+        return ;
+    }
+    if (back != &buffers) {
+        topologyPath = pxr::SdfPath();
+    }
     flipNormals = true;
-    foundColors = _foundABackColor;
+    foundColors = back->foundABackColor;
     pxr::SdfPath backPath = parentPath.AppendChild(pxr::TfToken(backSide));
-    _exportMesh(backPath, _meshBackFaceSubsets,
+    _exportMesh(backPath, *back, _meshBackFaceSubsets,
                 pxr::UsdGeomTokens->leftHanded,
-                _backFaceRGBs, _backFaceAs, _backUVs, extent,
-                flipNormals, doubleSided, foundColors);
-    _clearFacesExport(); // free the info
+                back->backRGBs, back->backRGBIndices,
+                back->backAs, back->backAIndices, back->backUVs,
+                flipNormals, doubleSided, foundColors, topologyPath);
 }
 
 void
-USDExporter::_ExportDoubleSidedMesh(const pxr::SdfPath parentPath) {
+USDExporter::_ExportDoubleSidedMesh(const pxr::SdfPath parentPath,
+                                    const MeshBuffers& buffers) {
     // In SketchUp, each face has two distinct sides, each of which could have
     // its own material. But in the case where the mesh doesn't have a material
     // assigned on either side or where the material assignments are the same,
     // it makes sense to put out the mesh once and just mark it as double-sided.
     // We also might have a situation where we don't see the backside, so
     // omitting it will save space.
-    pxr::VtArray<pxr::GfVec3f> extent(2);
-    pxr::UsdGeomPointBased::ComputeExtent(_points, &extent);
-    
-    const pxr::TfToken materials("Materials");
-    pxr::SdfPath materialsPath = parentPath.AppendChild(materials);
-    
     _coalesceAllGeomSubsets();
     
-    bool doubleSided = true;
+    bool doubleSided = !_isClosed(buffers);
     bool flipNormals = false;
-    bool foundColors = _foundAFrontColor;
+    bool foundColors = buffers.foundAFrontColor;
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken(bothSides));
-    _exportMesh(path, _meshFrontFaceSubsets,
+    _exportMesh(path, buffers, _meshFrontFaceSubsets,
                 pxr::UsdGeomTokens->rightHanded,
-                _frontFaceRGBs, _frontFaceAs, _frontUVs, extent,
+                buffers.frontRGBs, buffers.frontRGBIndices,
+                buffers.frontAs, buffers.frontAIndices, buffers.frontUVs,
                 flipNormals, doubleSided, foundColors);
-    _clearFacesExport(); // free the info
 }
 
-#pragma mark Edges:
 void
-USDExporter::_ExportEdges(const pxr::SdfPath parentPath,
-                          SUEntitiesRef entities) {
-    size_t num_edges = 0;
-    bool standAloneOnly = false; // Write only edges not connected to faces.
-    SU_CALL(SUEntitiesGetNumEdges(entities, standAloneOnly, &num_edges));
-    if (!num_edges) {
+USDExporter::_ExportSplitMeshes(const pxr::SdfPath parentPath,
+                                const MeshBuffers& buffers) {
+    // Instead of GeomSubsets, each material gets a mesh of its own, with
+    // just the points its faces use and the material bound to the whole
+    // thing. That's more prims, but every renderer draws them, and none of
+    // them has to split a mesh up by its subsets when the stage is loaded.
+    _coalesceAllGeomSubsets();
+    if (buffers.doubleSided) {
+        _exportSplitSide(parentPath.AppendChild(pxr::TfToken(bothSides)),
+                         buffers, _meshFrontFaceSubsets, true,
+                         !_isClosed(buffers));
         return ;
     }
-    std::vector<SUEdgeRef> edges(num_edges);
-    SU_CALL(SUEntitiesGetEdges(entities, standAloneOnly, num_edges,
-                               &edges[0], &num_edges));
-    _edgePoints.clear();
-    _edgeVertexCounts.clear();
-    _curvesCount += num_edges;
-    for (size_t i = 0; i < num_edges; i++) {
-        _gatherEdgeInfo(edges[i]);
-    }
-    pxr::VtArray<float> widths(1);
-    widths[0] = 1.0f;
-    pxr::VtArray<pxr::GfVec3f> extent(2);
-    pxr::UsdGeomCurves::ComputeExtent(_edgePoints, widths, &extent);
-
-    pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Edges"));
-    auto primSchema = pxr::UsdGeomBasisCurves::Define(_stage, path);
-    primSchema.CreateExtentAttr().Set(extent);
-    primSchema.CreateTypeAttr().Set(pxr::UsdGeomTokens->linear);
-    primSchema.CreatePointsAttr().Set(_edgePoints);
-    primSchema.SetWidthsInterpolation(pxr::UsdGeomTokens->constant);
-    primSchema.CreateWidthsAttr().Set(widths);
-    primSchema.CreateCurveVertexCountsAttr().Set(_edgeVertexCounts);
-    if (_currentDataPoint) {
-        auto count = _currentDataPoint->GetEdgesCount();
-        count += _edgeVertexCounts.size();
-        _currentDataPoint->SetEdgesCount(count);
-    } else {
-        _edgesCount += _edgeVertexCounts.size();
+    _exportSplitSide(parentPath.AppendChild(pxr::TfToken(frontSide)),
+                     buffers, _meshFrontFaceSubsets, true, false);
+    const MeshBuffers* back = _backSideBuffers(buffers);
+    if (back) {
+        _exportSplitSide(parentPath.AppendChild(pxr::TfToken(backSide)),
+                         *back, _meshBackFaceSubsets, false, false);
     }
-    _edgePoints.clear();
-    _edgeVertexCounts.clear();
 }
 
+// The meshes are named after their materials, and the faces that have no
+// material on this side go in one more mesh, with just their display colors.
 void
-USDExporter::_gatherEdgeInfo(SUEdgeRef edge) {
-    if (SUIsInvalid(edge)) {
-        return;
+USDExporter::_exportSplitSide(pxr::SdfPath path, const MeshBuffers& buffers,
+                              const std::vector<MeshSubset>& meshSubsets,
+                              bool frontSide, bool doubleSided) {
+    _writer.DefinePrim(path, "Xform");
+    const pxr::TfToken orientation = frontSide ? pxr::UsdGeomTokens->rightHanded
+                                               : pxr::UsdGeomTokens->leftHanded;
+    const bool flipNormals = !frontSide;
+    const std::string& relName = pxr::UsdShadeTokens->materialBinding.GetString();
+    std::vector<bool> bound(buffers.faceVertexCounts.size(), false);
+    UniqueNameAllocator names;
+    for (const MeshSubset& subset : meshSubsets) {
+        const pxr::VtArray<int>& faceIndices = subset.GetFaceIndices();
+        for (int face : faceIndices) {
+            bound[face] = true;
+        }
+        MeshBuffers part;
+        ExtractMeshFaces(buffers, faceIndices, part);
+        const pxr::SdfPath& materialPath = subset.GetMaterialPath();
+        pxr::SdfPath partPath =
+            path.AppendChild(pxr::TfToken(names.Allocate(materialPath.GetName())));
+        auto mesh = _exportMesh(partPath, part, std::vector<MeshSubset>(),
+                                orientation,
+                                frontSide ? part.frontRGBs : part.backRGBs,
+                                frontSide ? part.frontRGBIndices
+                                          : part.backRGBIndices,
+                                frontSide ? part.frontAs : part.backAs,
+                                frontSide ? part.frontAIndices
+                                          : part.backAIndices,
+                                frontSide ? part.frontUVs : part.backUVs,
+                                flipNormals, doubleSided,
+                                frontSide ? part.foundAFrontColor
+                                          : part.foundABackColor);
+        _writer.AddRelationshipTarget(mesh, relName, materialPath);
+    }
+    pxr::VtArray<int> unboundFaces;
+    for (size_t i = 0; i < bound.size(); i++) {
+        if (!bound[i]) {
+            unboundFaces.push_back((int)i);
+        }
     }
-    SUVertexRef start_vertex = SU_INVALID;
-    SU_CALL(SUEdgeGetStartVertex(edge, &start_vertex));
-    SUPoint3D startP;
-    SU_CALL(SUVertexGetPosition(start_vertex, &startP));
-    _edgePoints.push_back(pxr::GfVec3f(inchesToCM * startP.x,
-                                      inchesToCM * startP.y,
-                                      inchesToCM * startP.z));
-                             
-    SUVertexRef end_vertex = SU_INVALID;
-    SU_CALL(SUEdgeGetEndVertex(edge, &end_vertex));
-    SUPoint3D endP;
-    SU_CALL(SUVertexGetPosition(end_vertex, &endP));
-    _edgePoints.push_back(pxr::GfVec3f(inchesToCM * endP.x,
-                                      inchesToCM * endP.y,
-                                      inchesToCM * endP.z));
-
-    _edgeVertexCounts.push_back(2);
-}
-
-#pragma mark Curves:
-void
-USDExporter::_ExportCurves(const pxr::SdfPath parentPath,
-                           SUEntitiesRef entities) {
-    size_t nCurves = 0;
-    SU_CALL(SUEntitiesGetNumCurves(entities, &nCurves));
-    if (!nCurves) {
+    if (unboundFaces.empty()) {
         return ;
     }
-    std::vector<SUCurveRef> curves(nCurves);
-    SU_CALL(SUEntitiesGetCurves(entities, nCurves, &curves[0], &nCurves));
-    _curvePoints.clear();
-    _curveVertexCounts.clear();
-    _curvesCount += nCurves;
-    for (size_t i = 0; i < nCurves; i++) {
-        _gatherCurveInfo(curves[i]);
-    }
+    MeshBuffers part;
+    ExtractMeshFaces(buffers, unboundFaces, part);
+    pxr::SdfPath partPath =
+        path.AppendChild(pxr::TfToken(names.Allocate("Unbound")));
+    _exportMesh(partPath, part, std::vector<MeshSubset>(), orientation,
+                frontSide ? part.frontRGBs : part.backRGBs,
+                frontSide ? part.frontRGBIndices : part.backRGBIndices,
+                frontSide ? part.frontAs : part.backAs,
+                frontSide ? part.frontAIndices : part.backAIndices,
+                frontSide ? part.frontUVs : part.backUVs,
+                flipNormals, doubleSided,
+                frontSide ? part.foundAFrontColor : part.foundABackColor);
+}
+
+#pragma mark Edges:
+
+// Edges, curves and polylines are all written out the same way, as linear
+// basis curves with a constant width.
+pxr::SdfPrimSpecHandle
+USDExporter::_exportLinearCurves(const pxr::SdfPath path,
+                                 const SceneCurves& curves) {
     pxr::VtArray<float> widths(1);
     widths[0] = 1.0f;
     pxr::VtArray<pxr::GfVec3f> extent(2);
-    pxr::UsdGeomCurves::ComputeExtent(_curvePoints, widths, &extent);
+    pxr::UsdGeomCurves::ComputeExtent(curves.points, widths, &extent);
+
+    auto prim = _writer.DefinePrim(path, "BasisCurves");
+    _writer.SetAttribute(prim, "extent", pxr::SdfValueTypeNames->Float3Array,
+                         pxr::VtValue(extent));
+    _writer.SetAttribute(prim, "type", pxr::SdfValueTypeNames->Token,
+                         pxr::VtValue(pxr::UsdGeomTokens->linear),
+                         pxr::SdfVariabilityUniform);
+    _writer.SetAttribute(prim, "points", pxr::SdfValueTypeNames->Point3fArray,
+                         pxr::VtValue(curves.points));
+    auto widthsAttr = _writer.SetAttribute(prim, "widths",
+                                           pxr::SdfValueTypeNames->FloatArray,
+                                           pxr::VtValue(widths));
+    _writer.SetInterpolation(widthsAttr, pxr::UsdGeomTokens->constant);
+    _writer.SetAttribute(prim, "curveVertexCounts",
+                         pxr::SdfValueTypeNames->IntArray,
+                         pxr::VtValue(curves.vertexCounts));
+    return prim;
+}
 
-    pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Curves"));
-    auto primSchema = pxr::UsdGeomBasisCurves::Define(_stage, path);
-    primSchema.CreateExtentAttr().Set(extent);
-    primSchema.GetPrim().SetDocumentation("Curves not associated with a face");
-    primSchema.CreateTypeAttr().Set(pxr::UsdGeomTokens->linear);
-    primSchema.SetWidthsInterpolation(pxr::UsdGeomTokens->constant);
-    primSchema.CreateWidthsAttr().Set(widths);
-    primSchema.CreatePointsAttr().Set(_curvePoints);
-    primSchema.CreateCurveVertexCountsAttr().Set(_curveVertexCounts);
-    if (_currentDataPoint) {
-        auto count = _currentDataPoint->GetCurvesCount();
-        count += nCurves;
-        _currentDataPoint->SetCurvesCount(count);
-    } else {
-        _curvesCount += nCurves;
-    }
-    _curvePoints.clear();
-    _curveVertexCounts.clear();
+void
+USDExporter::_ExportEdges(const pxr::SdfPath parentPath,
+                          const SceneCurves& edges) {
+    pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Edges"));
+    _exportLinearCurves(path, edges);
 }
 
+#pragma mark Curves:
 void
-USDExporter::_gatherCurveInfo(SUCurveRef curve) {
-    if (SUIsInvalid(curve)) {
-        return ;
-    }
-    size_t num_edges = 0;
-    SU_CALL(SUCurveGetNumEdges(curve, &num_edges));
-    std::vector<SUEdgeRef> edges(num_edges);
-    SU_CALL(SUCurveGetEdges(curve, num_edges, &edges[0], &num_edges));
-    int actuallyEdgesFound = 0;
-    for (size_t i = 0; i < num_edges; ++i) {
-        SUEdgeRef edge = edges[i];
-        if (SUIsInvalid(edge)) {
-            continue ;
-        }
-        actuallyEdgesFound++;
-        SUVertexRef start_vertex = SU_INVALID;
-        SU_CALL(SUEdgeGetStartVertex(edge, &start_vertex));
-        SUPoint3D startP;
-        SU_CALL(SUVertexGetPosition(start_vertex, &startP));
-        _curvePoints.push_back(pxr::GfVec3f(inchesToCM * startP.x,
-                                           inchesToCM * startP.y,
-                                           inchesToCM * startP.z));
-        
-        SUVertexRef end_vertex = SU_INVALID;
-        SU_CALL(SUEdgeGetEndVertex(edge, &end_vertex));
-        SUPoint3D endP;
-        SU_CALL(SUVertexGetPosition(end_vertex, &endP));
-        _curvePoints.push_back(pxr::GfVec3f(inchesToCM * endP.x,
-                                           inchesToCM * endP.y,
-                                           inchesToCM * endP.z));
-    }
-    _curveVertexCounts.push_back(2 * actuallyEdgesFound);
+USDExporter::_ExportCurves(const pxr::SdfPath parentPath,
+                           const SceneCurves& curves) {
+    pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Curves"));
+    auto prim = _exportLinearCurves(path, curves);
+    prim->SetDocumentation("Curves not associated with a face");
 }
 
 #pragma mark Polyline3D:
 void
 USDExporter::_ExportPolylines(const pxr::SdfPath parentPath,
-                              SUEntitiesRef entities) {
-    size_t nPolylines = 0;
-    SU_CALL(SUEntitiesGetNumPolyline3ds(entities, &nPolylines));
-    if (!nPolylines) {
-        return ;
-    }
-    std::vector<SUPolyline3dRef> polylines(nPolylines);
-    SU_CALL(SUEntitiesGetPolyline3ds(entities, nPolylines,
-                                     &polylines[0], &nPolylines));
-    _polylinePoints.clear();
-    _polylineVertexCounts.clear();
-    _curvesCount += nPolylines;
-    for (size_t i = 0; i < nPolylines; i++) {
-        _gatherPolylineInfo(polylines[i]);
-    }
-    pxr::VtArray<float> widths(1);
-    widths[0] = 1.0f;
-    pxr::VtArray<pxr::GfVec3f> extent(2);
-    pxr::UsdGeomCurves::ComputeExtent(_polylinePoints, widths, &extent);
-
+                              const SceneCurves& polylines) {
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("Polylines"));
-    auto primSchema = pxr::UsdGeomBasisCurves::Define(_stage, path);
-    primSchema.CreateExtentAttr().Set(extent);
-    primSchema.CreateTypeAttr().Set(pxr::UsdGeomTokens->linear);
-    primSchema.SetWidthsInterpolation(pxr::UsdGeomTokens->constant);
-    primSchema.CreateWidthsAttr().Set(widths);
-    primSchema.CreatePointsAttr().Set(_polylinePoints);
-    primSchema.CreateCurveVertexCountsAttr().Set(_polylineVertexCounts);
-    if (_currentDataPoint) {
-        auto count = _currentDataPoint->GetLinesCount();
-        count += nPolylines;
-        _currentDataPoint->SetLinesCount(count);
-    } else {
-        _linesCount += nPolylines;
-    }
-    _polylinePoints.clear();
-    _polylineVertexCounts.clear();
-}
-
-void
-USDExporter::_gatherPolylineInfo(SUPolyline3dRef polyline) {
-    if (SUIsInvalid(polyline)) {
-        return ;
-    }
-    size_t nPoints = 0;
-    SU_CALL(SUPolyline3dGetNumPoints(polyline, &nPoints));
-    std::vector<SUPoint3D> pts(nPoints);
-    SU_CALL(SUPolyline3dGetPoints(polyline, nPoints, &pts[0], &nPoints));
-    for (size_t i = 0; i < nPoints; ++i) {
-        SUPoint3D pt = pts[i];
-        _polylinePoints.push_back(pxr::GfVec3f(inchesToCM * pt.x,
-                                               inchesToCM * pt.y,
-                                               inchesToCM * pt.z));
-    }
-    _polylineVertexCounts.push_back((int)nPoints);
+    _exportLinearCurves(path, polylines);
 }
 
 #pragma mark Cameras:
 void
 USDExporter::_ExportCameras(const pxr::SdfPath parentPath) {
-    size_t num_scenes = 0;
-    SU_CALL(SUModelGetNumScenes(_model, &num_scenes));
+    const size_t num_scenes = _scene.cameras.size();
     if (!num_scenes) {
         return ;
     }
     // don't emit the scope if we don't have any scenes/cameras
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken("SketchUpScenes"));
-    auto primSchema = pxr::UsdGeomXform::Define(_stage, path);
-    _usedCameraNames.clear();
-    std::vector<SUSceneRef> scenes(num_scenes);
+    _writer.DefinePrim(path, "Xform");
+    _cameraNames.Clear();
     _camerasCount = num_scenes;
     std::string msg = std::string("Writing ") + std::to_string(num_scenes)
     + " Cameras";
     SU_HandleProgress(_progressCallback, 95.0, msg);
-    SU_CALL(SUModelGetScenes(_model, num_scenes, &scenes[0], &num_scenes));
-    for (size_t def = 0; def < num_scenes; ++def) {
-        _ExportCamera(path, scenes[def]);
-    }
-}
-
-void
-USDExporter::_ExportCamera(const pxr::SdfPath parentPath, SUSceneRef scene) {
-    std::string cameraName = SafeNameFromExclusionList(GetSceneName(scene),
-                                                       _usedCameraNames);
-    _usedCameraNames.insert(cameraName);
-    SUCameraRef camera;
-    SU_CALL(SUSceneGetCamera(scene, &camera));
-
-    double camAspectRatio = _aspectRatio;
-    double aspect_ratio = _aspectRatio;
-    SU_RESULT result = SUCameraGetAspectRatio(camera, &aspect_ratio);
-    if (result == SU_ERROR_NONE) {
-        // we got a specific aspect ratio for this camera - use it
-        camAspectRatio = aspect_ratio;
-    }
-
-    SUPoint3D position;
-    SUPoint3D target;
-    SUVector3D up_vector;
-    SU_CALL(SUCameraGetOrientation(camera, &position, &target, &up_vector));
-    pxr::GfVec3d eyePoint(inchesToCM * position.x,
-                          inchesToCM * position.y,
-                          inchesToCM * position.z);
-    pxr::GfVec3d centerPoint(inchesToCM * target.x,
-                             inchesToCM * target.y,
-                             inchesToCM * target.z);
-    pxr::GfVec3d upDirection(up_vector.x,
-                             up_vector.y,
-                             up_vector.z);
+    for (const SceneCamera& camera : _scene.cameras) {
+        _ExportCamera(path, camera);
+    }
+}
+
+void
+USDExporter::_ExportCamera(const pxr::SdfPath parentPath,
+                           const SceneCamera& camera) {
+    std::string cameraName = _cameraNames.Allocate(camera.name);
+
+    pxr::GfVec3d eyePoint = inchesToCM * camera.position;
+    pxr::GfVec3d centerPoint = inchesToCM * camera.target;
+    pxr::GfVec3d upDirection = camera.upVector;
     // SetLookAt() computes a y-up view matrix which aligns the
     // view direction with the negative z-axis.
     // We then invert that to get where to place the camera
@@ -2117,62 +2003,44 @@ USDExporter::_ExportCamera(const pxr::SdfPath parentPath, SUSceneRef scene) {
                                                  upDirection).GetInverse();
     
     pxr::SdfPath path = parentPath.AppendChild(pxr::TfToken(cameraName));
-    auto primSchema = pxr::UsdGeomCamera::Define(_stage, path);
-
-    auto prim = primSchema.GetPrim();
-    auto keyPath = pxr::TfToken("SketchUp:eyePoint");
-    pxr::GfVec3d eyePointSU(position.x, position.y, position.z);
-    pxr::VtValue eyePointV(eyePointSU);
-    prim.SetCustomDataByKey(keyPath, eyePointV);
-
-    keyPath = pxr::TfToken("SketchUp:centerPoint");
-    pxr::GfVec3d centerPointSU(target.x, target.y, target.z);
-    pxr::VtValue centerPointV(centerPointSU);
-    prim.SetCustomDataByKey(keyPath, centerPointV);
-
-    keyPath = pxr::TfToken("SketchUp:upDirection");
-    pxr::VtValue upDirectionV(upDirection);
-    prim.SetCustomDataByKey(keyPath, centerPointV);
-    
-    keyPath = pxr::TfToken("SketchUp:aspectRatio");
-    pxr::VtValue aspectRatioV(_aspectRatio);
-    prim.SetCustomDataByKey(keyPath, aspectRatioV);
-    
-    // currently, these values seem pretty bogus, so not exporting for now
-    bool exportClippingRange = false;
-    if (exportClippingRange) {
-        double zNear = 0;
-        double zFar = 0;
-        SU_CALL(SUCameraGetClippingDistances(camera, &zNear, &zFar));
-        float scaledZNear = inchesToCM * zNear;
-        float scaledZFar = inchesToCM * zFar;
-        pxr::GfVec2f clippingRange(scaledZNear, scaledZFar);
-        primSchema.CreateClippingRangeAttr().Set(clippingRange);
-    }
-    bool isPerspective = false;
-    SU_CALL(SUCameraGetPerspective(camera, &isPerspective));
-    keyPath = pxr::TfToken("SketchUp:isPerspective");
-    pxr::VtValue isPerspectiveV(isPerspective);
-    prim.SetCustomDataByKey(keyPath, isPerspectiveV);
-    if (isPerspective) {
-        double verticalFOV = 0;
-        SU_CALL(SUCameraGetPerspectiveFrustumFOV(camera, &verticalFOV));
-        keyPath = pxr::TfToken("SketchUp:perspectiveFrustrumFOV");
-        pxr::VtValue verticalFOVV(verticalFOV);
-        prim.SetCustomDataByKey(keyPath, verticalFOVV);
-
-        primSchema.CreateProjectionAttr().Set(pxr::UsdGeomTokens->perspective);
+    auto prim = _writer.DefinePrim(path, "Camera");
+    _writer.SetCustomData(prim, "SketchUp:eyePoint",
+                          pxr::VtValue(camera.position));
+    _writer.SetCustomData(prim, "SketchUp:centerPoint",
+                          pxr::VtValue(camera.target));
+    _writer.SetCustomData(prim, "SketchUp:upDirection",
+                          pxr::VtValue(upDirection));
+    _writer.SetCustomData(prim, "SketchUp:aspectRatio",
+                          pxr::VtValue(_aspectRatio));
+
+    // currently, the clipping range values seem pretty bogus, so we don't
+    // export them
+    _writer.SetCustomData(prim, "SketchUp:isPerspective",
+                          pxr::VtValue(camera.isPerspective));
+    if (camera.isPerspective) {
+        double verticalFOV = camera.verticalFOV;
+        _writer.SetCustomData(prim, "SketchUp:perspectiveFrustrumFOV",
+                              pxr::VtValue(verticalFOV));
+
+        _writer.SetAttribute(prim, "projection", pxr::SdfValueTypeNames->Token,
+                             pxr::VtValue(pxr::UsdGeomTokens->perspective));
         float verticalHeightMM = _sensorHeight;
-        primSchema.CreateVerticalApertureAttr().Set(verticalHeightMM);
+        _writer.SetAttribute(prim, "verticalAperture",
+                             pxr::SdfValueTypeNames->Float,
+                             pxr::VtValue(verticalHeightMM));
         bool useMagicNumber = true;
         if (useMagicNumber) {
             float horizontalWidthMM = verticalHeightMM * _aspectRatio;
-            primSchema.CreateHorizontalApertureAttr().Set(horizontalWidthMM);
+            _writer.SetAttribute(prim, "horizontalAperture",
+                                 pxr::SdfValueTypeNames->Float,
+                                 pxr::VtValue(horizontalWidthMM));
             float focalLengthMM = 20.5;
             // Empirically, this is what it looks like it should be
             // Need to come back and figure out why the math isn't
             // giving us what we need
-            primSchema.CreateFocalLengthAttr().Set(focalLengthMM);
+            _writer.SetAttribute(prim, "focalLength",
+                                 pxr::SdfValueTypeNames->Float,
+                                 pxr::VtValue(focalLengthMM));
         } else {
             // for now, we assume a 35mm film back and verticalFOV
             // focalLength = (height/2) / tan(vFOV/2)
@@ -2183,25 +2051,30 @@ USDExporter::_ExportCamera(const pxr::SdfPath parentPath, SUSceneRef scene) {
             double radiansVersionOfFOV = pxr::GfDegreesToRadians(verticalFOV);
             double tanPart = tan(radiansVersionOfFOV/2.0);
             float focalLengthMM = verticalHeightMM/(2.0 * tanPart);
-            primSchema.CreateFocalLengthAttr().Set(focalLengthMM);
+            _writer.SetAttribute(prim, "focalLength",
+                                 pxr::SdfValueTypeNames->Float,
+                                 pxr::VtValue(focalLengthMM));
             float horizontalWidthMM = _sensorHeight * _aspectRatio;
-            primSchema.CreateHorizontalApertureAttr().Set(horizontalWidthMM);
+            _writer.SetAttribute(prim, "horizontalAperture",
+                                 pxr::SdfValueTypeNames->Float,
+                                 pxr::VtValue(horizontalWidthMM));
         }
     } else {
-        double height = 1;
-        SU_CALL(SUCameraGetOrthographicFrustumHeight(camera, &height));
-        keyPath = pxr::TfToken("SketchUp:orthographicFrustumHeight");
-        pxr::VtValue heightV(height);
-        prim.SetCustomDataByKey(keyPath, heightV);
+        double height = camera.orthographicHeight;
+        _writer.SetCustomData(prim, "SketchUp:orthographicFrustumHeight",
+                              pxr::VtValue(height));
         // NOTE: this number is very frustrating. There doesn't seem to be a
         // linear scaling from this value to what USD looks at for an
         // orthographic scale, so we pass it through as is and assume the
         // importer will modify it as needed.
         float orthographicScale = height;
-        primSchema.CreateProjectionAttr().Set(pxr::UsdGeomTokens->orthographic);
-        primSchema.CreateVerticalApertureAttr().Set(orthographicScale);
+        _writer.SetAttribute(prim, "projection", pxr::SdfValueTypeNames->Token,
+                             pxr::VtValue(pxr::UsdGeomTokens->orthographic));
+        _writer.SetAttribute(prim, "verticalAperture",
+                             pxr::SdfValueTypeNames->Float,
+                             pxr::VtValue(orthographicScale));
     }
-    primSchema.MakeMatrixXform().Set(transform);
+    _writer.SetTransform(prim, transform);
 }
 
 #pragma mark Setters/Getters:
@@ -2266,6 +2139,96 @@ USDExporter::GetExportDoubleSided()const {
     return _exportDoubleSided;
 }
 
+bool
+USDExporter::GetExportNGons() const {
+    return _exportNGons;
+}
+
+bool
+USDExporter::GetNativeTriangulation() const {
+    return _nativeTriangulation;
+}
+
+bool
+USDExporter::GetMergeCoplanarFaces() const {
+    return _mergeCoplanarFaces;
+}
+
+bool
+USDExporter::GetWeldVertices() const {
+    return _weldVertices;
+}
+
+double
+USDExporter::GetWeldTolerance() const {
+    return _weldTolerance;
+}
+
+bool
+USDExporter::GetCleanUpMeshes() const {
+    return _cleanUpMeshes;
+}
+
+bool
+USDExporter::GetSortFacesByMaterial() const {
+    return _sortFacesByMaterial;
+}
+
+bool
+USDExporter::GetSplitMeshesByMaterial() const {
+    return _splitMeshesByMaterial;
+}
+
+bool
+USDExporter::GetShareMeshTopology() const {
+    return _shareMeshTopology;
+}
+
+bool
+USDExporter::GetOmitClosedBackSides() const {
+    return _omitClosedBackSides;
+}
+
+bool
+USDExporter::GetExportPointInstancers() const {
+    return _exportPointInstancers;
+}
+
+size_t
+USDExporter::GetPointInstancerMinimum() const {
+    return _pointInstancerMinimum;
+}
+
+bool
+USDExporter::GetChooseInstancingByCost() const {
+    return _chooseInstancingByCost;
+}
+
+unsigned long long
+USDExporter::GetFlattenTriangleMaximum() const {
+    return _flattenTriangleMaximum;
+}
+
+unsigned long long
+USDExporter::GetFlattenTriangleBudget() const {
+    return _flattenTriangleBudget;
+}
+
+bool
+USDExporter::GetMergeIdenticalDefinitions() const {
+    return _mergeIdenticalDefinitions;
+}
+
+const std::set<std::string>&
+USDExporter::GetIncludedTags() const {
+    return _includedTags;
+}
+
+const std::set<std::string>&
+USDExporter::GetExcludedTags() const {
+    return _excludedTags;
+}
+
 void
 USDExporter::SetSkpFileName(const std::string name) {
     _skpFileName = name;
@@ -2329,6 +2292,96 @@ USDExporter::SetExportDoubleSided(bool flag) {
     _exportDoubleSided = flag;
 }
 
+void
+USDExporter::SetExportNGons(bool flag) {
+    _exportNGons = flag;
+}
+
+void
+USDExporter::SetNativeTriangulation(bool flag) {
+    _nativeTriangulation = flag;
+}
+
+void
+USDExporter::SetMergeCoplanarFaces(bool flag) {
+    _mergeCoplanarFaces = flag;
+}
+
+void
+USDExporter::SetWeldVertices(bool flag) {
+    _weldVertices = flag;
+}
+
+void
+USDExporter::SetWeldTolerance(double tolerance) {
+    _weldTolerance = tolerance;
+}
+
+void
+USDExporter::SetCleanUpMeshes(bool flag) {
+    _cleanUpMeshes = flag;
+}
+
+void
+USDExporter::SetSortFacesByMaterial(bool flag) {
+    _sortFacesByMaterial = flag;
+}
+
+void
+USDExporter::SetSplitMeshesByMaterial(bool flag) {
+    _splitMeshesByMaterial = flag;
+}
+
+void
+USDExporter::SetShareMeshTopology(bool flag) {
+    _shareMeshTopology = flag;
+}
+
+void
+USDExporter::SetOmitClosedBackSides(bool flag) {
+    _omitClosedBackSides = flag;
+}
+
+void
+USDExporter::SetExportPointInstancers(bool flag) {
+    _exportPointInstancers = flag;
+}
+
+void
+USDExporter::SetPointInstancerMinimum(size_t count) {
+    _pointInstancerMinimum = count;
+}
+
+void
+USDExporter::SetChooseInstancingByCost(bool flag) {
+    _chooseInstancingByCost = flag;
+}
+
+void
+USDExporter::SetFlattenTriangleMaximum(unsigned long long count) {
+    _flattenTriangleMaximum = count;
+}
+
+void
+USDExporter::SetFlattenTriangleBudget(unsigned long long count) {
+    _flattenTriangleBudget = count;
+}
+
+void
+USDExporter::SetMergeIdenticalDefinitions(bool flag) {
+    _mergeIdenticalDefinitions = flag;
+}
+
+void
+USDExporter::SetIncludedTags(const std::set<std::string>& tags) {
+    _includedTags = tags;
+}
+
+void
+USDExporter::SetExcludedTags(const std::set<std::string>& tags) {
+    _excludedTags = tags;
+}
+
 double
 USDExporter::GetSensorHeight() const {
     return _sensorHeight;
@@ -2429,12 +2482,37 @@ USDExporter::GetTrianglesCount() {
     return _trianglesCount;
 }
 
+unsigned long long
+USDExporter::GetRemovedFacesCount() {
+    return _removedFacesCount;
+}
+
 
 std::string
 USDExporter::GetExportTimeSummary() {
     return _exportTimeSummary;
 }
 
+unsigned long long
+USDExporter::GetFlattenedDefinitionCount() {
+    return _flattenedDefinitionCount;
+}
+
+unsigned long long
+USDExporter::GetPointInstancedDefinitionCount() {
+    return _pointInstancedDefinitionCount;
+}
+
+unsigned long long
+USDExporter::GetMergedDefinitionCount() {
+    return _mergedDefinitionCount;
+}
+
+std::string
+USDExporter::GetInstancingSummary() {
+    return _instancingSummary;
+}
+
 void
 USDExporter::_updateFileNames() {
     _baseFileName = _usdFileName;
@@ -37,6 +37,13 @@
 // - <foo>.usd
 //   - Sublayers in the <foo>.geom.usd file and defines all the
 //     SketchUp "scenes" as USD cameras
+//
+// The export happens in two steps: the SketchUp model is first read into a
+// SketchUpScene by a SketchUpSceneExtractor, and the model is released. Then
+// everything below _ExportComponentDefinitions writes USD from that scene.
+// That writing goes straight into the SdfLayers through a USDLayerWriter, in
+// a single SdfChangeBlock, and a UsdStage is only opened on the result at the
+// very end to check it.
 
 #ifndef USDExporter_h
 #define USDExporter_h
@@ -45,16 +52,23 @@
 // for some reason, this header is not included in SketchUp's global one
 #include <SketchUpAPI/import_export/pluginprogresscallback.h>
 
-#include "pxr/usd/usd/stage.h"
-#include "pxr/usd/usd/timeCode.h"
-#include "pxr/usd/usdGeom/camera.h"
-#include "pxr/usd/usdGeom/mesh.h"
-#include "pxr/usd/usdGeom/xform.h"
-#include "pxr/usd/usdShade/shader.h"
-#include "pxr/usd/usdShade/material.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "pxr/usd/sdf/attributeSpec.h"
+#include "pxr/usd/sdf/layer.h"
+#include "pxr/usd/sdf/primSpec.h"
 
+#include "DefinitionDeduplicator.h"
 #include "MeshSubset.h"
+#include "SceneMeshBuilder.h"
+#include "SketchUpScene.h"
 #include "StatsDataPoint.h"
+#include "UniqueNameAllocator.h"
+#include "USDLayerWriter.h"
+#include "USDTextureHelper.h"
 
 class USDExporter {
 
@@ -78,6 +92,62 @@ public:
     bool GetExportMeshes() const;
     bool GetExportCameras() const;
     bool GetExportDoubleSided() const;
+    // write convex faces without holes as one polygon rather than triangles
+    bool GetExportNGons() const;
+    // triangulate faces ourselves, on all cores, rather than with SketchUp
+    bool GetNativeTriangulation() const;
+    // merge neighbouring faces in the same plane that look the same, which
+    // means they're triangulated by us
+    bool GetMergeCoplanarFaces() const;
+    // merge the vertices that neighbouring faces share
+    bool GetWeldVertices() const;
+    // in cm, 0 only merges vertices that are exactly the same. It's only
+    // used for the points, see MeshWelder::SetTolerance
+    double GetWeldTolerance() const;
+    // leave out the polygons that have no area or repeat another one
+    bool GetCleanUpMeshes() const;
+    // order each mesh's polygons by material, so every GeomSubset is one
+    // contiguous run of faces
+    bool GetSortFacesByMaterial() const;
+    // write a mesh per material, bound directly, rather than one mesh per
+    // side with a GeomSubset per material
+    bool GetSplitMeshesByMaterial() const;
+    // write the points and topology that the FrontSide and BackSide meshes
+    // share once, in a class they both inherit
+    bool GetShareMeshTopology() const;
+    // Leave out the back sides of the closed shells (walls, columns, ...)
+    // that face out, which nothing outside them can see, unless a face of
+    // the shell isn't opaque. Off by default, as a room modeled as a closed
+    // box is meant to be seen from inside.
+    bool GetOmitClosedBackSides() const;
+    // write the instances of a component that are in the same place in the
+    // hierarchy as one UsdGeomPointInstancer, rather than an Xform each,
+    // once there are at least GetPointInstancerMinimum() of them. Not for
+    // ARKit, which can't read them.
+    bool GetExportPointInstancers() const;
+    size_t GetPointInstancerMinimum() const;
+    // decide for each component definition whether to instance it, point
+    // instance it or write its geometry into every instance, from how many
+    // triangles it has and how many of its instances we'd write. Definitions
+    // with at most GetFlattenTriangleMaximum() triangles, or only one
+    // instance, are flattened until the flattened definitions add up to
+    // GetFlattenTriangleBudget() triangles written out in place, all
+    // together. See GetInstancingSummary() for what was decided.
+    bool GetChooseInstancingByCost() const;
+    unsigned long long GetFlattenTriangleMaximum() const;
+    unsigned long long GetFlattenTriangleBudget() const;
+    // write a single master for component definitions that are copies of
+    // each other, see DefinitionDeduplicator
+    bool GetMergeIdenticalDefinitions() const;
+    // tags (SketchUp layers) to export regardless of their visibility in
+    // SketchUp, or empty to export the visible ones. The default tag
+    // ("Untagged", or "Layer0" in older models) is always exported unless
+    // it's excluded, include list or not, since that's where the groups and
+    // components holding the tagged geometry usually are. To export only
+    // the included tags, exclude the default one as well.
+    const std::set<std::string>& GetIncludedTags() const;
+    // tags to leave out even when they're visible or included
+    const std::set<std::string>& GetExcludedTags() const;
 
     void SetSkpFileName(const std::string name);
     void SetUSDFileName(const std::string name);
@@ -91,6 +161,24 @@ public:
     void SetExportMeshes(bool flag);
     void SetExportCameras(bool flag);
     void SetExportDoubleSided(bool flag);
+    void SetExportNGons(bool flag);
+    void SetNativeTriangulation(bool flag);
+    void SetMergeCoplanarFaces(bool flag);
+    void SetWeldVertices(bool flag);
+    void SetWeldTolerance(double tolerance);
+    void SetCleanUpMeshes(bool flag);
+    void SetSortFacesByMaterial(bool flag);
+    void SetSplitMeshesByMaterial(bool flag);
+    void SetShareMeshTopology(bool flag);
+    void SetOmitClosedBackSides(bool flag);
+    void SetExportPointInstancers(bool flag);
+    void SetPointInstancerMinimum(size_t count);
+    void SetChooseInstancingByCost(bool flag);
+    void SetFlattenTriangleMaximum(unsigned long long count);
+    void SetFlattenTriangleBudget(unsigned long long count);
+    void SetMergeIdenticalDefinitions(bool flag);
+    void SetIncludedTags(const std::set<std::string>& tags);
+    void SetExcludedTags(const std::set<std::string>& tags);
 
     double GetAspectRatio() const;
     double GetSensorHeight() const;
@@ -115,7 +203,14 @@ public:
     unsigned long long GetGeomSubsetsCount();
     unsigned long long GetOriginalFacesCount();
     unsigned long long GetTrianglesCount();
+    unsigned long long GetRemovedFacesCount();
     std::string GetExportTimeSummary();
+    unsigned long long GetFlattenedDefinitionCount();
+    unsigned long long GetPointInstancedDefinitionCount();
+    // the definitions that were copies of another, and so have no master
+    unsigned long long GetMergedDefinitionCount();
+    // one line per definition, only with GetChooseInstancingByCost()
+    std::string GetInstancingSummary();
 
 private:
     bool _performExport(const std::string& skpFileName,
@@ -123,8 +218,15 @@ private:
 
     SUModelRef _model;
     SUTextureWriterRef _textureWriter;
-
-    pxr::UsdStageRefPtr _stage;
+    SketchUpScene _scene;
+    SceneMeshBuilder _meshBuilder;
+    DefinitionDeduplicator _deduplicator;
+
+    pxr::SdfLayerRefPtr _rootLayer;
+    // only when not exporting to a single file
+    pxr::SdfLayerRefPtr _geomLayer;
+    // always pointed at the layer we're currently writing
+    USDLayerWriter _writer;
     
     SketchUpPluginProgressCallback* _progressCallback;
     unsigned long long _componentDefinitionCount;
@@ -140,7 +242,12 @@ private:
     unsigned long long _geomSubsetsCount;
     unsigned long long _originalFacesCount;
     unsigned long long _trianglesCount;
+    unsigned long long _removedFacesCount;
     std::string _exportTimeSummary;
+    unsigned long long _flattenedDefinitionCount;
+    unsigned long long _pointInstancedDefinitionCount;
+    unsigned long long _mergedDefinitionCount;
+    std::string _instancingSummary;
 
     bool _exportNormals;
     bool _exportEdges;
@@ -152,6 +259,24 @@ private:
     bool _exportMeshes;
     bool _exportCameras;
     bool _exportDoubleSided;
+    bool _exportNGons;
+    bool _nativeTriangulation;
+    bool _mergeCoplanarFaces;
+    bool _weldVertices;
+    double _weldTolerance;
+    bool _cleanUpMeshes;
+    bool _sortFacesByMaterial;
+    bool _splitMeshesByMaterial;
+    bool _shareMeshTopology;
+    bool _omitClosedBackSides;
+    bool _exportPointInstancers;
+    size_t _pointInstancerMinimum;
+    bool _chooseInstancingByCost;
+    unsigned long long _flattenTriangleMaximum;
+    unsigned long long _flattenTriangleBudget;
+    bool _mergeIdenticalDefinitions;
+    std::set<std::string> _includedTags;
+    std::set<std::string> _excludedTags;
     double _aspectRatio;
     double _sensorHeight;
     double _startFrame;
@@ -168,25 +293,40 @@ private:
     pxr::TfToken _visToken;
     pxr::VtValue _visValue;
 
-    std::set<std::string> _instancedComponentNames;
-    std::map<uintptr_t, std::string> _componentPtrSafeNameMap;
     std::map<std::string, std::string> _textureNameSafeNameMap;
     std::map<std::string, std::string> _originalComponentNameSafeNameDictionary;
-    std::map<std::string, int> _instanceCountPerClass;
     //std::vector<SUComponentInstanceRef> instances; // wave: this should start with _, right?
-    std::map<pxr::SdfPath, StatsDataPoint*> _componentMasterStats;
 
-    pxr::VtArray<pxr::GfVec3f> _points;
-    pxr::VtArray<pxr::GfVec3f> _vertexNormals;
-    pxr::VtArray<pxr::GfVec3f> _vertexFlippedNormals;
-    pxr::VtArray<int> _faceVertexCounts;
-    pxr::VtArray<int> _flattenedFaceVertexIndices;
+    // Everything an instance needs from its component definition, worked
+    // out once when the master is written, so writing an instance is a
+    // single lookup.
+    struct _DefinitionRecord {
+        _DefinitionRecord();
+
+        pxr::SdfPath masterPath;
+        // the master's name with "__USDInstance_" in place of
+        // "__SUComponentDefinition", to which we add the running count
+        std::string instanceBaseName;
+        bool isBillboard;
+        // what we counted while writing the master
+        std::unique_ptr<StatsDataPoint> stats;
+        // how many instances of it we've written so far
+        int instanceCount;
+        // same, with "__USDPointInstancer_", for its point instancers
+        std::string instancerBaseName;
+        int instancerCount;
+        const SceneDefinition* definition;
+        // see _ChooseInstancing
+        bool flatten;
+        bool pointInstance;
+    };
+    // keyed by the definition's SketchUp pointer, like SceneInstance::definition
+    std::unordered_map<uintptr_t, _DefinitionRecord> _definitionRecords;
+
     // SketchUp allows multiple materials per mesh, so in order to accomodate
-    // that, we need to use USD's UsdGeomSubset API. We use these variables
-    // to hold the indices front and back material names and indices for
-    // each mesh as its being constructed. Note that the points, uvs, display
-    // color and opacity are all pan-mesh, so we don't need to track them.
-    // This is only for material assignment
+    // that, we need to use USD's UsdGeomSubset API. The mesh builder hands us
+    // the front and back subsets of each mesh, and we fill in their material
+    // paths as we write the materials out.
     std::map<pxr::SdfPath, int> _materialPathsCounts;
     // same for shaders - see above
     std::map<pxr::SdfPath, int> _shaderPathsCounts;
@@ -198,37 +338,15 @@ private:
     // it once per mesh.
     std::map<std::string, pxr::SdfPath> _texturePathMaterialPath;
     
-    std::string _frontFaceTextureName;
-    pxr::VtArray<pxr::GfVec2f> _frontUVs;
-    pxr::GfVec4d _frontRGBA;
-    pxr::VtArray<pxr::GfVec3f> _frontFaceRGBs;
-    pxr::VtArray<float> _frontFaceAs;
-
-    std::string _backFaceTextureName;
-    pxr::VtArray<pxr::GfVec2f> _backUVs;
-    pxr::GfVec4d _backRGBA;
-    pxr::VtArray<pxr::GfVec3f> _backFaceRGBs;
-    pxr::VtArray<float> _backFaceAs;
-
-    pxr::VtArray<pxr::GfVec3f> _edgePoints;
-    pxr::VtArray<int> _edgeVertexCounts;
-    
-    pxr::VtArray<pxr::GfVec3f> _curvePoints;
-    pxr::VtArray<int> _curveVertexCounts;
-    
-    pxr::VtArray<pxr::GfVec3f> _polylinePoints;
-    pxr::VtArray<int> _polylineVertexCounts;
-    
-    std::set<std::string> _usedCameraNames;
-    int _currentVertexIndex;
-    SUComponentDefinitionRef _currentComponentDefinition;
-    bool _isBillboard;
+    UniqueNameAllocator _cameraNames;
     
     std::string _skpFileName;
     std::string _usdFileName;
     std::string _textureDirectory;
     bool _useSharedFallbackMaterial;
     pxr::SdfPath _fallbackDisplayMaterialPath;
+    // the one at the top of the scene, as opposed to the per-component ones
+    pxr::SdfPath _topLevelFallbackDisplayMaterialPath;
 
     std::string _baseFileName;
     std::string _zipFileName;
@@ -240,58 +358,78 @@ private:
 
     void _writeMenvFile();
 
-    void _ExportTextures(const pxr::SdfPath parentPath);
+    void _ExportTextures(USDTextureHelper& textureHelper);
+    void _ExtractScene(USDTextureHelper& textureHelper);
+    void _BuildMeshes();
+    void _ChooseInstancing();
     void _ExportFallbackDisplayMaterial(const pxr::SdfPath parentPath);
     void _ExportGeom(const pxr::SdfPath parentPath);
-    void _ExportEntities(const pxr::SdfPath parentPath, SUEntitiesRef entities);
+    void _ExportEntities(const pxr::SdfPath parentPath,
+                         const SceneEntities& entities);
     void _prepAvars();
-    void _addAvars(pxr::UsdPrim prim);
+    void _addAvars(pxr::SdfPrimSpecHandle prim);
 
     std::string _componentDefinitionsFileName;
-    std::set<std::string> _usedComponentNames;
-    pxr::UsdStageRefPtr _componentDefinitionStage;
+    UniqueNameAllocator _componentNames;
+    pxr::SdfLayerRefPtr _componentDefinitionLayer;
     std::set<pxr::SdfPath> _componentDefinitionPaths;
     void _ExportComponentDefinitions(const pxr::SdfPath parentPath);
     void _ExportComponentDefinition(const pxr::SdfPath parentPath,
-                                    SUComponentDefinitionRef component);
-    int _countComponentDefinitionsActuallyUsed();
-    int _countEntities(SUEntitiesRef entities);
+                                    const SceneDefinition& definition);
     void _FinalizeComponentDefinitions();
 
     std::string _geomFileName;
 
-    void _ExportInstances(const pxr::SdfPath parentPath, SUEntitiesRef entities);
+    void _ExportInstances(const pxr::SdfPath parentPath,
+                          const std::vector<SceneInstance>& instances);
     bool _ExportInstance(const pxr::SdfPath parentPath,
-                         SUComponentInstanceRef instance);
-
-    void _ExportGroups(const pxr::SdfPath parentPath, SUEntitiesRef entities);
-    std::string _ExportGroup(const pxr::SdfPath parentPath, SUGroupRef group,
-                             std::set<std::string>& usedGroupNames);
+                         const SceneInstance& instance);
+    bool _ExportFlattenedInstance(const pxr::SdfPath parentPath,
+                                  const SceneInstance& instance,
+                                  _DefinitionRecord& record);
+    void _bindInstanceMaterial(const pxr::SdfPrimSpecHandle& prim,
+                               const pxr::SdfPath& materialsParentPath,
+                               int material);
+    void _referenceComponentMaster(const pxr::SdfPrimSpecHandle& prim,
+                                   const _DefinitionRecord& record);
+    void _countInstance(const _DefinitionRecord& record);
+    size_t _ExportPointInstancer(const pxr::SdfPath parentPath,
+                                 _DefinitionRecord& record,
+                                 const std::vector<const SceneInstance*>& instances);
+
+    void _ExportGroups(const pxr::SdfPath parentPath,
+                       const std::vector<SceneGroup>& groups);
+    std::string _ExportGroup(const pxr::SdfPath parentPath,
+                             const SceneGroup& group,
+                             UniqueNameAllocator& groupNames);
 
     std::string _materialDefinitionsFileName;
     pxr::SdfPath _defaultMaterialPath;
-    bool _foundAFrontColor;
-    bool _foundABackColor;
-    bool _foundAFrontTexture;
-    bool _foundABackTexture;
-    SUMaterialRef _groupMaterial;
     void _incrementCountForMaterialPath(pxr::SdfPath path);
     void _incrementCountForShaderPath(pxr::SdfPath path);
+    // The outputs we connect to are passed around as the paths of their
+    // attributes, and whatever we connect from (shader inputs, the material's
+    // surface output) as the attributes themselves.
+    // returns the material's surface output
+    pxr::SdfAttributeSpecHandle _exportMaterialPrim(const pxr::SdfPath path);
+    pxr::SdfPrimSpecHandle _exportShaderPrim(const pxr::SdfPath path,
+                                             const std::string& shaderId);
+    void _exportPreviewSurfaceDefaults(const pxr::SdfPrimSpecHandle& shader);
     void _exportRGBAShader(const pxr::SdfPath path,
-                           pxr::UsdShadeOutput materialSurface,
+                           pxr::SdfAttributeSpecHandle materialSurface,
                            pxr::GfVec3f rgb, float opacity);
     // returns diffuseColor & opacity inputs
-    std::pair<pxr::UsdShadeInput, pxr::UsdShadeInput>
+    std::pair<pxr::SdfAttributeSpecHandle, pxr::SdfAttributeSpecHandle>
     _exportPreviewShader(const pxr::SdfPath path,
-                         pxr::UsdShadeOutput materialSurface);
-    pxr::UsdShadeOutput _exportSTPrimvarShader(const pxr::SdfPath path);
-    pxr::UsdShadeOutput _exportDisplayColorPrimvarShader(const pxr::SdfPath path);
-    pxr::UsdShadeOutput _exportDisplayOpacityPrimvarShader(const pxr::SdfPath path);
+                         pxr::SdfAttributeSpecHandle materialSurface);
+    pxr::SdfPath _exportSTPrimvarShader(const pxr::SdfPath path);
+    pxr::SdfPath _exportDisplayColorPrimvarShader(const pxr::SdfPath path);
+    pxr::SdfPath _exportDisplayOpacityPrimvarShader(const pxr::SdfPath path);
     void _exportTextureShader(const pxr::SdfPath path,
                               std::string texturePath,
-                              pxr::UsdShadeOutput result,
-                              pxr::UsdShadeInput diffuseColor,
-                              pxr::UsdShadeInput alpha);
+                              pxr::SdfPath result,
+                              pxr::SdfAttributeSpecHandle diffuseColor,
+                              pxr::SdfAttributeSpecHandle alpha);
     void _ExportTextureMaterial(const pxr::SdfPath parentPath,
                                 std::string texturePath);
     void _ExportRGBAMaterial(const pxr::SdfPath path,
@@ -299,44 +437,49 @@ private:
     void _ExportDisplayMaterial(const pxr::SdfPath parentPath);
     bool _someMaterialsToExport();
     bool _ExportMaterials(const pxr::SdfPath parentPath);
-    void _ExportFaces(const pxr::SdfPath parentPath, SUEntitiesRef entities);
-    size_t _gatherFaceInfo(const pxr::SdfPath parentPath, SUFaceRef face);
+    void _ExportFaces(const pxr::SdfPath parentPath, const SceneMesh& mesh);
     void _clearFacesExport();
-    size_t _addFaceAsTexturedTriangles(const pxr::SdfPath parentPath, SUFaceRef face);
-    std::string _textureFileName(SUTextureRef textureRef);
-    bool _addFrontFaceMaterial(SUFaceRef face);
-    bool _addBackFaceMaterial(SUFaceRef face);
     int _cacheDisplayMaterial(pxr::SdfPath path, MeshSubset& subset, int index);
     std::string _generateRGBAMaterialName(pxr::GfVec3f rgb, float opacity);
     void _cacheRGBAMaterial(pxr::SdfPath path, MeshSubset& subset);
     int _cacheTextureMaterial(pxr::SdfPath path, MeshSubset& subset, int index);
-    bool _bothDisplayColorAreEqual();
-    bool _bothDisplayOpacityAreEqual();
-
-    void _exportMesh(pxr::SdfPath path,
-                     std::vector<MeshSubset> _meshSubsets,
-                     pxr::TfToken const orientation,
-                     pxr::VtArray<pxr::GfVec3f>& rgb, pxr::VtArray<float>& a,
-                     pxr::VtArray<pxr::GfVec2f>& uv,
-                     pxr::VtArray<pxr::GfVec3f>& extent,
-                     bool flipNormals, bool doubleSided, bool colorsSet);
-    std::vector<MeshSubset> _coalesceGeomSubsets(std::vector<MeshSubset> subsets);
-    void _coalesceAllGeomSubsets();
-    bool _reallyExportDoubleSided(const pxr::SdfPath parentPath);
-    void _ExportMeshes(const pxr::SdfPath parentPath);
-    void _ExportDoubleSidedMesh(const pxr::SdfPath parentPath);
 
-    void _ExportEdges(const pxr::SdfPath parentPath, SUEntitiesRef entities);
-    void _gatherEdgeInfo(SUEdgeRef edge);
+    pxr::SdfPrimSpecHandle _exportMesh(pxr::SdfPath path,
+                                       const MeshBuffers& buffers,
+                                       const std::vector<MeshSubset>& meshSubsets,
+                                       pxr::TfToken const orientation,
+                                       const pxr::VtArray<pxr::GfVec3f>& rgb,
+                                       const pxr::VtArray<int>& rgbIndices,
+                                       const pxr::VtArray<float>& a,
+                                       const pxr::VtArray<int>& aIndices,
+                                       const pxr::VtArray<pxr::GfVec2f>& uv,
+                                       bool flipNormals, bool doubleSided,
+                                       bool colorsSet,
+                                       const pxr::SdfPath& topologyPath=pxr::SdfPath());
+    void _exportMeshTopology(const pxr::SdfPrimSpecHandle& mesh,
+                             const MeshBuffers& buffers);
+    void _coalesceGeomSubsets(std::vector<MeshSubset>& subsets);
+    void _coalesceAllGeomSubsets();
+    void _ExportMeshes(const pxr::SdfPath parentPath,
+                       const MeshBuffers& buffers);
+    void _ExportDoubleSidedMesh(const pxr::SdfPath parentPath,
+                                const MeshBuffers& buffers);
+    const MeshBuffers* _backSideBuffers(const MeshBuffers& buffers) const;
+    void _ExportSplitMeshes(const pxr::SdfPath parentPath,
+                            const MeshBuffers& buffers);
+    void _exportSplitSide(pxr::SdfPath path, const MeshBuffers& buffers,
+                          const std::vector<MeshSubset>& meshSubsets,
+                          bool frontSide, bool doubleSided);
+
+    pxr::SdfPrimSpecHandle _exportLinearCurves(const pxr::SdfPath path,
+                                               const SceneCurves& curves);
+    void _ExportEdges(const pxr::SdfPath parentPath, const SceneCurves& edges);
+    void _ExportCurves(const pxr::SdfPath parentPath, const SceneCurves& curves);
+    void _ExportPolylines(const pxr::SdfPath parentPath,
+                          const SceneCurves& polylines);
 
-    void _ExportCurves(const pxr::SdfPath parentPath, SUEntitiesRef entities);
-    void _gatherCurveInfo(SUCurveRef curve);
-    
-    void _ExportPolylines(const pxr::SdfPath parentPath, SUEntitiesRef entities);
-    void _gatherPolylineInfo(SUPolyline3dRef polyline);
-    
     void _ExportCameras(const pxr::SdfPath parentPath);
-    void _ExportCamera(const pxr::SdfPath parentPath, SUSceneRef scene);
+    void _ExportCamera(const pxr::SdfPath parentPath, const SceneCamera& camera);
     
     void _ExportUSDShaderForBillboard(const pxr::SdfPath parentPath);
     void _ExportUSDShaderForTextureFile(const pxr::SdfPath parentPath);
@@ -0,0 +1,245 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  USDLayerWriter.cpp
+//
+#include <iostream>
+
+#include "USDLayerWriter.h"
+
+#include "pxr/usd/sdf/changeBlock.h"
+#include "pxr/usd/sdf/schema.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+USDLayerWriter::USDLayerWriter() {
+}
+
+USDLayerWriter::~USDLayerWriter() {
+}
+
+void
+USDLayerWriter::SetLayer(const pxr::SdfLayerHandle& layer) {
+    _layer = layer;
+}
+
+pxr::SdfLayerHandle
+USDLayerWriter::GetLayer() const {
+    return _layer;
+}
+
+pxr::SdfPrimSpecHandle
+USDLayerWriter::DefinePrim(const pxr::SdfPath& path,
+                           const std::string& typeName) {
+    // this hands back the prim if it's already there, and makes any missing
+    // ancestors as "over"
+    pxr::SdfPrimSpecHandle prim = pxr::SdfCreatePrimInLayer(_layer, path);
+    if (!prim) {
+        std::cerr << "ERROR: unable to define " << typeName << " prim at "
+                  << path << std::endl;
+        throw std::exception();
+    }
+    prim->SetSpecifier(pxr::SdfSpecifierDef);
+    prim->SetTypeName(typeName);
+    return prim;
+}
+
+pxr::SdfPrimSpecHandle
+USDLayerWriter::DefineClass(const pxr::SdfPath& path,
+                            const std::string& typeName) {
+    pxr::SdfPrimSpecHandle prim = DefinePrim(path, typeName);
+    prim->SetSpecifier(pxr::SdfSpecifierClass);
+    return prim;
+}
+
+pxr::SdfAttributeSpecHandle
+USDLayerWriter::CreateAttribute(const pxr::SdfPrimSpecHandle& prim,
+                                const std::string& name,
+                                const pxr::SdfValueTypeName& typeName,
+                                pxr::SdfVariability variability) {
+    pxr::SdfPath path = prim->GetPath().AppendProperty(pxr::TfToken(name));
+    pxr::SdfAttributeSpecHandle attribute = _layer->GetAttributeAtPath(path);
+    if (attribute) {
+        return attribute;
+    }
+    // everything we write is part of a schema, so none of it is custom
+    attribute = pxr::SdfAttributeSpec::New(prim, name, typeName,
+                                           variability, false);
+    if (!attribute) {
+        std::cerr << "ERROR: unable to create attribute " << path
+                  << std::endl;
+        throw std::exception();
+    }
+    return attribute;
+}
+
+pxr::SdfAttributeSpecHandle
+USDLayerWriter::SetAttribute(const pxr::SdfPrimSpecHandle& prim,
+                             const std::string& name,
+                             const pxr::SdfValueTypeName& typeName,
+                             const pxr::VtValue& value,
+                             pxr::SdfVariability variability) {
+    auto attribute = CreateAttribute(prim, name, typeName, variability);
+    attribute->SetDefaultValue(value);
+    return attribute;
+}
+
+pxr::SdfAttributeSpecHandle
+USDLayerWriter::SetPrimvar(const pxr::SdfPrimSpecHandle& prim,
+                           const std::string& name,
+                           const pxr::SdfValueTypeName& typeName,
+                           const pxr::VtValue& value,
+                           const pxr::TfToken& interpolation) {
+    auto attribute = SetAttribute(prim, "primvars:" + name, typeName, value);
+    SetInterpolation(attribute, interpolation);
+    return attribute;
+}
+
+pxr::SdfAttributeSpecHandle
+USDLayerWriter::SetIndexedPrimvar(const pxr::SdfPrimSpecHandle& prim,
+                                  const std::string& name,
+                                  const pxr::SdfValueTypeName& typeName,
+                                  const pxr::VtValue& value,
+                                  const pxr::VtArray<int>& indices,
+                                  const pxr::TfToken& interpolation) {
+    auto attribute = SetPrimvar(prim, name, typeName, value, interpolation);
+    SetAttribute(prim, "primvars:" + name + ":indices",
+                 pxr::SdfValueTypeNames->IntArray, pxr::VtValue(indices));
+    return attribute;
+}
+
+void
+USDLayerWriter::SetInterpolation(const pxr::SdfAttributeSpecHandle& attribute,
+                                 const pxr::TfToken& interpolation) {
+    attribute->SetInfo(pxr::UsdGeomTokens->interpolation,
+                       pxr::VtValue(interpolation));
+}
+
+void
+USDLayerWriter::SetConnection(const pxr::SdfAttributeSpecHandle& attribute,
+                              const pxr::SdfPath& source) {
+    auto connections = attribute->GetConnectionPathList();
+    connections.ClearEditsAndMakeExplicit();
+    connections.Append(source);
+}
+
+void
+USDLayerWriter::AddInherit(const pxr::SdfPrimSpecHandle& prim,
+                           const pxr::SdfPath& classPath) {
+    prim->GetInheritPathList().Prepend(classPath);
+}
+
+void
+USDLayerWriter::AddRelationshipTarget(const pxr::SdfPrimSpecHandle& prim,
+                                      const std::string& name,
+                                      const pxr::SdfPath& target) {
+    pxr::SdfPath path = prim->GetPath().AppendProperty(pxr::TfToken(name));
+    pxr::SdfRelationshipSpecHandle relationship = _layer->GetRelationshipAtPath(path);
+    if (!relationship) {
+        relationship = pxr::SdfRelationshipSpec::New(prim, name, false);
+        if (!relationship) {
+            std::cerr << "ERROR: unable to create relationship " << path
+                      << std::endl;
+            throw std::exception();
+        }
+    }
+    // same place UsdRelationship::AddTarget puts it
+    relationship->GetTargetPathList().Prepend(target);
+}
+
+void
+USDLayerWriter::SetTransform(const pxr::SdfPrimSpecHandle& prim,
+                             const pxr::GfMatrix4d& transform) {
+    static const std::string transformOpName("xformOp:transform");
+    SetAttribute(prim, transformOpName, pxr::SdfValueTypeNames->Matrix4d,
+                 pxr::VtValue(transform));
+    pxr::VtTokenArray opOrder(1, pxr::TfToken(transformOpName));
+    SetAttribute(prim, pxr::UsdGeomTokens->xformOpOrder.GetString(),
+                 pxr::SdfValueTypeNames->TokenArray, pxr::VtValue(opOrder),
+                 pxr::SdfVariabilityUniform);
+}
+
+void
+USDLayerWriter::WriteFaceSubsets(const pxr::SdfPrimSpecHandle& mesh,
+                                 const std::string& baseName,
+                                 const pxr::TfToken& familyName,
+                                 const pxr::TfToken& familyType,
+                                 const std::vector<pxr::VtArray<int>>& faceIndices,
+                                 const pxr::SdfPathVector& materials) {
+    if (faceIndices.empty()) {
+        return ;
+    }
+    if (faceIndices.size() != materials.size()) {
+        std::cerr << "ERROR: " << faceIndices.size() << " subsets but "
+                  << materials.size() << " materials for " << mesh->GetPath()
+                  << std::endl;
+        throw std::exception();
+    }
+    pxr::SdfChangeBlock changeBlock;
+    static const std::string subsetTypeName("GeomSubset");
+    static const std::string bindingName("material:binding");
+    const pxr::VtValue elementType(pxr::UsdGeomTokens->face);
+    const pxr::VtValue familyNameValue(familyName);
+    for (size_t i = 0; i < faceIndices.size(); i++) {
+        std::string subsetName = baseName;
+        if (i != 0) {
+            subsetName += "_" + std::to_string(i);
+        }
+        // these are brand new, so unlike DefinePrim and CreateAttribute we
+        // don't need to look for anything that's already there
+        pxr::SdfPrimSpecHandle subset =
+            pxr::SdfPrimSpec::New(mesh, subsetName, pxr::SdfSpecifierDef,
+                                  subsetTypeName);
+        if (!subset) {
+            std::cerr << "ERROR: unable to define GeomSubset " << subsetName
+                      << " under " << mesh->GetPath() << std::endl;
+            throw std::exception();
+        }
+        pxr::SdfAttributeSpec::New(subset, "elementType",
+                                   pxr::SdfValueTypeNames->Token,
+                                   pxr::SdfVariabilityUniform,
+                                   false)->SetDefaultValue(elementType);
+        pxr::SdfAttributeSpec::New(subset, "familyName",
+                                   pxr::SdfValueTypeNames->Token,
+                                   pxr::SdfVariabilityUniform,
+                                   false)->SetDefaultValue(familyNameValue);
+        pxr::SdfAttributeSpec::New(subset, "indices",
+                                   pxr::SdfValueTypeNames->IntArray,
+                                   pxr::SdfVariabilityVarying,
+                                   false)->SetDefaultValue(pxr::VtValue(faceIndices[i]));
+        pxr::SdfRelationshipSpecHandle binding =
+            pxr::SdfRelationshipSpec::New(subset, bindingName, false);
+        binding->GetTargetPathList().Prepend(materials[i]);
+    }
+    // this is what UsdGeomSubset::SetFamilyType puts on the mesh
+    SetAttribute(mesh, "subsetFamily:" + familyName.GetString() + ":familyType",
+                 pxr::SdfValueTypeNames->Token, pxr::VtValue(familyType),
+                 pxr::SdfVariabilityUniform);
+}
+
+void
+USDLayerWriter::SetCustomData(const pxr::SdfPrimSpecHandle& prim,
+                              const std::string& key,
+                              const pxr::VtValue& value) {
+    _layer->SetFieldDictValueByKey(prim->GetPath(),
+                                   pxr::SdfFieldKeys->CustomData,
+                                   pxr::TfToken(key), value);
+}
@@ -0,0 +1,136 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  USDLayerWriter.h
+//
+
+#ifndef USDLayerWriter_h
+#define USDLayerWriter_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/tf/token.h"
+#include "pxr/base/vt/array.h"
+#include "pxr/base/vt/value.h"
+#include "pxr/usd/sdf/attributeSpec.h"
+#include "pxr/usd/sdf/layer.h"
+#include "pxr/usd/sdf/path.h"
+#include "pxr/usd/sdf/primSpec.h"
+#include "pxr/usd/sdf/relationshipSpec.h"
+#include "pxr/usd/sdf/types.h"
+
+// Writes prims and their properties straight into an SdfLayer, without a
+// UsdStage. Going through UsdStage means every Define and every Set is
+// followed by change processing and recomposition, which ends up being most
+// of the time spent exporting a big model. Here we author the same specs the
+// Usd schemas would have (types, variability, interpolation metadata, etc.),
+// and the caller wraps the whole thing in an SdfChangeBlock.
+//
+// Nothing here checks the result against a schema; the exporter opens a
+// UsdStage on what it wrote once it's done for that.
+class USDLayerWriter {
+public:
+    USDLayerWriter();
+    ~USDLayerWriter();
+
+    // the layer everything below writes into
+    void SetLayer(const pxr::SdfLayerHandle& layer);
+    pxr::SdfLayerHandle GetLayer() const;
+
+    // Authors a "def" of the given type (e.g. "Xform", "Mesh") at path. Any
+    // ancestors that are not in the layer yet are authored as "over", like a
+    // UsdStage does when the edit target is a sublayer.
+    pxr::SdfPrimSpecHandle DefinePrim(const pxr::SdfPath& path,
+                                      const std::string& typeName);
+    // same, but a "class", which other prims can inherit from
+    pxr::SdfPrimSpecHandle DefineClass(const pxr::SdfPath& path,
+                                       const std::string& typeName);
+    // returns the existing attribute if there is one
+    pxr::SdfAttributeSpecHandle
+    CreateAttribute(const pxr::SdfPrimSpecHandle& prim,
+                    const std::string& name,
+                    const pxr::SdfValueTypeName& typeName,
+                    pxr::SdfVariability variability=pxr::SdfVariabilityVarying);
+    pxr::SdfAttributeSpecHandle
+    SetAttribute(const pxr::SdfPrimSpecHandle& prim,
+                 const std::string& name,
+                 const pxr::SdfValueTypeName& typeName,
+                 const pxr::VtValue& value,
+                 pxr::SdfVariability variability=pxr::SdfVariabilityVarying);
+    // name is without the "primvars:" namespace
+    pxr::SdfAttributeSpecHandle
+    SetPrimvar(const pxr::SdfPrimSpecHandle& prim,
+               const std::string& name,
+               const pxr::SdfValueTypeName& typeName,
+               const pxr::VtValue& value,
+               const pxr::TfToken& interpolation);
+    // same, with the value being a table that the indices (which go in
+    // "primvars:<name>:indices") pick from, like UsdGeomPrimvar::SetIndices
+    pxr::SdfAttributeSpecHandle
+    SetIndexedPrimvar(const pxr::SdfPrimSpecHandle& prim,
+                      const std::string& name,
+                      const pxr::SdfValueTypeName& typeName,
+                      const pxr::VtValue& value,
+                      const pxr::VtArray<int>& indices,
+                      const pxr::TfToken& interpolation);
+    void SetInterpolation(const pxr::SdfAttributeSpecHandle& attribute,
+                          const pxr::TfToken& interpolation);
+    // makes source the one and only connection of attribute, which is what
+    // UsdShadeInput/Output::ConnectToSource does
+    void SetConnection(const pxr::SdfAttributeSpecHandle& attribute,
+                       const pxr::SdfPath& source);
+    // same place UsdInherits::AddInherit puts it
+    void AddInherit(const pxr::SdfPrimSpecHandle& prim,
+                    const pxr::SdfPath& classPath);
+    void AddRelationshipTarget(const pxr::SdfPrimSpecHandle& prim,
+                               const std::string& name,
+                               const pxr::SdfPath& target);
+    // a single "xformOp:transform", same as UsdGeomXformable::MakeMatrixXform
+    void SetTransform(const pxr::SdfPrimSpecHandle& prim,
+                      const pxr::GfMatrix4d& transform);
+    // Authors one face GeomSubset under mesh for each entry of faceIndices,
+    // named baseName, baseName_1, baseName_2, ..., each with a
+    // material:binding to the matching entry of materials, all in the
+    // familyName family of the given type. This is the same thing as calling
+    // UsdGeomSubset::CreateGeomSubset and binding each one, but the prims are
+    // made as children of mesh directly and the values shared between them
+    // are only made once, so every subset costs the same however many
+    // there are.
+    void WriteFaceSubsets(const pxr::SdfPrimSpecHandle& mesh,
+                          const std::string& baseName,
+                          const pxr::TfToken& familyName,
+                          const pxr::TfToken& familyType,
+                          const std::vector<pxr::VtArray<int>>& faceIndices,
+                          const pxr::SdfPathVector& materials);
+    // key can be namespaced with ":", e.g. "SketchUp:name", in which case
+    // it's nested the way UsdObject::SetCustomDataByKey would
+    void SetCustomData(const pxr::SdfPrimSpecHandle& prim,
+                       const std::string& key, const pxr::VtValue& value);
+
+private:
+    pxr::SdfLayerHandle _layer;
+};
+
+#endif /* USDLayerWriter_h */
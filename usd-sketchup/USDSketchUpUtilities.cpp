@@ -111,19 +111,6 @@ SafeName(const std::string& strName) {
     return SafeName(strName.c_str());
 }
 
-std::string
-SafeNameFromExclusionList(const std::string& initialName,
-                          const std::set<std::string>& namesToExclude) {
-    std::string newName = pxr::TfMakeValidIdentifier(initialName);
-    auto search = namesToExclude.find(newName);
-    if (search == namesToExclude.end()) {
-        // we're not already using it, so we're good:
-        return newName;
-    }
-    newName = newName + "_";
-    return SafeNameFromExclusionList(newName, namesToExclude);
-}
-
 #pragma mark SketchUp names to std::string helpers :
 
 std::string
@@ -154,6 +141,13 @@ GetSceneName(SUSceneRef scene) {
     return name.utf8();
 }
 
+std::string
+GetLayerName(SULayerRef layer) {
+    CSUString name;
+    SU_CALL(SULayerGetName(layer, name));
+    return name.utf8();
+}
+
 #pragma mark Progress callback
 
 void
@@ -283,6 +277,16 @@ USDExporterPlugin::GetExportDoubleSided() {
     return _exportDoubleSided;
 }
 
+const std::set<std::string>&
+USDExporterPlugin::GetIncludedTags() {
+    return _includedTags;
+}
+
+const std::set<std::string>&
+USDExporterPlugin::GetExcludedTags() {
+    return _excludedTags;
+}
+
 void
 USDExporterPlugin::SetAspectRatio(double ratio) {
     _aspectRatio = ratio;
@@ -338,6 +342,16 @@ USDExporterPlugin::SetExportDoubleSided(bool flag) {
     _exportDoubleSided = flag;
 }
 
+void
+USDExporterPlugin::SetIncludedTags(const std::set<std::string>& tags) {
+    _includedTags = tags;
+}
+
+void
+USDExporterPlugin::SetExcludedTags(const std::set<std::string>& tags) {
+    _excludedTags = tags;
+}
+
 void
 USDExporterPlugin::ShowSummaryDialog()  {
     if (!_summaryStr.empty()) {
@@ -365,6 +379,8 @@ USDExporterPlugin::ConvertFromSkp(const std::string& inputSU,
         exporter.SetExportCameras(_exportCameras);
         exporter.SetExportARKitCompatibleUSDZ(_exportARKitCompatible);
         exporter.SetExportDoubleSided(_exportDoubleSided);
+        exporter.SetIncludedTags(_includedTags);
+        exporter.SetExcludedTags(_excludedTags);
         converted = exporter.Convert(inputSU, outputUSD, callback);
     } catch (...) {
         converted = false;
@@ -400,6 +416,33 @@ USDExporterPlugin::_updateSummaryFromExporter(USDExporter& exporter) {
             ss << " Component Definitions\n";
         }
     }
+    count = exporter.GetMergedDefinitionCount();
+    if (count) {
+        ss << std::string("\t") << count;
+        if (count == 1) {
+            ss << " Identical Component Definition Merged\n";
+        } else {
+            ss << " Identical Component Definitions Merged\n";
+        }
+    }
+    count = exporter.GetFlattenedDefinitionCount();
+    if (count) {
+        ss << std::string("\t") << count;
+        if (count == 1) {
+            ss << " Component Definition Flattened Into Its Instances\n";
+        } else {
+            ss << " Component Definitions Flattened Into Their Instances\n";
+        }
+    }
+    count = exporter.GetPointInstancedDefinitionCount();
+    if (count) {
+        ss << std::string("\t") << count;
+        if (count == 1) {
+            ss << " Component Definition Point Instanced\n";
+        } else {
+            ss << " Component Definitions Point Instanced\n";
+        }
+    }
     count = exporter.GetComponentInstanceCount();
     if (count) {
         ss << std::string("Exported ") << count;
@@ -430,6 +473,15 @@ USDExporterPlugin::_updateSummaryFromExporter(USDExporter& exporter) {
         } else {
             ss << " Faces\n";
         }
+        unsigned long long removed = exporter.GetRemovedFacesCount();
+        if (removed) {
+            ss << std::string("\t") << removed;
+            if (removed == 1) {
+                ss << " Degenerate or Duplicate Polygon Removed\n";
+            } else {
+                ss << " Degenerate or Duplicate Polygons Removed\n";
+            }
+        }
     }
     count = exporter.GetMaterialsCount();
     if (count) {
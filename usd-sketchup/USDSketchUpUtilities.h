@@ -50,15 +50,13 @@
 
 #define SU_CALL(func) if ((func) != SU_ERROR_NONE) throw std::exception()
 
-std::string SafeNameFromExclusionList(const std::string& initialName,
-                                      const std::set<std::string>& namesToExclude);
-
 pxr::GfMatrix4d usdTransformFromSUTransform(SUTransformation t);
 
 std::string GetComponentDefinitionName(SUComponentDefinitionRef comp_def);
 std::string GetComponentInstanceName(SUComponentInstanceRef comp_inst);
 std::string GetGroupName(SUGroupRef group);
 std::string GetSceneName(SUSceneRef scene);
+std::string GetLayerName(SULayerRef layer);
 
 // Set progress percent & msg, if progress callback is available.
 void SU_HandleProgress(SketchUpPluginProgressCallback* callback,
@@ -92,6 +90,9 @@ public:
     bool GetExportCameras();
     bool GetExportARKitCompatible();
     bool GetExportDoubleSided();
+    // see USDExporter::GetIncludedTags
+    const std::set<std::string>& GetIncludedTags();
+    const std::set<std::string>& GetExcludedTags();
 
     void SetAspectRatio(double ratio);
     void SetExportNormals(bool flag);
@@ -104,6 +105,8 @@ public:
     void SetExportCameras(bool flag);
     void SetExportARKitCompatible(bool flag);
     void SetExportDoubleSided(bool flag);
+    void SetIncludedTags(const std::set<std::string>& tags);
+    void SetExcludedTags(const std::set<std::string>& tags);
 
     // The dialogs are platform dependent and should be
     // implemented by the subclass on Mac and Windows
@@ -136,6 +139,8 @@ private:
     bool _exportCameras;
     bool _exportARKitCompatible;
     bool _exportDoubleSided;
+    std::set<std::string> _includedTags;
+    std::set<std::string> _excludedTags;
 };
 
 #endif /* USDSketchUpUtilities_h */
@@ -97,7 +97,7 @@ _makePath(const std::string& path)
     }
 }
 
-USDTextureHelper::USDTextureHelper() {
+USDTextureHelper::USDTextureHelper() : _textureWriter(SU_INVALID) {
 }
 
 USDTextureHelper::~USDTextureHelper() {
@@ -108,172 +108,65 @@ USDTextureHelper::MakeTextureDirectory(const std::string& directory) {
     return _makePath(directory);
 }
 
+void
+USDTextureHelper::SetTextureWriter(SUTextureWriterRef texture_writer) {
+    _textureWriter = texture_writer;
+}
 
 size_t
-USDTextureHelper::LoadAllTextures(SUModelRef model, SUTextureWriterRef texture_writer, bool textures_from_layers) {
-    if (SUIsInvalid(texture_writer)) {
-        return 0;
-    }
-    
-    if (textures_from_layers) {
-        // Layers only
-        size_t num_layers;
-        SUResult result = SUModelGetNumLayers(model, &num_layers);
-        if ((result == SU_ERROR_NONE) && (num_layers > 0)) {
-            std::vector<SULayerRef> layers(num_layers);
-            result = SUModelGetLayers(model, num_layers, &layers[0], &num_layers);
-            if (result == SU_ERROR_NONE) {
-                for (size_t i = 0; i < num_layers; i++) {
-                    SULayerRef layer = layers[i];
-                    long texture_id = 0;
-                    result = SUTextureWriterLoadEntity(texture_writer,
-                                                       SULayerToEntity(layer),
-                                                       &texture_id);
-                }
-            }
-        }
-    } else {
-        // Get the root component
-        SUEntitiesRef model_entities;
-        if (SU_ERROR_NONE == SUModelGetEntities(model, &model_entities)) {
-            LoadEntities(texture_writer, model_entities);
-            
-            // Next, all the component definitions
-            size_t num_definitions = 0;
-            SUModelGetNumComponentDefinitions(model, &num_definitions);
-            if (num_definitions > 0) {
-                std::vector<SUComponentDefinitionRef> component_definitions(num_definitions);
-                SUModelGetComponentDefinitions(model, num_definitions,
-                                               &component_definitions[0],
-                                               &num_definitions);
-                
-                for (size_t i = 0; i < num_definitions; i++) {
-                    SUComponentDefinitionRef component_definition =
-                    component_definitions[i];
-                    LoadComponent(texture_writer, component_definition);
-                }
-            }
-        }
-    }
-    // Return the number of textures
+USDTextureHelper::GetNumTextures() const {
     size_t count = 0;
-    if (SU_ERROR_NONE != SUTextureWriterGetNumTextures(texture_writer, &count)) {
+    if (SUIsInvalid(_textureWriter)) {
+        return count;
+    }
+    if (SU_ERROR_NONE != SUTextureWriterGetNumTextures(_textureWriter, &count)) {
         count = 0;
     }
     return count;
 }
 
 void
-USDTextureHelper::LoadComponent(SUTextureWriterRef texture_writer, SUComponentDefinitionRef component) {
-    SUEntitiesRef entities = SU_INVALID;
-    SUComponentDefinitionGetEntities(component, &entities);
-    LoadEntities(texture_writer, entities);
-}
-
-void
-USDTextureHelper::LoadEntities(SUTextureWriterRef texture_writer, SUEntitiesRef entities) {
-    // Top level faces, instances, groups, and images
-    LoadFaces(texture_writer, entities);
-    LoadComponentInstances(texture_writer, entities);
-    LoadGroups(texture_writer, entities);
-    LoadImages(texture_writer, entities);
-}
-
-void
-USDTextureHelper::LoadFaces(SUTextureWriterRef texture_writer, SUEntitiesRef entities) {
-    if (SUIsInvalid(entities)) {
-        return ;
-    }
-    size_t num_faces = 0;
-    SUEntitiesGetNumFaces(entities, &num_faces);
-    if (!num_faces) {
+USDTextureHelper::VisitInstance(SUComponentInstanceRef instance,
+                                SUComponentDefinitionRef definition) {
+    if (SUIsInvalid(_textureWriter)) {
         return ;
     }
-    SUResult hr;
-    std::vector<SUFaceRef> faces(num_faces);
-    SUEntitiesGetFaces(entities, num_faces, &faces[0], &num_faces);
-    for (size_t i = 0; i < num_faces; i++) {
-        SUFaceRef face = faces[i];
-        long front_texture_id = 0;
-        long back_texture_id = 0;
-        hr = SUTextureWriterLoadFace(texture_writer, face,
-                                     &front_texture_id,
-                                     &back_texture_id);
-    }
+    long texture_id = 0;
+    SUTextureWriterLoadEntity(_textureWriter,
+                              SUComponentInstanceToEntity(instance),
+                              &texture_id);
 }
 
 void
-USDTextureHelper::LoadComponentInstances(SUTextureWriterRef texture_writer, SUEntitiesRef entities) {
-    if (SUIsInvalid(entities)) {
+USDTextureHelper::BeginGroup(SUGroupRef group) {
+    if (SUIsInvalid(_textureWriter)) {
         return ;
     }
-    size_t num_instances = 0;
-    SUEntitiesGetNumInstances(entities, &num_instances);
-    if (!num_instances) {
-        return ;
-    }
-    SUResult hr;
-    std::vector<SUComponentInstanceRef> instances(num_instances);
-    SUEntitiesGetInstances(entities, num_instances,
-                           &instances[0], &num_instances);
-    
-    for (size_t i = 0; i < num_instances; i++) {
-        SUComponentInstanceRef instance = instances[i];
-        if (!SUIsInvalid(instance)) {
-            long texture_id = 0;
-            hr = SUTextureWriterLoadEntity(texture_writer,
-                                           SUComponentInstanceToEntity(instance),
-                                           &texture_id);
-        }
-    }
+    // faces without a material of their own show the group's
+    long texture_id = 0;
+    SUTextureWriterLoadEntity(_textureWriter, SUGroupToEntity(group),
+                              &texture_id);
 }
 
 void
-USDTextureHelper::LoadGroups(SUTextureWriterRef texture_writer, SUEntitiesRef entities) {
-    if (SUIsInvalid(entities)) {
+USDTextureHelper::VisitFace(SUFaceRef face) {
+    if (SUIsInvalid(_textureWriter)) {
         return ;
     }
-    size_t num_groups;
-    SUEntitiesGetNumGroups(entities, &num_groups);
-    if (!num_groups) {
-        return ;
-    }
-    std::vector<SUGroupRef> groups(num_groups);
-    SUEntitiesGetGroups(entities, num_groups, &groups[0], &num_groups);
-
-    for (size_t i = 0; i < num_groups; i++) {
-        SUGroupRef group = groups[i];
-        if (!SUIsInvalid(group)) {
-            // Get the component part of the group
-            SUEntitiesRef group_entities = SU_INVALID;
-            SUGroupGetEntities(group, &group_entities);
-            LoadEntities(texture_writer, group_entities);
-        }
-    }
+    long front_texture_id = 0;
+    long back_texture_id = 0;
+    SUTextureWriterLoadFace(_textureWriter, face,
+                            &front_texture_id, &back_texture_id);
 }
 
 void
-USDTextureHelper::LoadImages(SUTextureWriterRef texture_writer, SUEntitiesRef entities) {
-  if (SUIsInvalid(entities)) {
-      return ;
-  }
-    size_t num_images = 0;
-    SUEntitiesGetNumImages(entities, &num_images);
-    if (!num_images) {
+USDTextureHelper::VisitImage(SUImageRef image) {
+    if (SUIsInvalid(_textureWriter)) {
         return ;
     }
-    std::vector<SUImageRef> images(num_images);
-    if (SU_ERROR_NONE == SUEntitiesGetImages(entities, num_images, &images[0], &num_images)) {
-        for (size_t i = 0; i < num_images; i++) {
-            SUImageRef image = images[i];
-            if (!SUIsInvalid(image)) {
-                long texture_id = 0;
-                SUTextureWriterLoadEntity(texture_writer,
-                                          SUImageToEntity(image),
-                                          &texture_id);
-            }
-        }
-    }
+    long texture_id = 0;
+    SUTextureWriterLoadEntity(_textureWriter, SUImageToEntity(image),
+                              &texture_id);
 }
 
 std::string
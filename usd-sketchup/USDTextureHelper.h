@@ -25,40 +25,38 @@
 
 #include <SketchUpAPI/sketchup.h>
 
+#include <string>
+#include <vector>
+
+#include "SketchUpEntityWalker.h"
+
 bool
 makeTextureDirectory(const std::string& directory);
 
-class USDTextureHelper {
+// Loads the textures of everything it visits into the texture writer, so
+// they can all be written out once the walk is done. It needs to visit a
+// face before anything asks the writer for that face's UVs.
+class USDTextureHelper : public SketchUpEntityVisitor {
  public:
     USDTextureHelper();
     ~USDTextureHelper();
 
-  // Load all textures, return number of textures
-  // Input: model to load textures from
-  // Input: texture writer
-  // Input: layers or entities
-  size_t LoadAllTextures(SUModelRef model, SUTextureWriterRef texture_writer,
-                         bool textures_from_layers);
+    void SetTextureWriter(SUTextureWriterRef texture_writer);
+    // Return the number of textures loaded so far
+    size_t GetNumTextures() const;
 
     bool MakeTextureDirectory(const std::string& directory);
     std::vector<std::string> textureFileNames(SUTextureWriterRef texture_writer, SUEntitiesRef entities);
 
+    void VisitInstance(SUComponentInstanceRef instance,
+                       SUComponentDefinitionRef definition) override;
+    void BeginGroup(SUGroupRef group) override;
+    void VisitFace(SUFaceRef face) override;
+    void VisitImage(SUImageRef image) override;
 
 private:
-  // Load textures from all of the entities that have textures
-  void LoadComponent(SUTextureWriterRef texture_writer,
-                     SUComponentDefinitionRef component);
-  void LoadEntities(SUTextureWriterRef texture_writer,
-                    SUEntitiesRef entities);
-  void LoadComponentInstances(SUTextureWriterRef texture_writer,
-                              SUEntitiesRef entities);
-  void LoadGroups(SUTextureWriterRef texture_writer,
-                  SUEntitiesRef entities);
-  void LoadFaces(SUTextureWriterRef texture_writer,
-                 SUEntitiesRef entities);
-  void LoadImages(SUTextureWriterRef texture_writer,
-                  SUEntitiesRef entities);
-    
+    SUTextureWriterRef _textureWriter;
+
     std::string _imageFileName(SUImageRef imageRef);
 };
 
@@ -0,0 +1,139 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  UVMapping.cpp
+//
+#include <cmath>
+
+#include "UVMapping.h"
+
+// how thin the triangle we fit to can be (its area over the square of its
+// longest side) before we give up on it
+static const double minimumSpread = 1.0e-9;
+
+static SUVector3D
+_difference(const SUPoint3D& a, const SUPoint3D& b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+// the area of the parallelogram of u and v, going around normal
+static double
+_crossArea(const SUVector3D& u, const SUVector3D& v, const SUVector3D& normal) {
+    return (u.y * v.z - u.z * v.y) * normal.x +
+           (u.z * v.x - u.x * v.z) * normal.y +
+           (u.x * v.y - u.y * v.x) * normal.z;
+}
+
+static bool
+_near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <=
+        tolerance * std::fmax(1.0, std::fabs(expected));
+}
+
+UVMapping::UVMapping() : _normal({0.0, 0.0, 1.0}), _area(0.0) {
+}
+
+UVMapping::~UVMapping() {
+}
+
+bool
+UVMapping::Fit(const SUPoint3D* points, const SUPoint3D* stqs, size_t count,
+               const SUVector3D& normal) {
+    _area = 0.0;
+    _normal = normal;
+    if (count < 3) {
+        return false;
+    }
+    // the point furthest from the first, and then the one furthest from
+    // the line through those two
+    size_t second = 0;
+    double longest = 0.0;
+    for (size_t i = 1; i < count; i++) {
+        const SUVector3D d = _difference(points[i], points[0]);
+        const double length = d.x * d.x + d.y * d.y + d.z * d.z;
+        if (length > longest) {
+            longest = length;
+            second = i;
+        }
+    }
+    const SUVector3D edge = _difference(points[second], points[0]);
+    size_t third = 0;
+    double area = 0.0;
+    for (size_t i = 1; i < count; i++) {
+        const double a = _crossArea(edge, _difference(points[i], points[0]),
+                                    normal);
+        if (std::fabs(a) > std::fabs(area)) {
+            area = a;
+            third = i;
+        }
+    }
+    if (!(std::fabs(area) > minimumSpread * longest)) {
+        return false;
+    }
+    _points[0] = points[0];
+    _points[1] = points[second];
+    _points[2] = points[third];
+    _stqs[0] = stqs[0];
+    _stqs[1] = stqs[second];
+    _stqs[2] = stqs[third];
+    _area = area;
+    return true;
+}
+
+bool
+UVMapping::IsValid() const {
+    return _area != 0.0;
+}
+
+// Writes the point as _points[0] + s * (_points[1] - _points[0]) +
+// t * (_points[2] - _points[0]), and the STQs go the same way.
+SUPoint3D
+UVMapping::Evaluate(const SUPoint3D& point) const {
+    const SUVector3D e1 = _difference(_points[1], _points[0]);
+    const SUVector3D e2 = _difference(_points[2], _points[0]);
+    const SUVector3D d = _difference(point, _points[0]);
+    const double s = _crossArea(d, e2, _normal) / _area;
+    const double t = _crossArea(e1, d, _normal) / _area;
+    const SUPoint3D& a = _stqs[0];
+    const SUPoint3D& b = _stqs[1];
+    const SUPoint3D& c = _stqs[2];
+    return {a.x + s * (b.x - a.x) + t * (c.x - a.x),
+            a.y + s * (b.y - a.y) + t * (c.y - a.y),
+            a.z + s * (b.z - a.z) + t * (c.z - a.z)};
+}
+
+bool
+UVMapping::Matches(const UVMapping& other, double tolerance) const {
+    if (!IsValid() || !other.IsValid()) {
+        return false;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        const SUPoint3D stq = Evaluate(other._points[i]);
+        const SUPoint3D& expected = other._stqs[i];
+        if (!_near(stq.x, expected.x, tolerance) ||
+            !_near(stq.y, expected.y, tolerance) ||
+            !_near(stq.z, expected.z, tolerance)) {
+            return false;
+        }
+    }
+    return true;
+}
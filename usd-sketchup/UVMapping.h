@@ -0,0 +1,68 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  UVMapping.h
+//
+// How a texture is laid out over a planar face. SketchUp's UVs (as STQs)
+// are each an affine function of where a point is in the face's plane, even
+// for projected textures, so three points of the face that aren't on a line
+// and their STQs pin the mapping down for the whole plane. That lets us ask
+// whether two faces in the same plane have their texture laid out the same
+// way, rather than just agreeing at the points they share: two tiles that
+// are mirrored across the edge between them have the same UVs all along it.
+
+#ifndef UVMapping_h
+#define UVMapping_h
+
+#include <SketchUpAPI/sketchup.h>
+
+#include <stdio.h>
+
+class UVMapping {
+public:
+    UVMapping();
+    ~UVMapping();
+
+    // Fits the mapping to the STQs at the points of a face, using the three
+    // of them that are furthest from being on a line. Returns false (and the
+    // mapping is no use) if they are all on a line, or nearly so.
+    bool Fit(const SUPoint3D* points, const SUPoint3D* stqs, size_t count,
+             const SUVector3D& normal);
+    bool IsValid() const;
+
+    // the STQ at a point in the plane, which doesn't have to be on the face
+    SUPoint3D Evaluate(const SUPoint3D& point) const;
+
+    // Whether this mapping gives the other one's STQs at the points it was
+    // fitted to, within tolerance (relative to STQs bigger than 1). If it
+    // does, the two are the same mapping.
+    bool Matches(const UVMapping& other, double tolerance) const;
+
+private:
+    SUPoint3D _points[3];
+    SUPoint3D _stqs[3];
+    SUVector3D _normal;
+    // twice the area of the triangle of _points, going around _normal
+    double _area;
+};
+
+#endif // UVMapping_h
@@ -0,0 +1,68 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  UniqueNameAllocator.cpp
+//
+#include "UniqueNameAllocator.h"
+
+#include "pxr/base/tf/stringUtils.h"
+
+UniqueNameAllocator::UniqueNameAllocator() {
+}
+
+UniqueNameAllocator::~UniqueNameAllocator() {
+}
+
+std::string
+UniqueNameAllocator::Allocate(const std::string& name) {
+    const std::string baseName = pxr::TfMakeValidIdentifier(name);
+    if (_usedNames.insert(baseName).second) {
+        // we're not already using it, so we're good:
+        return baseName;
+    }
+    // A suffixed name might also have been asked for directly (e.g. there
+    // really is a group called "Wall_1"), so we still have to check, but we
+    // never look at a suffix of this base name twice.
+    size_t& suffix = _nextSuffixes[baseName];
+    while (true) {
+        std::string newName = baseName + "_" + std::to_string(++suffix);
+        if (_usedNames.insert(newName).second) {
+            return newName;
+        }
+    }
+}
+
+bool
+UniqueNameAllocator::IsUsed(const std::string& name) const {
+    return _usedNames.find(name) != _usedNames.end();
+}
+
+size_t
+UniqueNameAllocator::GetCount() const {
+    return _usedNames.size();
+}
+
+void
+UniqueNameAllocator::Clear() {
+    _usedNames.clear();
+    _nextSuffixes.clear();
+}
@@ -0,0 +1,56 @@
+//
+// Copyright 2019 Pixar
+//
+// Licensed under the Apache License, Version 2.0 (the "Apache License")
+// with the following modification; you may not use this file except in
+// compliance with the Apache License and the following modification to it:
+// Section 6. Trademarks. is deleted and replaced with:
+//
+// 6. Trademarks. This License does not grant permission to use the trade
+//    names, trademarks, service marks, or product names of the Licensor
+//    and its affiliates, except as required to comply with Section 4(c) of
+//    the License and to reproduce the content of the NOTICE file.
+//
+// You may obtain a copy of the Apache License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the Apache License with the above modification is
+// distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied. See the Apache License for the specific
+// language governing permissions and limitations under the Apache License.
+//  UniqueNameAllocator.h
+//
+
+#ifndef UniqueNameAllocator_h
+#define UniqueNameAllocator_h
+
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Hands out prim names that are unique within one scope (e.g. the children
+// of one prim). The first request for a name gets it as is (made into a
+// valid identifier), later ones get "_1", "_2", ... added. Each base name
+// remembers which suffix to try next, so handing out a name doesn't get any
+// slower the more times it has been asked for.
+class UniqueNameAllocator {
+public:
+    UniqueNameAllocator();
+    ~UniqueNameAllocator();
+
+    // returns a name that has not been handed out before, and reserves it
+    std::string Allocate(const std::string& name);
+    bool IsUsed(const std::string& name) const;
+    // how many names have been handed out
+    size_t GetCount() const;
+    void Clear();
+
+private:
+    std::unordered_set<std::string> _usedNames;
+    std::unordered_map<std::string, size_t> _nextSuffixes;
+};
+
+#endif /* UniqueNameAllocator_h */